@@ -0,0 +1,90 @@
+#!/usr/bin/env bash
+
+file_count=200
+build_system="DEFAULT"
+compiler="DEFAULT"
+
+if [ $# -ge 1 ]; then
+    file_count="$1"
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    build_system="$1"
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    compiler="$1"
+    shift
+fi
+
+./build.sh "$build_system" "$compiler" >&2
+
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+bin_dir=./bin/"${build_system}"_"${compiler}"
+benchmarks_dir="${bin_dir}"/benchmarks/batch
+sources_dir="${benchmarks_dir}"/sources
+outputs_dir="${benchmarks_dir}"/outputs
+rm -rf "${sources_dir}" "${outputs_dir}"
+mkdir -p "${sources_dir}" "${outputs_dir}"
+results_file="${benchmarks_dir}"/results.csv
+response_file="${benchmarks_dir}"/sources.txt
+
+now_ms() {
+    perl -MTime::HiRes=time -e 'printf "%.3f\n", time * 1000'
+}
+
+# Small files in every generated shape, like the output of a code generator
+# feeding the build, so per-file startup cost is what dominates.
+shapes=(methods statements nesting expression initializer globals)
+sizes=(8 100 10 100 200 100)
+: > "${response_file}"
+for ((i = 0; i < file_count; i++)); do
+    shape_index=$((i % ${#shapes[@]}))
+    source_file="${sources_dir}"/"${shapes[$shape_index]}"-"${i}".dcf
+    "${bin_dir}"/decaf_generator "${shapes[$shape_index]}" "$((sizes[$shape_index] + i % 7))" > "${source_file}"
+    echo "${source_file}" >> "${response_file}"
+done
+
+processors=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+
+echo "mode,files,jobs,wall_ms,files_per_second,status" | tee "${results_file}"
+
+report() {
+    awk -v mode="$1" -v files="${file_count}" -v jobs="$2" -v start="$3" -v end="$4" -v status="$5" \
+        'BEGIN { printf "%s,%d,%d,%.3f,%.1f,%s\n", mode, files, jobs, end - start, files * 1000 / (end - start), status }' |
+        tee -a "${results_file}"
+}
+
+status="ok"
+start=$(now_ms)
+while read -r source_file; do
+    output_file="${outputs_dir}"/"$(basename "${source_file%????}")".s
+    if ! "${bin_dir}"/roast "${source_file}" -O 2 -o "${output_file}" 2>/dev/null; then
+        status="failed"
+    fi
+done < "${response_file}"
+report "per-process" 1 "${start}" "$(now_ms)" "${status}"
+
+job_counts="1"
+for ((jobs = 2; jobs < processors; jobs *= 2)); do
+    job_counts="${job_counts} ${jobs}"
+done
+if [ "${processors}" -gt 1 ]; then
+    job_counts="${job_counts} ${processors}"
+fi
+
+for jobs in ${job_counts}; do
+    status="ok"
+    start=$(now_ms)
+    if ! "${bin_dir}"/roast @"${response_file}" -O 2 -j "${jobs}" --output-dir="${outputs_dir}" 2>/dev/null; then
+        status="failed"
+    fi
+    report "batch" "${jobs}" "${start}" "$(now_ms)" "${status}"
+done
+
+echo "Results written to ${results_file}" >&2
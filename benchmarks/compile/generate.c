@@ -0,0 +1,301 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VALUES_PER_LINE 16
+
+typedef void (*generator_t)(uint32_t size);
+
+struct shape {
+	char *name;
+	generator_t generator;
+};
+
+static void print_result(char *value)
+{
+	printf("  printf( \"%%d\\n\", %s );\n", value);
+}
+
+static void generate_methods(uint32_t size)
+{
+	printf("import printf;\n\n");
+
+	for (uint32_t i = 0; i < size; i++) {
+		printf("int method_%u( int a, int b ) {\n", i);
+		printf("  int c;\n");
+		printf("  c = a * %u + b;\n", i % 13 + 1);
+		printf("  if ( c > %u ) {\n", i);
+		printf("    c = c - b;\n");
+		printf("  }\n");
+		if (i > 0)
+			printf("  return method_%u( c %% 1000, b );\n", i - 1);
+		else
+			printf("  return c;\n");
+		printf("}\n\n");
+	}
+
+	printf("void main( ) {\n");
+	printf("  int sum;\n");
+	printf("  sum = 0;\n");
+	for (uint32_t i = 0; i < size; i += 64)
+		printf("  sum += method_%u( %u, 3 );\n", i, i % 97);
+	print_result("sum");
+	printf("}\n");
+}
+
+static void generate_statements(uint32_t size)
+{
+	printf("import printf;\n\n");
+	printf("void main( ) {\n");
+	printf("  int a, b, c, d;\n");
+	printf("  a = 1;\n");
+	printf("  b = 2;\n");
+	printf("  c = 3;\n");
+	printf("  d = 0;\n");
+
+	for (uint32_t i = 0; i < size; i++) {
+		switch (i % 6) {
+		case 0:
+			printf("  a = b + %u;\n", i % 101);
+			break;
+		case 1:
+			printf("  b = a * 3 - c;\n");
+			break;
+		case 2:
+			printf("  c = ( c + a ) %% 1009;\n");
+			break;
+		case 3:
+			printf("  if ( a > b ) {\n");
+			printf("    d += 1;\n");
+			printf("  } else {\n");
+			printf("    d -= 1;\n");
+			printf("  }\n");
+			break;
+		case 4:
+			printf("  d = d + %u;\n", i);
+			break;
+		case 5:
+			printf("  b = b %% 9973;\n");
+			break;
+		}
+	}
+
+	print_result("a + b + c + d");
+	printf("}\n");
+}
+
+static void generate_nesting(uint32_t size)
+{
+	printf("import printf;\n\n");
+	printf("void main( ) {\n");
+	printf("  int a, b;\n");
+	printf("  a = %u;\n", size);
+	printf("  b = 0;\n");
+
+	for (uint32_t i = 0; i < size; i++) {
+		printf("%*s", 2 * (i + 1), "");
+		if (i % 2 == 0)
+			printf("if ( a > %u ) {\n", i);
+		else
+			printf("while ( b < %u ) {\n", i);
+		printf("%*s", 2 * (i + 2), "");
+		printf("b += 1;\n");
+	}
+
+	for (uint32_t i = size; i-- > 0;)
+		printf("%*s}\n", 2 * (i + 1), "");
+
+	print_result("a + b");
+	printf("}\n");
+}
+
+static void generate_expression(uint32_t size)
+{
+	static char *operators[] = { "+", "-", "*", "+", "%" };
+
+	printf("import printf;\n\n");
+	printf("void main( ) {\n");
+	printf("  int a, b, c, r;\n");
+	printf("  a = 7;\n");
+	printf("  b = 11;\n");
+	printf("  c = 13;\n");
+	printf("  r = a");
+
+	for (uint32_t i = 1; i < size; i++) {
+		char *operator = operators[i % 5];
+		if (i % VALUES_PER_LINE == 0)
+			printf("\n     ");
+		if (i % 3 == 0)
+			printf(" %s ( b + %u )", operator, i % 17 + 1);
+		else if (i % 3 == 1)
+			printf(" %s c", operator);
+		else
+			printf(" %s %u", operator, i % 29 + 1);
+	}
+	printf(";\n");
+
+	print_result("r");
+	printf("}\n");
+}
+
+static void generate_values(uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++) {
+		if (i % VALUES_PER_LINE == 0)
+			printf("\n ");
+		printf(" %u%s", (i * 2654435761u) % 100000,
+		       i + 1 < size ? "," : "");
+	}
+	printf("\n");
+}
+
+static void generate_initializer(uint32_t size)
+{
+	printf("import printf;\n\n");
+	printf("const int table[] = {");
+	generate_values(size);
+	printf("};\n");
+	printf("int counts[] = {");
+	generate_values(size);
+	printf("};\n\n");
+
+	printf("void main( ) {\n");
+	printf("  int i, sum;\n");
+	printf("  int local[] = {");
+	generate_values(size < 256 ? size : 256);
+	printf("  };\n");
+	printf("  sum = 0;\n");
+	printf("  for ( i = 0; i < len( table ); i += 1 ) {\n");
+	printf("    sum += table[ i ] - counts[ i ];\n");
+	printf("    sum += local[ i %% len( local ) ];\n");
+	printf("  }\n");
+	print_result("sum");
+	printf("}\n");
+}
+
+static void generate_globals(uint32_t size)
+{
+	printf("import printf;\n\n");
+	for (uint32_t i = 0; i < size; i++)
+		printf("int global_%u;\n", i);
+	printf("\n");
+
+	printf("void main( ) {\n");
+	printf("  int sum;\n");
+	printf("  sum = 0;\n");
+	for (uint32_t i = 0; i < size; i++)
+		printf("  global_%u = sum + %u;\n  sum += global_%u;\n", i,
+		       i % 53, i);
+	print_result("sum");
+	printf("}\n");
+}
+
+static void generate_comments(uint32_t size)
+{
+	printf("/*\n");
+	printf(" * Every method is documented at length so that most of the\n");
+	printf(" * source is comments the scanner has to skip over.\n");
+	printf(" */\n");
+	printf("import printf;\n\n");
+
+	for (uint32_t i = 0; i < size; i++) {
+		printf("/**\n");
+		printf(" * method_%u( a ) scales its argument by %u and keeps\n",
+		       i, i % 7 + 1);
+		printf(" * the result below one thousand. *It* never fails.\n");
+		printf(" *\n");
+		printf(" * @param a  any value, negative ones included\n");
+		printf(" */\n");
+		printf("int method_%u( int a ) {\n", i);
+		printf("  // scale first, then wrap around\n");
+		printf("  a = a * %u; // cannot overflow for small a\n",
+		       i % 7 + 1);
+		printf("  /* a %% 1000 is negative for negative a */\n");
+		printf("  return a %% 1000;\n");
+		printf("}\n\n");
+	}
+
+	printf("void main( ) {\n");
+	printf("  int sum;\n");
+	printf("  sum = 0; // accumulated over every method\n");
+	for (uint32_t i = 0; i < size; i++)
+		printf("  sum += method_%u( %u );\n", i, i % 97);
+	print_result("sum");
+	printf("}\n");
+}
+
+static void generate_strings(uint32_t size)
+{
+	printf("import printf;\n\n");
+	printf("void main( ) {\n");
+
+	for (uint32_t i = 0; i < size; i++) {
+		if (i % 4 == 0)
+			printf("  printf( \"line %u: the quick brown fox jumps "
+			       "over the lazy dog\\n\" );\n",
+			       i);
+		else if (i % 4 == 1)
+			printf("  printf( \"\\tcolumn\\t%%d\\t\\\"quoted\\\" "
+			       "and \\'single\\'\\n\", %u );\n",
+			       i);
+		else if (i % 4 == 2)
+			printf("  printf( \"%%s\\n\", \"a somewhat longer "
+			       "string literal that spans most of a line, "
+			       "%u\" );\n",
+			       i);
+		else
+			printf("  printf( \"\\\\ escaped backslash \\\\ "
+			       "%%d \\\\\\n\", %u );\n",
+			       i);
+	}
+
+	printf("}\n");
+}
+
+static struct shape shapes[] = {
+	{ .name = "methods", .generator = generate_methods },
+	{ .name = "statements", .generator = generate_statements },
+	{ .name = "nesting", .generator = generate_nesting },
+	{ .name = "expression", .generator = generate_expression },
+	{ .name = "initializer", .generator = generate_initializer },
+	{ .name = "globals", .generator = generate_globals },
+	{ .name = "comments", .generator = generate_comments },
+	{ .name = "strings", .generator = generate_strings },
+};
+
+static void print_usage(char *program)
+{
+	fprintf(stderr, "Usage: %s <shape> <size>\n", program);
+	fprintf(stderr, "Shapes:");
+	for (uint32_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++)
+		fprintf(stderr, " %s", shapes[i].name);
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	char *end = NULL;
+	unsigned long size = strtoul(argv[2], &end, 10);
+	if (*end != '\0' || size == 0 || size > UINT32_MAX) {
+		fprintf(stderr, "Invalid size '%s' passed in.\n", argv[2]);
+		return -1;
+	}
+
+	for (uint32_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+		if (strcmp(shapes[i].name, argv[1]) != 0)
+			continue;
+
+		shapes[i].generator((uint32_t)size);
+		return 0;
+	}
+
+	fprintf(stderr, "Unknown shape '%s' passed in.\n", argv[1]);
+	print_usage(argv[0]);
+	return -1;
+}
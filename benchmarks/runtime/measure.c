@@ -0,0 +1,235 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#define MAX_RUNS 1000
+
+enum counter {
+	COUNTER_INSTRUCTIONS,
+	COUNTER_CYCLES,
+	COUNTER_BRANCH_MISSES,
+	COUNTER_L1D_MISSES,
+	COUNTER_COUNT,
+};
+
+struct run {
+	double wall_time;
+	bool counted;
+	uint64_t counters[COUNTER_COUNT];
+};
+
+#ifdef __linux__
+static struct perf_event_attr counter_attributes(enum counter counter)
+{
+	struct perf_event_attr attributes = {
+		.size = sizeof(struct perf_event_attr),
+		.disabled = counter == COUNTER_INSTRUCTIONS,
+		.enable_on_exec = counter == COUNTER_INSTRUCTIONS,
+		.exclude_kernel = 1,
+		.exclude_hv = 1,
+		.read_format = PERF_FORMAT_GROUP |
+			       PERF_FORMAT_TOTAL_TIME_ENABLED |
+			       PERF_FORMAT_TOTAL_TIME_RUNNING,
+	};
+
+	switch (counter) {
+	case COUNTER_INSTRUCTIONS:
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case COUNTER_CYCLES:
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case COUNTER_BRANCH_MISSES:
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case COUNTER_L1D_MISSES:
+		attributes.type = PERF_TYPE_HW_CACHE;
+		attributes.config = PERF_COUNT_HW_CACHE_L1D |
+				    PERF_COUNT_HW_CACHE_OP_READ << 8 |
+				    PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+		break;
+	default:
+		break;
+	}
+
+	return attributes;
+}
+
+static int open_counters(pid_t pid, int *descriptors)
+{
+	for (uint32_t i = 0; i < COUNTER_COUNT; i++) {
+		struct perf_event_attr attributes = counter_attributes(i);
+		descriptors[i] = syscall(SYS_perf_event_open, &attributes, pid,
+					 -1, i == 0 ? -1 : descriptors[0], 0);
+		if (descriptors[i] >= 0)
+			continue;
+
+		for (uint32_t j = 0; j < i; j++)
+			close(descriptors[j]);
+		return -1;
+	}
+
+	return 0;
+}
+
+static bool read_counters(int *descriptors, uint64_t *counters)
+{
+	uint64_t values[3 + COUNTER_COUNT] = { 0 };
+	bool result = read(descriptors[0], values, sizeof(values)) ==
+		      sizeof(values);
+
+	double scale = values[2] > 0 ? (double)values[1] / values[2] : 1.0;
+	for (uint32_t i = 0; i < COUNTER_COUNT; i++) {
+		counters[i] = (uint64_t)(values[3 + i] * scale);
+		close(descriptors[i]);
+	}
+
+	return result;
+}
+#endif
+
+static double monotonic_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+static int measure(char **program, char *output_file, struct run *run)
+{
+	int ready[2];
+	if (pipe(ready) != 0)
+		return -1;
+
+	pid_t pid = fork();
+	if (pid < 0)
+		return -1;
+
+	if (pid == 0) {
+		char signal;
+		close(ready[1]);
+		if (read(ready[0], &signal, 1) != 1)
+			_exit(127);
+
+		int output = open(output_file, O_WRONLY | O_CREAT | O_TRUNC,
+				  0644);
+		if (output < 0 || dup2(output, STDOUT_FILENO) < 0)
+			_exit(127);
+
+		execv(program[0], program);
+		_exit(127);
+	}
+
+	close(ready[0]);
+
+	run->counted = false;
+#ifdef __linux__
+	int descriptors[COUNTER_COUNT];
+	run->counted = open_counters(pid, descriptors) == 0;
+#endif
+
+	double start = monotonic_time();
+	if (write(ready[1], "", 1) != 1)
+		return -1;
+	close(ready[1]);
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	run->wall_time = monotonic_time() - start;
+
+#ifdef __linux__
+	if (run->counted)
+		run->counted = read_counters(descriptors, run->counters);
+#endif
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return -1;
+
+	return 0;
+}
+
+static int compare_doubles(const void *left, const void *right)
+{
+	double a = *(const double *)left;
+	double b = *(const double *)right;
+	return (a > b) - (a < b);
+}
+
+static int compare_counters(const void *left, const void *right)
+{
+	uint64_t a = *(const uint64_t *)left;
+	uint64_t b = *(const uint64_t *)right;
+	return (a > b) - (a < b);
+}
+
+static void print_median_counter(struct run *runs, uint32_t run_count,
+				 enum counter counter)
+{
+	uint64_t values[MAX_RUNS];
+	for (uint32_t i = 0; i < run_count; i++)
+		values[i] = runs[i].counters[counter];
+
+	qsort(values, run_count, sizeof(uint64_t), compare_counters);
+	printf(",%llu", (unsigned long long)values[run_count / 2]);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 4) {
+		fprintf(stderr,
+			"Usage: %s <runs> <output file> <program> [arguments...]\n",
+			argv[0]);
+		return -1;
+	}
+
+	int run_count = atoi(argv[1]);
+	if (run_count < 1 || run_count > MAX_RUNS) {
+		fprintf(stderr, "Invalid run count '%s' passed in.\n", argv[1]);
+		return -1;
+	}
+
+	static struct run runs[MAX_RUNS];
+	bool counted = true;
+	for (int i = 0; i < run_count; i++) {
+		if (measure(&argv[3], argv[2], &runs[i]) != 0) {
+			fprintf(stderr, "Failed to run %s\n", argv[3]);
+			return -1;
+		}
+
+		counted &= runs[i].counted;
+	}
+
+	if (!counted)
+		fprintf(stderr,
+			"Hardware counters unavailable, reporting wall time only.\n");
+
+	double wall_times[MAX_RUNS];
+	for (int i = 0; i < run_count; i++)
+		wall_times[i] = runs[i].wall_time;
+	qsort(wall_times, run_count, sizeof(double), compare_doubles);
+
+	printf("%.3f,%.3f", wall_times[run_count / 2], wall_times[0]);
+	for (uint32_t i = 0; i < COUNTER_COUNT; i++) {
+		if (counted)
+			print_median_counter(runs, run_count, i);
+		else
+			printf(",");
+	}
+	printf("\n");
+
+	return 0;
+}
@@ -0,0 +1,117 @@
+#!/usr/bin/env bash
+
+shapes="methods statements nesting expression initializer globals comments strings"
+build_system="DEFAULT"
+compiler="DEFAULT"
+
+if [ $# -ge 1 ]; then
+    if [ "$1" != "all" ]; then
+        shapes="$1"
+    fi
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    build_system="$1"
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    compiler="$1"
+    shift
+fi
+
+./build.sh "$build_system" "$compiler" >&2
+
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+bin_dir=./bin/"${build_system}"_"${compiler}"
+benchmarks_dir="${bin_dir}"/benchmarks/compile
+mkdir -p "${benchmarks_dir}"
+results_file="${benchmarks_dir}"/results.csv
+
+shape_sizes() {
+    case "$1" in
+        methods) echo "250 500 1000 2000" ;;
+        statements) echo "1000 2000 4000 8000" ;;
+        nesting) echo "50 100 200 400" ;;
+        expression) echo "500 1000 2000 4000" ;;
+        initializer) echo "2000 4000 8000 16000" ;;
+        globals) echo "1000 2000 4000 8000" ;;
+        comments) echo "250 500 1000 2000" ;;
+        strings) echo "1000 2000 4000 8000" ;;
+        *) echo "" ;;
+    esac
+}
+
+# Every -t stage once, and the assembly stage at each -O preset. --stream
+# compares the peak RSS of one method at a time against the whole program.
+configurations=("scan|" "parse|" "inter|" "assembly|-O 0" "assembly|-O 1" "assembly|-O 2" "assembly|-O 0 --stream" "assembly|-O 2 --stream")
+
+# The methods shape is also compiled at -O 2 with 2, 4, ... jobs up to one per
+# processor to show how per-method parallel optimization and code generation
+# scale. Every shape is parsed with as many jobs to show how lexing in chunks
+# scales, parse since scan output is dominated by printing the tokens.
+processors=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+job_configurations=()
+scan_job_configurations=()
+for ((jobs = 2; jobs < processors; jobs *= 2)); do
+    job_configurations+=("assembly|-O 2 -j ${jobs}")
+    scan_job_configurations+=("parse|-j ${jobs}")
+done
+if [ "${processors}" -gt 1 ]; then
+    job_configurations+=("assembly|-O 2 -j ${processors}")
+    scan_job_configurations+=("parse|-j ${processors}")
+fi
+
+echo "shape,size,bytes,target,flags,wall_ms,cpu_ms,allocations,peak_rss_kb,exponent,status" | tee "${results_file}"
+
+for shape in ${shapes}; do
+    sizes=$(shape_sizes "${shape}")
+    if [ -z "${sizes}" ]; then
+        echo "Unknown shape '${shape}' passed in." >&2
+        exit 1
+    fi
+
+    shape_configurations=("${configurations[@]}" "${scan_job_configurations[@]}")
+    if [ "${shape}" = "methods" ]; then
+        shape_configurations+=("${job_configurations[@]}")
+    fi
+
+    for size in ${sizes}; do
+        source_file="${benchmarks_dir}"/"${shape}"-"${size}".dcf
+        "${bin_dir}"/decaf_generator "${shape}" "${size}" > "${source_file}"
+        bytes=$(wc -c < "${source_file}" | tr -d ' ')
+
+        for configuration in "${shape_configurations[@]}"; do
+            target="${configuration%%|*}"
+            flags="${configuration#*|}"
+
+            report=$("${bin_dir}"/roast "${source_file}" -t "${target}" ${flags} --time-report -o /dev/null 2>&1 > /dev/null)
+            status=$?
+            total=$(echo "${report}" | awk '$NF == "total" { print $1 "," $2 "," (NF == 5 ? $3 : "") "," $(NF - 1) }')
+
+            if [ ${status} -ne 0 ] || [ -z "${total}" ]; then
+                echo "${shape},${size},${bytes},${target},${flags},,,,,,failed" | tee -a "${results_file}"
+                continue
+            fi
+
+            echo "${shape},${size},${bytes},${target},${flags},${total},,ok" | tee -a "${results_file}"
+        done
+    done
+done
+
+# exponent is the slope of log(wall time) over log(size) against the previous
+# size of the same shape and configuration: ~1 is linear, ~2 quadratic. It is
+# filled in afterwards since awk has the associative arrays bash 3 lacks.
+awk -F, -v OFS=, 'NR > 1 && $11 == "ok" {
+    key = $1 "|" $4 "|" $5
+    if ((key in previous_size) && $6 > 0 && previous_wall[key] > 0)
+        $10 = sprintf("%.2f", log($6 / previous_wall[key]) / log($2 / previous_size[key]))
+    previous_size[key] = $2
+    previous_wall[key] = $6
+} { print }' "${results_file}" > "${results_file}.tmp" && mv "${results_file}.tmp" "${results_file}"
+
+echo "Results written to ${results_file}" >&2
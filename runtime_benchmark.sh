@@ -0,0 +1,129 @@
+#!/usr/bin/env bash
+
+runs=5
+baseline=""
+build_system="DEFAULT"
+compiler="DEFAULT"
+
+if [ $# -ge 1 ]; then
+    runs="$1"
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    if [ "$1" != "none" ]; then
+        baseline="$1"
+    fi
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    build_system="$1"
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    compiler="$1"
+    shift
+fi
+
+./build.sh "$build_system" "$compiler" >&2
+
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+if [ "$(uname)" = "Darwin" ]; then
+    link_flags="-arch x86_64"
+else
+    link_flags="-no-pie"
+fi
+
+bin_dir=./bin/"${build_system}"_"${compiler}"
+benchmarks_dir="${bin_dir}"/benchmarks/runtime
+baselines_dir="${bin_dir}"/benchmarks/baselines
+mkdir -p "${benchmarks_dir}" "${baselines_dir}"
+
+commit=$(git rev-parse --short HEAD)
+if ! git diff --quiet HEAD; then
+    commit="${commit}-dirty"
+fi
+results_file="${benchmarks_dir}"/results.csv
+
+echo "benchmark,flags,wall_ms,min_wall_ms,instructions,cycles,branch_misses,l1d_misses,status" | tee "${results_file}"
+
+compile() {
+    "${bin_dir}"/roast "$1" -t assembly $2 -o "$3" 2>/dev/null &&
+        gcc -g ${link_flags} -O0 -x assembler "$3" -o "$4" 2>/dev/null
+}
+
+# "-O 2 pgo" compiles an instrumented -O 2 build, runs it once to record block
+# counts and recompiles -O 2 with them.
+configurations=("O0|-O 0" "O1|-O 1" "O2|-O 2" "O2.pgo|-O 2 pgo")
+
+for benchmark_file in ./benchmarks/runtime/*.dcf; do
+    benchmark_name=$(basename "${benchmark_file%????}")
+
+    for configuration in "${configurations[@]}"; do
+        suffix="${configuration%%|*}"
+        flags="${configuration#*|}"
+        roast_flags="${flags% pgo}"
+        assembly_file="${benchmarks_dir}"/"${benchmark_name}"."${suffix}".asm
+        executable_file="${benchmarks_dir}"/"${benchmark_name}"."${suffix}"
+        output_file="${executable_file}".out
+        profile_file="${executable_file}".profile
+
+        status="ok"
+        counters=",,,,,"
+        if [ "${flags}" != "${roast_flags}" ]; then
+            rm -f "${profile_file}"
+            if ! compile "$benchmark_file" "${roast_flags} -fprofile-generate=${profile_file}" "${assembly_file}" "${executable_file}" ||
+                ! "${executable_file}" > /dev/null 2>&1; then
+                status="profile failed"
+            fi
+            roast_flags="${roast_flags} -fprofile-use=${profile_file}"
+        fi
+
+        if [ "${status}" != "ok" ]; then
+            :
+        elif ! compile "$benchmark_file" "${roast_flags}" "${assembly_file}" "${executable_file}"; then
+            status="compile failed"
+        elif ! counters=$("${bin_dir}"/benchmark_measure "${runs}" "${output_file}" "${executable_file}" 2>/dev/null); then
+            counters=",,,,,"
+            status="run failed"
+        elif ! diff "${benchmarks_dir}"/"${benchmark_name}".O0.out "${output_file}" > /dev/null; then
+            status="output differs from -O 0"
+        fi
+
+        echo "${benchmark_name},${flags},${counters},${status}" | tee -a "${results_file}"
+    done
+done
+
+# Compare before saving so a rerun at the same commit is compared against the
+# previously recorded baseline.
+if [ -n "${baseline}" ]; then
+    baseline_file="${baselines_dir}"/"${baseline}".csv
+    if [ ! -f "${baseline_file}" ]; then
+        echo "No baseline recorded for ${baseline}" >&2
+        exit 1
+    fi
+
+    echo "Compared to ${baseline}:"
+    awk -F, '
+        function change(before, after) {
+            if (before == "" || after == "" || before == 0)
+                return "n/a"
+            return sprintf("%+.1f%%", (after - before) * 100 / before)
+        }
+        FNR == 1 { next }
+        NR == FNR { wall[$1 "," $2] = $3; instructions[$1 "," $2] = $5; next }
+        ($1 "," $2) in wall {
+            printf "   %s %s: %sms -> %sms (%s), instructions %s\n", $1, $2,
+                wall[$1 "," $2], $3, change(wall[$1 "," $2], $3),
+                change(instructions[$1 "," $2], $5)
+        }
+    ' "${baseline_file}" "${results_file}"
+fi
+
+cp "${results_file}" "${baselines_dir}"/"${commit}".csv
+echo "Baseline recorded as ${commit}" >&2
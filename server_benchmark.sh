@@ -0,0 +1,89 @@
+#!/usr/bin/env bash
+
+file_count=100
+build_system="DEFAULT"
+compiler="DEFAULT"
+
+if [ $# -ge 1 ]; then
+    file_count="$1"
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    build_system="$1"
+    shift
+fi
+
+if [ $# -ge 1 ]; then
+    compiler="$1"
+    shift
+fi
+
+./build.sh "$build_system" "$compiler" >&2
+
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+bin_dir=./bin/"${build_system}"_"${compiler}"
+benchmarks_dir="${bin_dir}"/benchmarks/server
+sources_dir="${benchmarks_dir}"/sources
+outputs_dir="${benchmarks_dir}"/outputs
+cache_dir="${benchmarks_dir}"/cache
+socket_file="${benchmarks_dir}"/roast.sock
+rm -rf "${sources_dir}" "${outputs_dir}" "${cache_dir}"
+mkdir -p "${sources_dir}" "${outputs_dir}"
+results_file="${benchmarks_dir}"/results.csv
+
+now_ms() {
+    perl -MTime::HiRes=time -e 'printf "%.3f\n", time * 1000'
+}
+
+# Small files, where starting the compiler costs about as much as compiling.
+shapes=(methods statements expression globals)
+sizes=(4 20 20 20)
+for ((i = 0; i < file_count; i++)); do
+    shape_index=$((i % ${#shapes[@]}))
+    "${bin_dir}"/decaf_generator "${shapes[$shape_index]}" "$((sizes[$shape_index] + i % 5))" > "${sources_dir}"/"${i}".dcf
+done
+
+echo "mode,files,flags,wall_ms,latency_ms,status" | tee "${results_file}"
+
+# Compiles every file once with a separate roast invocation, the way a build
+# system would, and reports the mean latency of a compile.
+measure() {
+    local mode="$1"
+    local flags="$2"
+    shift 2
+
+    local status="ok"
+    local start
+    start=$(now_ms)
+    for ((i = 0; i < file_count; i++)); do
+        # shellcheck disable=SC2086
+        if ! "$@" "${sources_dir}"/"${i}".dcf ${flags} -o "${outputs_dir}"/"${i}".s 2>/dev/null; then
+            status="failed"
+        fi
+    done
+    local end
+    end=$(now_ms)
+
+    awk -v mode="${mode}" -v files="${file_count}" -v flags="${flags}" -v start="${start}" -v end="${end}" -v status="${status}" \
+        'BEGIN { printf "%s,%d,%s,%.3f,%.3f,%s\n", mode, files, flags, end - start, (end - start) / files, status }' |
+        tee -a "${results_file}"
+}
+
+"${bin_dir}"/roast --server="${socket_file}" 2>/dev/null &
+server_pid=$!
+trap 'kill "${server_pid}" 2>/dev/null' EXIT
+for ((i = 0; i < 50; i++)); do
+    [ -S "${socket_file}" ] && break
+    sleep 0.1
+done
+
+for flags in "-t scan" "-O 0" "-O 2" "-O 2 --cache-dir=${cache_dir}"; do
+    measure "per-process" "${flags}" "${bin_dir}"/roast
+    measure "server" "${flags}" "${bin_dir}"/roast --connect="${socket_file}"
+done
+
+echo "Results written to ${results_file}" >&2
@@ -1,15 +1,48 @@
 #include "assembly/code_generator.h"
+#include "output.h"
+#include "time_report.h"
+
+#define ZERO_FILL_UNROLL_LIMIT 16
+#define QUADS_PER_LINE 8
+
+struct profile_block {
+	char *method;
+	uint32_t id;
+};
+
+struct method_output {
+	struct code_generator *generator;
+	struct llir_method *method;
+	GString *text;
+	GString *report;
+};
+
+enum global_section {
+	GLOBAL_SECTION_DATA,
+	GLOBAL_SECTION_BSS,
+	GLOBAL_SECTION_RODATA,
+};
 
 static const char *ARGUMENT_REGISTERS[] = { "rdi", "rsi", "rdx",
 					    "rcx", "r8",  "r9" };
 
+static void generate_call(const char *method)
+{
+#ifdef __APPLE__
+	g_print("\tcall _%s\n", method);
+#else
+	g_print("\tcall %s\n", method);
+#endif
+}
+
 static void generate_global_string(struct code_generator *generator,
 				   char *string)
 {
 	if (g_hash_table_lookup(generator->strings, string) != 0)
 		return;
 
-	g_print("string_%llu:\n", generator->string_counter);
+	g_print("%sstring_%llu:\n", generator->label_prefix,
+		generator->string_counter);
 	g_print("\t.string %s\n", string);
 	g_print("\t.align 16\n");
 
@@ -62,56 +95,133 @@ static void generate_global_strings(struct code_generator *generator)
 	}
 }
 
-static void generate_global_fields(struct code_generator *generator)
+static enum global_section field_section(struct llir_field *field)
 {
-	for (uint32_t i = 0; i < generator->llir->fields->len; i++) {
-		struct llir_field *field = g_array_index(
-			generator->llir->fields, struct llir_field *, i);
+	if (field->is_constant)
+		return GLOBAL_SECTION_RODATA;
 
-		g_print("%s:\n", field->identifier);
-		g_print("\t.fill %llu\n", 8 * field->value_count);
-		g_print("\t.align 16\n");
+	for (uint32_t i = 0; i < field->value_count; i++) {
+		if (field->values[i] != 0)
+			return GLOBAL_SECTION_DATA;
 	}
+
+	return GLOBAL_SECTION_BSS;
 }
 
-static void generate_data_section(struct code_generator *generator)
+static void generate_global_field(struct llir_field *field)
 {
-	g_print(".data\n");
-	generate_global_strings(generator);
-	generate_global_fields(generator);
+	g_print("\t.align 16\n");
+	g_print("%s:\n", field->identifier);
+
+	if (field_section(field) == GLOBAL_SECTION_BSS) {
+		g_print("\t.zero %llu\n", 8 * field->value_count);
+		return;
+	}
+
+	for (uint32_t i = 0; i < field->value_count; i++) {
+		g_print(i % QUADS_PER_LINE == 0 ? "\t.quad " : ", ");
+		g_print("%lld", field->values[i]);
+		if (i % QUADS_PER_LINE == QUADS_PER_LINE - 1 ||
+		    i == field->value_count - 1)
+			g_print("\n");
+	}
 }
 
-static void generate_stack_allocation(struct code_generator *generator,
-				      struct llir_method *method)
+static void generate_global_fields(struct code_generator *generator,
+				   enum global_section section)
 {
-	uint64_t stack_size = 0;
-
-	for (uint32_t i = 0; i < method->arguments->len; i++) {
+	for (uint32_t i = 0; i < generator->llir->fields->len; i++) {
 		struct llir_field *field = g_array_index(
-			method->arguments, struct llir_field *, i);
-
-		stack_size += field->value_count * 8;
-		g_hash_table_insert(generator->offsets, field->identifier,
-				    (gpointer)stack_size);
+			generator->llir->fields, struct llir_field *, i);
+		if (field_section(field) == section)
+			generate_global_field(field);
 	}
+}
+
+static void generate_array_initializer(struct code_generator *generator,
+				       struct llir_assignment *assignment)
+{
+	g_print("%sinitializer_%llu:\n", generator->label_prefix,
+		generator->initializer_counter);
+	for (int64_t i = 0; i < assignment->initialize_count; i++)
+		g_print("\t.quad %lld\n", assignment->initialize_values[i]);
 
+	g_hash_table_insert(generator->initializers, assignment,
+			    (gpointer)generator->initializer_counter);
+	generator->initializer_counter++;
+}
+
+static void find_initializers_in_method(struct code_generator *generator,
+					struct llir_method *method)
+{
 	for (uint32_t i = 0; i < method->blocks->len; i++) {
 		struct llir_block *block =
 			g_array_index(method->blocks, struct llir_block *, i);
 
-		for (uint32_t j = 0; j < block->fields->len; j++) {
-			struct llir_field *field = g_array_index(
-				block->fields, struct llir_field *, j);
-
-			stack_size += field->value_count * 8;
-			g_hash_table_insert(generator->offsets,
-					    field->identifier,
-					    (gpointer)stack_size);
+		for (uint32_t j = 0; j < block->assignments->len; j++) {
+			struct llir_assignment *assignment = g_array_index(
+				block->assignments, struct llir_assignment *, j);
+			if (assignment->type ==
+				    LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE &&
+			    assignment->initialize_values != NULL)
+				generate_array_initializer(generator,
+							   assignment);
 		}
 	}
+}
+
+static void generate_array_initializers(struct code_generator *generator)
+{
+	for (uint32_t i = 0; i < generator->llir->methods->len; i++)
+		find_initializers_in_method(
+			generator, g_array_index(generator->llir->methods,
+						 struct llir_method *, i));
+}
+
+static void generate_rodata_directive(void)
+{
+#ifdef __APPLE__
+	g_print(".const\n");
+#else
+	g_print(".section .rodata\n");
+#endif
+}
+
+static void generate_data_section(struct code_generator *generator)
+{
+	g_print(".data\n");
+	generate_global_fields(generator, GLOBAL_SECTION_DATA);
+
+	g_print(".bss\n");
+	generate_global_fields(generator, GLOBAL_SECTION_BSS);
+
+	generate_rodata_directive();
 
-	if (stack_size % 16 != 0)
-		stack_size += 8;
+	// self-contained methods carry their own strings and initializers
+	bool global_constants = !generator->self_contained;
+	if (global_constants)
+		generate_global_strings(generator);
+	generate_global_fields(generator, GLOBAL_SECTION_RODATA);
+	g_print("\t.align 16\n");
+	if (global_constants)
+		generate_array_initializers(generator);
+}
+
+static uint64_t align_frame_size(uint64_t stack_size)
+{
+	return stack_size % 16 != 0 ? stack_size + 8 : stack_size;
+}
+
+static void generate_stack_allocation(struct code_generator *generator,
+				      struct llir_method *method)
+{
+	uint64_t stack_size = align_frame_size(stack_slots_allocate(
+		method, generator->offsets, generator->color_stack_slots));
+
+	if (generator->frame_report)
+		g_printerr("%s: %llu -> %llu bytes\n", method->identifier,
+			   align_frame_size(stack_slots_frame_size(method)),
+			   stack_size);
 
 	g_print("\tsubq $%llu, %%rsp\n", stack_size);
 }
@@ -139,17 +249,6 @@ static void generate_method_arguments(struct code_generator *generator,
 	}
 }
 
-static void generate_global_field_initialization(struct llir_field *field)
-{
-	for (uint32_t i = 0; i < field->value_count; i++) {
-		if (field->values[i] == 0)
-			continue;
-
-		g_print("\tmovq $%llu, %s+%i(%%rip)\n", field->values[i],
-			field->identifier, 8 * i);
-	}
-}
-
 static void generate_method_declaration(struct code_generator *generator,
 					struct llir_method *method)
 {
@@ -166,13 +265,10 @@ static void generate_method_declaration(struct code_generator *generator,
 	generate_stack_allocation(generator, method);
 	generate_method_arguments(generator, method);
 
-	if (g_strcmp0(method->identifier, "main") != 0)
-		return;
-
-	for (uint32_t i = 0; i < generator->llir->fields->len; i++) {
-		struct llir_field *field = g_array_index(
-			generator->llir->fields, struct llir_field *, i);
-		generate_global_field_initialization(field);
+	if (generator->profile_file != NULL &&
+	    g_strcmp0(method->identifier, "main") == 0) {
+		g_print("\tleaq profile.dump(%%rip), %%rdi\n");
+		generate_call("atexit");
 	}
 }
 
@@ -200,8 +296,8 @@ static void load_to_register(struct code_generator *generator,
 	case LLIR_OPERAND_TYPE_STRING:
 		string_id = (uint64_t)g_hash_table_lookup(generator->strings,
 							  operand.string);
-		g_print("\tleaq string_%llu(%%rip), %%%s\n", string_id,
-			destination);
+		g_print("\tleaq %sstring_%llu(%%rip), %%%s\n",
+			generator->label_prefix, string_id, destination);
 		break;
 
 	default:
@@ -232,6 +328,143 @@ static void store_from_register(struct code_generator *generator,
 		g_print("\tmovq %%%s, %s(%%rip)\n", source, destination);
 }
 
+static void load_vector_to_register(struct code_generator *generator,
+				    struct llir_operand operand,
+				    uint32_t destination)
+{
+	g_assert(operand.type == LLIR_OPERAND_TYPE_FIELD);
+	uint64_t offset =
+		(uint64_t)g_hash_table_lookup(generator->offsets, operand.field);
+	g_assert(offset != 0);
+
+	if (generator->avx2)
+		g_print("\tvmovdqu -%llu(%%rbp), %%ymm%u\n", offset, destination);
+	else
+		g_print("\tmovdqu -%llu(%%rbp), %%xmm%u\n", offset, destination);
+}
+
+static void store_vector_from_register(struct code_generator *generator,
+				       char *destination, uint32_t source)
+{
+	uint64_t offset =
+		(uint64_t)g_hash_table_lookup(generator->offsets, destination);
+	g_assert(offset != 0);
+
+	if (generator->avx2)
+		g_print("\tvmovdqu %%ymm%u, -%llu(%%rbp)\n", source, offset);
+	else
+		g_print("\tmovdqu %%xmm%u, -%llu(%%rbp)\n", source, offset);
+}
+
+static void load_element_address(struct code_generator *generator,
+				 char *array, struct llir_operand index)
+{
+	load_array_to_register(generator, array, "r10");
+	load_to_register(generator, index, "r11");
+	g_print("\tleaq 0(%%r10,%%r11,8), %%r10\n");
+}
+
+static void generate_array_initialize(struct code_generator *generator,
+				      struct llir_assignment *assignment)
+{
+	int64_t count = assignment->initialize_count;
+	load_array_to_register(generator, assignment->destination, "rdi");
+
+	if (assignment->initialize_values != NULL) {
+		uint64_t initializer = (uint64_t)g_hash_table_lookup(
+			generator->initializers, assignment);
+		g_print("\tleaq %sinitializer_%llu(%%rip), %%rsi\n",
+			generator->label_prefix, initializer);
+		g_print("\tmovq $%lld, %%rcx\n", count);
+		g_print("\trep movsq\n");
+	} else if (count <= ZERO_FILL_UNROLL_LIMIT) {
+		g_print("\tpxor %%xmm0, %%xmm0\n");
+		for (int64_t i = 0; i + 1 < count; i += 2)
+			g_print("\tmovdqu %%xmm0, %lld(%%rdi)\n", 8 * i);
+		if (count % 2 != 0)
+			g_print("\tmovq $0, %lld(%%rdi)\n", 8 * (count - 1));
+	} else {
+		g_print("\tmovq $%lld, %%rcx\n", count);
+		g_print("\txorl %%eax, %%eax\n");
+		g_print("\trep stosq\n");
+	}
+}
+
+static void generate_vzeroupper(struct code_generator *generator)
+{
+	if (generator->avx2)
+		g_print("\tvzeroupper\n");
+}
+
+static void generate_vector_broadcast(struct code_generator *generator,
+				      struct llir_assignment *assignment)
+{
+	load_to_register(generator, assignment->source, "r10");
+	if (generator->avx2) {
+		g_print("\tvmovq %%r10, %%xmm0\n");
+		g_print("\tvpbroadcastq %%xmm0, %%ymm0\n");
+	} else {
+		g_print("\tmovq %%r10, %%xmm0\n");
+		g_print("\tpunpcklqdq %%xmm0, %%xmm0\n");
+	}
+	store_vector_from_register(generator, assignment->destination, 0);
+}
+
+static void generate_vector_reduce(struct code_generator *generator,
+				   struct llir_assignment *assignment)
+{
+	load_vector_to_register(generator, assignment->source, 0);
+	if (generator->avx2) {
+		g_print("\tvextracti128 $1, %%ymm0, %%xmm1\n");
+		g_print("\tvpaddq %%xmm1, %%xmm0, %%xmm0\n");
+		g_print("\tvpshufd $78, %%xmm0, %%xmm1\n");
+		g_print("\tvpaddq %%xmm1, %%xmm0, %%xmm0\n");
+		g_print("\tvmovq %%xmm0, %%r10\n");
+	} else {
+		g_print("\tpshufd $78, %%xmm0, %%xmm1\n");
+		g_print("\tpaddq %%xmm1, %%xmm0\n");
+		g_print("\tmovq %%xmm0, %%r10\n");
+	}
+	store_from_register(generator, assignment->destination, "r10");
+}
+
+static void generate_vector_binary(struct code_generator *generator,
+				   struct llir_assignment *assignment,
+				   const char *instruction)
+{
+	load_vector_to_register(generator, assignment->left, 0);
+	load_vector_to_register(generator, assignment->right, 1);
+	if (generator->avx2)
+		g_print("\tv%s %%ymm1, %%ymm0, %%ymm0\n", instruction);
+	else
+		g_print("\t%s %%xmm1, %%xmm0\n", instruction);
+	store_vector_from_register(generator, assignment->destination, 0);
+}
+
+static void generate_vector_load(struct code_generator *generator,
+				 struct llir_assignment *assignment)
+{
+	load_element_address(generator, assignment->access_array,
+			     assignment->access_index);
+	if (generator->avx2)
+		g_print("\tvmovdqu 0(%%r10), %%ymm0\n");
+	else
+		g_print("\tmovdqu 0(%%r10), %%xmm0\n");
+	store_vector_from_register(generator, assignment->destination, 0);
+}
+
+static void generate_vector_store(struct code_generator *generator,
+				  struct llir_assignment *assignment)
+{
+	load_element_address(generator, assignment->destination,
+			     assignment->update_index);
+	load_vector_to_register(generator, assignment->update_value, 0);
+	if (generator->avx2)
+		g_print("\tvmovdqu %%ymm0, 0(%%r10)\n");
+	else
+		g_print("\tmovdqu %%xmm0, 0(%%r10)\n");
+}
+
 static void generate_method_call(struct code_generator *generator,
 				 struct llir_assignment *call)
 {
@@ -258,6 +491,7 @@ static void generate_method_call(struct code_generator *generator,
 	}
 
 	g_print("\tmovq $0, %%rax\n");
+	generate_vzeroupper(generator);
 #ifdef __APPLE__
 	g_print("\tcall _%s\n", call->method);
 #else
@@ -400,25 +634,64 @@ static void generate_assignment(struct code_generator *generator,
 		load_to_register(generator, assignment->update_value, "r11");
 		g_print("\tmovq %%r11, 0(%%r10)\n");
 		break;
+	case LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE:
+		generate_array_initialize(generator, assignment);
+		break;
 	case LLIR_ASSIGNMENT_TYPE_METHOD_CALL:
 		generate_method_call(generator, assignment);
 		break;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_BROADCAST:
+		generate_vector_broadcast(generator, assignment);
+		break;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_REDUCE:
+		generate_vector_reduce(generator, assignment);
+		break;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_ADD:
+		generate_vector_binary(generator, assignment, "paddq");
+		break;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT:
+		generate_vector_binary(generator, assignment, "psubq");
+		break;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD:
+		generate_vector_load(generator, assignment);
+		break;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_STORE:
+		generate_vector_store(generator, assignment);
+		break;
 	default:
 		g_assert(!"you fucked up");
 		break;
 	}
 }
 
-static void generate_branch(struct code_generator *generator,
-			    struct llir_branch *branch)
+static enum llir_branch_type invert_branch_type(enum llir_branch_type type)
 {
-	load_to_register(generator, branch->left, "r11");
-	load_to_register(generator, branch->right, "r10");
-
-	g_print("\tcmpq %%r10, %%r11\n");
+	switch (type) {
+	case LLIR_BRANCH_TYPE_EQUAL:
+		return LLIR_BRANCH_TYPE_NOT_EQUAL;
+	case LLIR_BRANCH_TYPE_NOT_EQUAL:
+		return LLIR_BRANCH_TYPE_EQUAL;
+	case LLIR_BRANCH_TYPE_LESS:
+		return LLIR_BRANCH_TYPE_GREATER_EQUAL;
+	case LLIR_BRANCH_TYPE_LESS_EQUAL:
+		return LLIR_BRANCH_TYPE_GREATER;
+	case LLIR_BRANCH_TYPE_GREATER:
+		return LLIR_BRANCH_TYPE_LESS_EQUAL;
+	case LLIR_BRANCH_TYPE_GREATER_EQUAL:
+		return LLIR_BRANCH_TYPE_LESS;
+	default:
+		g_assert(!"you fucked up");
+		return type;
+	}
+}
 
+static void generate_conditional_jump(struct code_generator *generator,
+				      enum llir_branch_type type,
+				      bool unsigned_comparison,
+				      struct llir_block *block)
+{
 	g_print("\t");
-	switch (branch->type) {
+	switch (type) {
 	case LLIR_BRANCH_TYPE_EQUAL:
 		g_print("je");
 		break;
@@ -426,26 +699,26 @@ static void generate_branch(struct code_generator *generator,
 		g_print("jne");
 		break;
 	case LLIR_BRANCH_TYPE_LESS:
-		if (branch->unsigned_comparison)
+		if (unsigned_comparison)
 			g_print("jb");
 		else
 			g_print("jl");
 		break;
 	case LLIR_BRANCH_TYPE_LESS_EQUAL:
-		if (branch->unsigned_comparison)
+		if (unsigned_comparison)
 			g_print("jbe");
 		else
 			g_print("jle");
 
 		break;
 	case LLIR_BRANCH_TYPE_GREATER:
-		if (branch->unsigned_comparison)
+		if (unsigned_comparison)
 			g_print("ja");
 		else
 			g_print("jg");
 		break;
 	case LLIR_BRANCH_TYPE_GREATER_EQUAL:
-		if (branch->unsigned_comparison)
+		if (unsigned_comparison)
 			g_print("jae");
 		else
 			g_print("jge");
@@ -454,7 +727,32 @@ static void generate_branch(struct code_generator *generator,
 		g_assert(!"you fucked up");
 		break;
 	}
-	g_print(" block_%u\n", branch->false_block->id);
+	g_print(" %sblock_%u\n", generator->label_prefix, block->id);
+}
+
+static void generate_branch(struct code_generator *generator,
+			    struct llir_branch *branch, uint32_t next_block)
+{
+	load_to_register(generator, branch->left, "r11");
+	load_to_register(generator, branch->right, "r10");
+
+	g_print("\tcmpq %%r10, %%r11\n");
+
+	if (branch->false_block->id == next_block &&
+	    branch->true_block->id != next_block) {
+		generate_conditional_jump(generator,
+					  invert_branch_type(branch->type),
+					  branch->unsigned_comparison,
+					  branch->true_block);
+		return;
+	}
+
+	generate_conditional_jump(generator, branch->type,
+				  branch->unsigned_comparison,
+				  branch->false_block);
+	if (branch->true_block->id != next_block)
+		g_print("\tjmp %sblock_%u\n", generator->label_prefix,
+			branch->true_block->id);
 }
 
 static void generate_jump(struct code_generator *generator,
@@ -462,13 +760,15 @@ static void generate_jump(struct code_generator *generator,
 {
 	if (generator->pinhole_optimize && (jump->block->id == next_block))
 		return;
-	g_print("\tjmp block_%u\n", jump->block->id);
+	g_print("\tjmp %sblock_%u\n", generator->label_prefix,
+		jump->block->id);
 }
 
 static void generate_return(struct code_generator *generator,
 			    struct llir_return *llir_return)
 {
 	load_to_register(generator, llir_return->source, "rax");
+	generate_vzeroupper(generator);
 	g_print("\tmovq %%rbp, %%rsp\n");
 	g_print("\tpopq %%rbp\n");
 	g_print("\tret\n");
@@ -478,6 +778,7 @@ static void generate_shit_yourself(struct code_generator *generator,
 				   struct llir_shit_yourself *exit)
 {
 	g_print("\tmovq $%lld, %%rdi\n", exit->return_value);
+	generate_vzeroupper(generator);
 #ifdef __APPLE__
 	g_print("\tcall _exit\n");
 #else
@@ -485,13 +786,124 @@ static void generate_shit_yourself(struct code_generator *generator,
 #endif
 }
 
-static void generate_method_body(struct code_generator *generator,
-				 struct llir_method *method)
+static bool is_cold_block(struct llir_block *block)
+{
+	return block->frequency == 0 ||
+	       block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_SHIT_YOURSELF;
+}
+
+static struct llir_block *hot_successor(struct llir_block *block,
+					GHashTable *placed)
+{
+	struct llir_block *successors[2] = { NULL, NULL };
+	if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP) {
+		successors[0] = block->jump->block;
+	} else if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_BRANCH) {
+		successors[0] = block->branch->true_block;
+		successors[1] = block->branch->false_block;
+	}
+
+	struct llir_block *hottest = NULL;
+	for (uint32_t i = 0; i < G_N_ELEMENTS(successors); i++) {
+		struct llir_block *successor = successors[i];
+		if (successor == NULL || is_cold_block(successor) ||
+		    g_hash_table_contains(placed, successor))
+			continue;
+
+		if (hottest == NULL || successor->frequency > hottest->frequency)
+			hottest = successor;
+	}
+
+	return hottest;
+}
+
+static struct llir_block *hottest_block(struct llir_method *method,
+					GHashTable *placed)
 {
+	struct llir_block *hottest = NULL;
+
 	for (uint32_t i = 0; i < method->blocks->len; i++) {
 		struct llir_block *block =
 			g_array_index(method->blocks, struct llir_block *, i);
-		g_print("block_%u:\n", block->id);
+		if (is_cold_block(block) || g_hash_table_contains(placed, block))
+			continue;
+
+		if (hottest == NULL || block->frequency > hottest->frequency)
+			hottest = block;
+	}
+
+	return hottest;
+}
+
+static void place_cold_blocks(struct llir_method *method, GHashTable *placed,
+			      GArray *order, bool shit_yourself)
+{
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (g_hash_table_contains(placed, block) ||
+		    (block->terminal_type ==
+		     LLIR_BLOCK_TERMINAL_TYPE_SHIT_YOURSELF) != shit_yourself)
+			continue;
+
+		g_array_append_val(order, block);
+	}
+}
+
+static GArray *layout_blocks(struct llir_method *method)
+{
+	GArray *order = g_array_new(false, false, sizeof(struct llir_block *));
+	if (!method->profiled) {
+		g_array_append_vals(order, method->blocks->data,
+				    method->blocks->len);
+		return order;
+	}
+
+	// chain hot blocks along their hottest successor so the common path
+	// falls through, then sink never executed and exit blocks to the end
+	GHashTable *placed = g_hash_table_new(g_direct_hash, g_direct_equal);
+	struct llir_block *block =
+		g_array_index(method->blocks, struct llir_block *, 0);
+	while (block != NULL) {
+		for (; block != NULL; block = hot_successor(block, placed)) {
+			g_array_append_val(order, block);
+			g_hash_table_add(placed, block);
+		}
+
+		block = hottest_block(method, placed);
+	}
+
+	place_cold_blocks(method, placed, order, false);
+	place_cold_blocks(method, placed, order, true);
+
+	g_hash_table_unref(placed);
+	return order;
+}
+
+static void generate_profile_counter(struct code_generator *generator,
+				     struct llir_block *block)
+{
+	gpointer slot;
+	bool found = g_hash_table_lookup_extended(
+		generator->profile_slots, GUINT_TO_POINTER(block->profile_id),
+		NULL, &slot);
+	g_assert(found);
+
+	g_print("\tincq profile.counters+%u(%%rip)\n",
+		8 * GPOINTER_TO_UINT(slot));
+}
+
+static void generate_method_body(struct code_generator *generator,
+				 struct llir_method *method)
+{
+	GArray *blocks = layout_blocks(method);
+
+	for (uint32_t i = 0; i < blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(blocks, struct llir_block *, i);
+		g_print("%sblock_%u:\n", generator->label_prefix, block->id);
+		if (generator->profile_file != NULL)
+			generate_profile_counter(generator, block);
 
 		for (uint32_t j = 0; j < block->assignments->len; j++) {
 			struct llir_assignment *assignment =
@@ -501,9 +913,9 @@ static void generate_method_body(struct code_generator *generator,
 		}
 
 		uint32_t next_block_id =
-			(i < (method->blocks->len - 1)) ?
-				g_array_index(method->blocks,
-					      struct llir_block *, i + 1)
+			(i < (blocks->len - 1)) ?
+				g_array_index(blocks, struct llir_block *,
+					      i + 1)
 					->id :
 				-1;
 
@@ -512,7 +924,8 @@ static void generate_method_body(struct code_generator *generator,
 			generate_jump(generator, block->jump, next_block_id);
 			break;
 		case LLIR_BLOCK_TERMINAL_TYPE_BRANCH:
-			generate_branch(generator, block->branch);
+			generate_branch(generator, block->branch,
+					next_block_id);
 			break;
 		case LLIR_BLOCK_TERMINAL_TYPE_RETURN:
 			generate_return(generator, block->llir_return);
@@ -525,6 +938,254 @@ static void generate_method_body(struct code_generator *generator,
 			break;
 		}
 	}
+
+	g_array_free(blocks, true);
+}
+
+static void add_profile_slots(struct code_generator *generator,
+			      struct llir_method *method, GHashTable *origins)
+{
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		gpointer id = GUINT_TO_POINTER(block->profile_id);
+		if (g_hash_table_contains(generator->profile_slots, id))
+			continue;
+
+		char *origin = g_hash_table_lookup(origins, id);
+		struct profile_block profile_block = {
+			.method = origin != NULL ? origin : method->identifier,
+			.id = block->profile_id,
+		};
+
+		g_hash_table_insert(
+			generator->profile_slots, id,
+			GUINT_TO_POINTER(generator->profile_blocks->len));
+		g_array_append_val(generator->profile_blocks, profile_block);
+	}
+}
+
+// counters are assigned before any method is generated so the counter table
+// is the same however the methods are scheduled, and inlined clones count
+// under the method their block came from
+static void assign_profile_slots(struct code_generator *generator)
+{
+	GHashTable *origins = g_hash_table_new(g_direct_hash, g_direct_equal);
+	GArray *methods = generator->llir->methods;
+
+	for (uint32_t i = 0; i < methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(methods, struct llir_method *, i);
+
+		for (uint32_t j = 0; j < method->blocks->len; j++) {
+			struct llir_block *block = g_array_index(
+				method->blocks, struct llir_block *, j);
+			if (block->profile_id == block->id)
+				g_hash_table_insert(origins,
+						    GUINT_TO_POINTER(block->id),
+						    method->identifier);
+		}
+	}
+
+	for (uint32_t i = 0; i < methods->len; i++)
+		add_profile_slots(generator,
+				  g_array_index(methods, struct llir_method *,
+						i),
+				  origins);
+
+	g_hash_table_unref(origins);
+}
+
+static void generate_profile_dump(struct code_generator *generator)
+{
+	g_print("profile.dump:\n");
+	g_print("\tpushq %%rbp\n");
+	g_print("\tmovq %%rsp, %%rbp\n");
+	g_print("\tpushq %%rbx\n");
+	g_print("\tpushq %%r12\n");
+	g_print("\tleaq profile.file(%%rip), %%rdi\n");
+	g_print("\tleaq profile.mode(%%rip), %%rsi\n");
+	generate_call("fopen");
+	g_print("\tcmpq $0, %%rax\n");
+	g_print("\tje profile.done\n");
+	g_print("\tmovq %%rax, %%r12\n");
+	g_print("\tmovq $0, %%rbx\n");
+	g_print("profile.loop:\n");
+	g_print("\tcmpq $%u, %%rbx\n", generator->profile_blocks->len);
+	g_print("\tjge profile.close\n");
+	g_print("\tmovq %%rbx, %%r11\n");
+	g_print("\tshlq $4, %%r11\n");
+	g_print("\tleaq profile.blocks(%%rip), %%r10\n");
+	g_print("\tmovq 0(%%r10, %%r11), %%rdx\n");
+	g_print("\tmovq 8(%%r10, %%r11), %%rcx\n");
+	g_print("\tleaq profile.counters(%%rip), %%r10\n");
+	g_print("\tmovq 0(%%r10, %%rbx, 8), %%r8\n");
+	g_print("\tmovq %%r12, %%rdi\n");
+	g_print("\tleaq profile.format(%%rip), %%rsi\n");
+	g_print("\tmovq $0, %%rax\n");
+	generate_call("fprintf");
+	g_print("\taddq $1, %%rbx\n");
+	g_print("\tjmp profile.loop\n");
+	g_print("profile.close:\n");
+	g_print("\tmovq %%r12, %%rdi\n");
+	generate_call("fclose");
+	g_print("profile.done:\n");
+	g_print("\tpopq %%r12\n");
+	g_print("\tpopq %%rbx\n");
+	g_print("\tpopq %%rbp\n");
+	g_print("\tret\n");
+}
+
+static void generate_profile_tables(struct code_generator *generator)
+{
+	uint32_t count = generator->profile_blocks->len;
+
+	g_print(".bss\n");
+	g_print("\t.align 16\n");
+	g_print("profile.counters:\n");
+	g_print("\t.zero %u\n", 8 * MAX(count, 1));
+
+	g_print(".data\n");
+	g_print("\t.align 16\n");
+	g_print("profile.blocks:\n");
+	for (uint32_t i = 0; i < count; i++) {
+		struct profile_block *profile_block = &g_array_index(
+			generator->profile_blocks, struct profile_block, i);
+		g_print("\t.quad profile.method.%s, %u\n",
+			profile_block->method, profile_block->id);
+	}
+
+#ifdef __APPLE__
+	g_print(".const\n");
+#else
+	g_print(".section .rodata\n");
+#endif
+	for (uint32_t i = 0; i < generator->llir->methods->len; i++) {
+		struct llir_method *method = g_array_index(
+			generator->llir->methods, struct llir_method *, i);
+		g_print("profile.method.%s:\n", method->identifier);
+		g_print("\t.string \"%s\"\n", method->identifier);
+	}
+
+	char *file = g_strescape(generator->profile_file, NULL);
+	g_print("profile.file:\n");
+	g_print("\t.string \"%s\"\n", file);
+	g_print("profile.mode:\n");
+	g_print("\t.string \"w\"\n");
+	g_print("profile.format:\n");
+	g_print("\t.string \"%%s %%llu %%llu\\n\"\n");
+	g_free(file);
+}
+
+static void generate_method_code(struct code_generator *generator,
+				 struct llir_method *method)
+{
+	time_report_begin("method", method->identifier);
+	generate_method_declaration(generator, method);
+	generate_method_body(generator, method);
+	time_report_end();
+}
+
+static void generate_self_contained_method(struct code_generator *generator,
+					   struct llir_method *method)
+{
+	// a cached or streamed method is emitted without the rest of the
+	// program, so its strings, initializers and blocks get labels of its
+	// own
+	char *label_prefix = g_strconcat(method->identifier, ".", NULL);
+	struct code_generator method_generator = *generator;
+	method_generator.label_prefix = label_prefix;
+	method_generator.strings = g_hash_table_new(g_str_hash, g_str_equal);
+	method_generator.string_counter = 1;
+	method_generator.initializers =
+		g_hash_table_new(g_direct_hash, g_direct_equal);
+	method_generator.initializer_counter = 0;
+
+	generate_rodata_directive();
+	find_strings_in_method(&method_generator, method);
+	g_print("\t.align 16\n");
+	find_initializers_in_method(&method_generator, method);
+	g_print(".text\n");
+	generate_method_code(&method_generator, method);
+
+	g_hash_table_unref(method_generator.strings);
+	g_hash_table_unref(method_generator.initializers);
+	g_free(label_prefix);
+}
+
+static void generate_method(struct code_generator *generator,
+			    struct llir_method *method)
+{
+	if (generator->self_contained)
+		generate_self_contained_method(generator, method);
+	else
+		generate_method_code(generator, method);
+}
+
+static void generate_method_job(gpointer data, gpointer user_data)
+{
+	struct method_output *output = data;
+
+	// strings, initializers and profile counters are only read once the
+	// data section is out, so each thread just needs its own frame offsets
+	struct code_generator generator = *output->generator;
+	generator.offsets = g_hash_table_new(g_str_hash, g_str_equal);
+
+	output_capture_begin(output->text, output->report);
+	generate_method(&generator, output->method);
+	output_capture_end();
+
+	g_hash_table_unref(generator.offsets);
+}
+
+static void generate_buffered_methods(struct code_generator *generator)
+{
+	GArray *methods = generator->llir->methods;
+	struct method_output *outputs =
+		g_new(struct method_output, methods->len);
+
+	GThreadPool *pool = g_thread_pool_new(generate_method_job, NULL,
+					      MIN(generator->jobs,
+						  methods->len),
+					      false, NULL);
+	for (uint32_t i = 0; i < methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(methods, struct llir_method *, i);
+		char *cached_text =
+			generator->method_texts != NULL ?
+				g_hash_table_lookup(generator->method_texts,
+						    method) :
+				NULL;
+
+		outputs[i] = (struct method_output){
+			.generator = generator,
+			.method = method,
+			.text = g_string_new(cached_text),
+			.report = g_string_new(NULL),
+		};
+		if (cached_text == NULL)
+			g_thread_pool_push(pool, &outputs[i], NULL);
+	}
+	g_thread_pool_free(pool, false, true);
+
+	// concatenate in method order so the output does not depend on the
+	// schedule
+	for (uint32_t i = 0; i < methods->len; i++) {
+		g_print("%s", outputs[i].text->str);
+		g_printerr("%s", outputs[i].report->str);
+
+		if (generator->method_texts != NULL &&
+		    !g_hash_table_contains(generator->method_texts,
+					   outputs[i].method))
+			g_hash_table_insert(generator->method_texts,
+					    outputs[i].method,
+					    g_strdup(outputs[i].text->str));
+
+		g_string_free(outputs[i].text, true);
+		g_string_free(outputs[i].report, true);
+	}
+
+	g_free(outputs);
 }
 
 static void generate_text_section(struct code_generator *generator)
@@ -533,37 +1194,108 @@ static void generate_text_section(struct code_generator *generator)
 
 	struct llir *llir = generator->llir;
 
-	for (uint32_t i = 0; i < llir->methods->len; i++) {
-		struct llir_method *method =
-			g_array_index(llir->methods, struct llir_method *, i);
-		generate_method_declaration(generator, method);
-		generate_method_body(generator, method);
+	// method texts are handed back to the caller, so they always go
+	// through the per-method buffers
+	if ((generator->jobs > 1 && llir->methods->len > 1) ||
+	    generator->method_texts != NULL) {
+		generate_buffered_methods(generator);
+	} else {
+		for (uint32_t i = 0; i < llir->methods->len; i++)
+			generate_method(generator,
+					g_array_index(llir->methods,
+						      struct llir_method *,
+						      i));
+	}
+
+	if (generator->profile_file != NULL) {
+		generate_profile_dump(generator);
+		generate_profile_tables(generator);
 	}
 }
 
-struct code_generator *code_generator_new(bool pinhole_optimize)
+struct code_generator *code_generator_new(bool pinhole_optimize, bool avx2,
+					  bool color_stack_slots,
+					  bool frame_report, uint32_t jobs,
+					  const char *profile_file,
+					  GHashTable *method_texts)
 {
 	struct code_generator *generator = g_new(struct code_generator, 1);
 	generator->offsets = g_hash_table_new(g_str_hash, g_str_equal);
 	generator->pinhole_optimize = pinhole_optimize;
+	generator->avx2 = avx2;
+	generator->color_stack_slots = color_stack_slots;
+	generator->frame_report = frame_report;
+	generator->jobs = jobs;
+	generator->profile_file = g_strdup(profile_file);
+	generator->method_texts = method_texts;
+	generator->self_contained = method_texts != NULL;
+	generator->profile_slots =
+		g_hash_table_new(g_direct_hash, g_direct_equal);
+	generator->profile_blocks =
+		g_array_new(false, false, sizeof(struct profile_block));
 	return generator;
 }
 
-void code_generator_generate(struct code_generator *generator,
-			     struct llir *llir)
+static void start_program(struct code_generator *generator, struct llir *llir)
 {
 	generator->llir = llir;
+	generator->label_prefix = "";
 	generator->strings = g_hash_table_new(g_str_hash, g_str_equal);
 	generator->string_counter = 1;
+	generator->initializers =
+		g_hash_table_new(g_direct_hash, g_direct_equal);
+	generator->initializer_counter = 0;
 
+	time_report_begin("data", NULL);
 	generate_data_section(generator);
-	generate_text_section(generator);
+	time_report_end();
+}
 
+static void finish_program(struct code_generator *generator)
+{
 	g_hash_table_unref(generator->strings);
+	g_hash_table_unref(generator->initializers);
+}
+
+void code_generator_generate(struct code_generator *generator,
+			     struct llir *llir)
+{
+	start_program(generator, llir);
+	if (generator->profile_file != NULL)
+		assign_profile_slots(generator);
+	generate_text_section(generator);
+	finish_program(generator);
+}
+
+void code_generator_start(struct code_generator *generator, struct llir *llir)
+{
+	g_assert(generator->profile_file == NULL);
+
+	// the methods arrive one at a time after the data section is out
+	generator->self_contained = true;
+	start_program(generator, llir);
+	g_print(".text\n");
+}
+
+void code_generator_generate_method(struct code_generator *generator,
+				    struct llir_method *method)
+{
+	// the frame offsets of the previous method point into LLIR that has
+	// been freed by now
+	g_hash_table_remove_all(generator->offsets);
+	generate_method(generator, method);
+}
+
+void code_generator_finish(struct code_generator *generator)
+{
+	finish_program(generator);
 }
 
 void code_generator_free(struct code_generator *generator)
 {
 	g_hash_table_unref(generator->offsets);
+	g_hash_table_unref(generator->profile_slots);
+	g_array_free(generator->profile_blocks, true);
+	g_free(generator->profile_file);
 	g_free(generator);
 }
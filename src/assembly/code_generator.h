@@ -1,18 +1,40 @@
 #pragma once
 #include "assembly/llir.h"
+#include "assembly/stack_slots.h"
 #include "assembly/symbol_table.h"
 
 struct code_generator {
 	struct llir *llir;
+	const char *label_prefix;
 	GHashTable *strings;
 	uint64_t string_counter;
+	GHashTable *initializers;
+	uint64_t initializer_counter;
 	GHashTable *offsets;
 	bool pinhole_optimize;
+	bool avx2;
+	bool color_stack_slots;
+	bool frame_report;
+	uint32_t jobs;
+	char *profile_file;
+	GHashTable *profile_slots;
+	GArray *profile_blocks;
+	GHashTable *method_texts;
+	bool self_contained;
 };
 
-struct code_generator *code_generator_new(bool pinhole_optimize);
+struct code_generator *code_generator_new(bool pinhole_optimize, bool avx2,
+					  bool color_stack_slots,
+					  bool frame_report, uint32_t jobs,
+					  const char *profile_file,
+					  GHashTable *method_texts);
 
 void code_generator_generate(struct code_generator *generator,
 			     struct llir *llir);
 
+void code_generator_start(struct code_generator *generator, struct llir *llir);
+void code_generator_generate_method(struct code_generator *generator,
+				    struct llir_method *method);
+void code_generator_finish(struct code_generator *generator);
+
 void code_generator_free(struct code_generator *generator);
@@ -6,6 +6,7 @@ struct llir *llir_new(void)
 
 	llir->fields = g_array_new(false, false, sizeof(struct llir_field *));
 	llir->methods = g_array_new(false, false, sizeof(struct llir_method *));
+	llir->max_frequency = 0;
 
 	return llir;
 }
@@ -20,6 +21,24 @@ void llir_add_method(struct llir *llir, struct llir_method *method)
 	g_array_append_val(llir->methods, method);
 }
 
+uint32_t llir_next_block_id(struct llir *llir)
+{
+	uint32_t block_id = 0;
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+
+		for (uint32_t j = 0; j < method->blocks->len; j++) {
+			struct llir_block *block = g_array_index(
+				method->blocks, struct llir_block *, j);
+			block_id = MAX(block_id, block->id + 1);
+		}
+	}
+
+	return block_id;
+}
+
 void llir_print(struct llir *llir)
 {
 	for (uint32_t i = 0; i < llir->methods->len; i++) {
@@ -115,6 +134,20 @@ void llir_iterate(struct llir *llir, iterator_callback_t method,
 	}
 }
 
+bool llir_iterate_method(struct llir *llir, struct llir_method *method,
+			 iterator_callback_t block,
+			 iterator_callback_t assignment,
+			 iterator_callback_t terminal, bool forward)
+{
+	struct llir_iterator iterator = { 0 };
+
+	iterator.llir = llir;
+	iterator.method = method;
+
+	iterate_method(&iterator, block, assignment, terminal, forward);
+	return iterator.changed;
+}
+
 void llir_free(struct llir *llir)
 {
 	for (uint32_t i = 0; i < llir->fields->len; i++) {
@@ -142,6 +175,7 @@ struct llir_method *llir_method_new(char *identifier)
 	method->arguments =
 		g_array_new(false, false, sizeof(struct llir_field *));
 	method->blocks = g_array_new(false, false, sizeof(struct llir_block *));
+	method->profiled = false;
 
 	return method;
 }
@@ -198,6 +232,8 @@ struct llir_block *llir_block_new(uint32_t id)
 	block->terminal_type = LLIR_BLOCK_TERMINAL_TYPE_UNKNOWN;
 	block->terminal = NULL;
 	block->id = id;
+	block->profile_id = id;
+	block->frequency = 0;
 	block->predecessors =
 		g_array_new(false, false, sizeof(struct llir_block *));
 
@@ -237,9 +273,70 @@ void llir_block_set_terminal(struct llir_block *block,
 	}
 }
 
+void llir_block_replace_predecessor(struct llir_block *block,
+				    struct llir_block *old_predecessor,
+				    struct llir_block *new_predecessor)
+{
+	for (uint32_t i = 0; i < block->predecessors->len; i++) {
+		struct llir_block **predecessor = &g_array_index(
+			block->predecessors, struct llir_block *, i);
+		if (*predecessor == old_predecessor)
+			*predecessor = new_predecessor;
+	}
+
+	for (uint32_t i = 0; i < block->assignments->len; i++) {
+		struct llir_assignment *assignment = g_array_index(
+			block->assignments, struct llir_assignment *, i);
+		if (assignment->type != LLIR_ASSIGNMENT_TYPE_PHI)
+			continue;
+
+		for (uint32_t j = 0; j < assignment->phi_blocks->len; j++) {
+			struct llir_block **phi_block = &g_array_index(
+				assignment->phi_blocks, struct llir_block *, j);
+			if (*phi_block == old_predecessor)
+				*phi_block = new_predecessor;
+		}
+	}
+}
+
+void llir_block_remove_predecessor(struct llir_block *block,
+				   struct llir_block *predecessor)
+{
+	for (uint32_t i = 0; i < block->predecessors->len; i++) {
+		if (g_array_index(block->predecessors, struct llir_block *,
+				  i) != predecessor)
+			continue;
+
+		g_array_remove_index(block->predecessors, i);
+		break;
+	}
+
+	for (uint32_t i = 0; i < block->assignments->len; i++) {
+		struct llir_assignment *assignment = g_array_index(
+			block->assignments, struct llir_assignment *, i);
+		if (assignment->type != LLIR_ASSIGNMENT_TYPE_PHI)
+			continue;
+
+		for (uint32_t j = 0; j < assignment->phi_blocks->len; j++) {
+			if (g_array_index(assignment->phi_blocks,
+					  struct llir_block *,
+					  j) != predecessor)
+				continue;
+
+			g_array_remove_index(assignment->phi_arguments, j);
+			g_array_remove_index(assignment->phi_blocks, j);
+			break;
+		}
+	}
+}
+
 void llir_block_print(struct llir_block *block)
 {
-	g_print("\tblock %u:\n", block->id);
+	if (block->frequency > 0)
+		g_print("\tblock %u (frequency %llu):\n", block->id,
+			block->frequency);
+	else
+		g_print("\tblock %u:\n", block->id);
 
 	for (uint32_t i = 0; i < block->assignments->len; i++) {
 		struct llir_assignment *assignment = g_array_index(
@@ -316,6 +413,7 @@ struct llir_field *llir_field_new(char *identifier, uint32_t scope_level,
 		field->identifier =
 			g_strdup_printf("%s@%u", identifier, scope_level);
 	field->is_array = is_array;
+	field->is_constant = false;
 	field->values = g_new0(int64_t, length);
 	field->value_count = length;
 
@@ -439,6 +537,49 @@ llir_assignment_new_array_access(struct llir_operand index, char *array,
 	return assignment;
 }
 
+struct llir_assignment *
+llir_assignment_new_array_initialize(int64_t count, int64_t *values,
+				     char *destination)
+{
+	struct llir_assignment *assignment = g_new(struct llir_assignment, 1);
+
+	assignment->type = LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE;
+	assignment->destination = destination;
+	assignment->initialize_count = count;
+	assignment->initialize_values = NULL;
+
+	for (int64_t i = 0; i < count; i++) {
+		if (values[i] == 0)
+			continue;
+
+		assignment->initialize_values =
+			g_memdup2(values, count * sizeof(int64_t));
+		break;
+	}
+
+	return assignment;
+}
+
+struct llir_assignment *
+llir_assignment_new_vector_load(struct llir_operand index, char *array,
+				char *destination)
+{
+	struct llir_assignment *assignment =
+		llir_assignment_new_array_access(index, array, destination);
+	assignment->type = LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD;
+	return assignment;
+}
+
+struct llir_assignment *
+llir_assignment_new_vector_store(struct llir_operand index,
+				 struct llir_operand value, char *destination)
+{
+	struct llir_assignment *assignment =
+		llir_assignment_new_array_update(index, value, destination);
+	assignment->type = LLIR_ASSIGNMENT_TYPE_VECTOR_STORE;
+	return assignment;
+}
+
 struct llir_assignment *llir_assignment_new_method_call(char *method,
 							uint32_t argument_count,
 							char *destination)
@@ -476,6 +617,31 @@ void llir_assignment_add_phi_argument(struct llir_assignment *assignment,
 	g_array_append_val(assignment->phi_blocks, block);
 }
 
+struct llir_assignment *
+llir_assignment_copy(struct llir_assignment *assignment)
+{
+	struct llir_assignment *copy = g_new(struct llir_assignment, 1);
+	*copy = *assignment;
+
+	if (assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL) {
+		copy->arguments = g_new(struct llir_operand,
+					assignment->argument_count);
+		for (uint32_t i = 0; i < assignment->argument_count; i++)
+			copy->arguments[i] = assignment->arguments[i];
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_PHI) {
+		copy->phi_arguments = g_array_copy(assignment->phi_arguments);
+		copy->phi_blocks = g_array_copy(assignment->phi_blocks);
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE &&
+		   assignment->initialize_values != NULL) {
+		copy->initialize_values =
+			g_memdup2(assignment->initialize_values,
+				  assignment->initialize_count *
+					  sizeof(int64_t));
+	}
+
+	return copy;
+}
+
 void llir_assignment_print(struct llir_assignment *assignment)
 {
 	static const char *BINARY_OPERATOR_TO_STRING[] = {
@@ -490,11 +656,15 @@ void llir_assignment_print(struct llir_assignment *assignment)
 		[LLIR_ASSIGNMENT_TYPE_MULTIPLY] = "*",
 		[LLIR_ASSIGNMENT_TYPE_DIVIDE] = "/",
 		[LLIR_ASSIGNMENT_TYPE_MODULO] = "%",
+		[LLIR_ASSIGNMENT_TYPE_VECTOR_ADD] = "+v",
+		[LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT] = "-v",
 	};
 
 	static const char *UNARY_OPERATOR_TO_STRING[] = {
 		[LLIR_ASSIGNMENT_TYPE_NOT] = "!",
 		[LLIR_ASSIGNMENT_TYPE_NEGATE] = "-",
+		[LLIR_ASSIGNMENT_TYPE_VECTOR_BROADCAST] = "broadcast ",
+		[LLIR_ASSIGNMENT_TYPE_VECTOR_REDUCE] = "reduce ",
 	};
 
 	g_print("\t\t%s", assignment->destination);
@@ -502,18 +672,39 @@ void llir_assignment_print(struct llir_assignment *assignment)
 		g_print(" = ");
 		llir_operand_print(assignment->source);
 	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_NOT ||
-		   assignment->type == LLIR_ASSIGNMENT_TYPE_NEGATE) {
+		   assignment->type == LLIR_ASSIGNMENT_TYPE_NEGATE ||
+		   llir_assignment_is_vector_unary(assignment)) {
 		g_print(" = %s", UNARY_OPERATOR_TO_STRING[assignment->type]);
 		llir_operand_print(assignment->source);
-	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE) {
-		g_print("[");
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE ||
+		   assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_STORE) {
+		g_print("[%s",
+			assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_STORE ?
+				"v " :
+				"");
 		llir_operand_print(assignment->update_index);
 		g_print("] = ");
 		llir_operand_print(assignment->update_value);
-	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS) {
-		g_print(" = %s[", assignment->access_array);
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS ||
+		   assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD) {
+		g_print(" = %s[%s", assignment->access_array,
+			assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD ?
+				"v " :
+				"");
 		llir_operand_print(assignment->access_index);
 		g_print("]");
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE) {
+		g_print(" = {");
+		if (assignment->initialize_values == NULL)
+			g_print("0 x %lld", assignment->initialize_count);
+		for (int64_t i = 0; assignment->initialize_values != NULL &&
+				    i < assignment->initialize_count;
+		     i++) {
+			g_print("%lld", assignment->initialize_values[i]);
+			if (i != assignment->initialize_count - 1)
+				g_print(", ");
+		}
+		g_print("}");
 	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL) {
 		g_print(" = %s(", assignment->method);
 		for (uint32_t i = 0; i < assignment->argument_count; i++) {
@@ -587,6 +778,30 @@ bool llir_assignment_is_binary(struct llir_assignment *assignment)
 	}
 }
 
+bool llir_assignment_is_vector_unary(struct llir_assignment *assignment)
+{
+	switch (assignment->type) {
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_BROADCAST:
+		return true;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_REDUCE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool llir_assignment_is_vector_binary(struct llir_assignment *assignment)
+{
+	switch (assignment->type) {
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_ADD:
+		return true;
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT:
+		return true;
+	default:
+		return false;
+	}
+}
+
 void llir_assignment_free(struct llir_assignment *assignment)
 {
 	if (assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL) {
@@ -594,6 +809,8 @@ void llir_assignment_free(struct llir_assignment *assignment)
 	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_PHI) {
 		g_array_free(assignment->phi_arguments, true);
 		g_array_free(assignment->phi_blocks, true);
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE) {
+		g_free(assignment->initialize_values);
 	}
 
 	g_free(assignment);
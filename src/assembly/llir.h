@@ -4,11 +4,13 @@
 struct llir {
 	GArray *fields;
 	GArray *methods;
+	uint64_t max_frequency;
 };
 
 struct llir_field {
 	char *identifier;
 	bool is_array;
+	bool is_constant;
 	int64_t value_count;
 	int64_t *values;
 };
@@ -17,6 +19,7 @@ struct llir_method {
 	char *identifier;
 	GArray *arguments;
 	GArray *blocks;
+	bool profiled;
 };
 
 struct llir_block {
@@ -40,6 +43,8 @@ struct llir_block {
 	};
 
 	uint32_t id;
+	uint32_t profile_id;
+	uint64_t frequency;
 	GArray *predecessors;
 };
 
@@ -75,8 +80,15 @@ struct llir_assignment {
 		LLIR_ASSIGNMENT_TYPE_NOT,
 		LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE,
 		LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS,
+		LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE,
 		LLIR_ASSIGNMENT_TYPE_METHOD_CALL,
 		LLIR_ASSIGNMENT_TYPE_PHI,
+		LLIR_ASSIGNMENT_TYPE_VECTOR_BROADCAST,
+		LLIR_ASSIGNMENT_TYPE_VECTOR_REDUCE,
+		LLIR_ASSIGNMENT_TYPE_VECTOR_ADD,
+		LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT,
+		LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD,
+		LLIR_ASSIGNMENT_TYPE_VECTOR_STORE,
 	} type;
 
 	char *destination;
@@ -95,6 +107,10 @@ struct llir_assignment {
 			struct llir_operand access_index;
 			char *access_array;
 		};
+		struct {
+			int64_t initialize_count;
+			int64_t *initialize_values;
+		};
 		struct {
 			char *method;
 			uint32_t argument_count;
@@ -146,6 +162,7 @@ struct llir_iterator {
 	struct llir_block *block;
 	uint32_t assignment_index;
 	struct llir_assignment *assignment;
+	bool changed;
 };
 
 typedef void (*iterator_callback_t)(struct llir_iterator *);
@@ -153,10 +170,15 @@ typedef void (*iterator_callback_t)(struct llir_iterator *);
 struct llir *llir_new(void);
 void llir_add_field(struct llir *llir, struct llir_field *field);
 void llir_add_method(struct llir *llir, struct llir_method *method);
+uint32_t llir_next_block_id(struct llir *llir);
 void llir_print(struct llir *llir);
 void llir_iterate(struct llir *llir, iterator_callback_t method,
 		  iterator_callback_t block, iterator_callback_t assignment,
 		  iterator_callback_t terminal, bool forward);
+bool llir_iterate_method(struct llir *llir, struct llir_method *method,
+			 iterator_callback_t block,
+			 iterator_callback_t assignment,
+			 iterator_callback_t terminal, bool forward);
 void llir_free(struct llir *llir);
 
 struct llir_method *llir_method_new(char *identifier);
@@ -176,6 +198,11 @@ void llir_block_add_assignment(struct llir_block *block,
 void llir_block_set_terminal(struct llir_block *block,
 			     enum llir_block_terminal_type type,
 			     void *terminal);
+void llir_block_replace_predecessor(struct llir_block *block,
+				    struct llir_block *old_predecessor,
+				    struct llir_block *new_predecessor);
+void llir_block_remove_predecessor(struct llir_block *block,
+				   struct llir_block *predecessor);
 void llir_block_print(struct llir_block *block);
 void llir_block_free(struct llir_block *block);
 
@@ -202,6 +229,15 @@ llir_assignment_new_array_update(struct llir_operand index,
 struct llir_assignment *
 llir_assignment_new_array_access(struct llir_operand index, char *array,
 				 char *destination);
+struct llir_assignment *
+llir_assignment_new_array_initialize(int64_t count, int64_t *values,
+				     char *destination);
+struct llir_assignment *
+llir_assignment_new_vector_load(struct llir_operand index, char *array,
+				char *destination);
+struct llir_assignment *
+llir_assignment_new_vector_store(struct llir_operand index,
+				 struct llir_operand value, char *destination);
 struct llir_assignment *llir_assignment_new_method_call(char *method,
 							uint32_t argument_count,
 							char *destination);
@@ -209,9 +245,13 @@ struct llir_assignment *llir_assignment_new_phi(char *destination);
 void llir_assignment_add_phi_argument(struct llir_assignment *assignment,
 				      struct llir_operand argument,
 				      struct llir_block *block);
+struct llir_assignment *
+llir_assignment_copy(struct llir_assignment *assignment);
 void llir_assignment_print(struct llir_assignment *assignment);
 bool llir_assignment_is_unary(struct llir_assignment *assignment);
 bool llir_assignment_is_binary(struct llir_assignment *assignment);
+bool llir_assignment_is_vector_unary(struct llir_assignment *assignment);
+bool llir_assignment_is_vector_binary(struct llir_assignment *assignment);
 void llir_assignment_free(struct llir_assignment *assignment);
 
 struct llir_branch *
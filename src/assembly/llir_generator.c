@@ -1,5 +1,39 @@
 #include "assembly/llir_generator.h"
 
+#define UNROLL_FULL_TRIP_COUNT_LIMIT 16
+#define UNROLL_FULL_SIZE_LIMIT 64
+#define UNROLL_PARTIAL_SIZE_LIMIT 24
+#define UNROLL_STEP_LIMIT (1 << 16)
+#define UNROLL_BOUND_LIMIT ((int64_t)1 << 48)
+#define VECTORIZE_STATEMENT_LIMIT 16
+#define PROFILE_LONG_TRIP_COUNT 64
+#define PROFILE_LONG_UNROLL_FACTOR 8
+
+struct counted_loop {
+	struct ir_location *variable;
+	enum ir_binary_operator comparison;
+	struct ir_expression *bound;
+	int64_t step;
+};
+
+struct profile_loop {
+	uint32_t preheader;
+	uint32_t header;
+	uint32_t end;
+	uint32_t unroll_factor;
+	bool repeated;
+	uint64_t entry_frequency;
+	uint64_t header_frequency;
+};
+
+struct vector_loop {
+	char *variable;
+	char *last;
+	GHashTable *broadcasts;
+	GHashTable *accumulators;
+	char *zero;
+};
+
 static void add_move(struct llir_generator *assembly,
 		     struct llir_operand source, char *destination)
 {
@@ -45,12 +79,13 @@ static void add_binary_assignment(struct llir_generator *assembly,
 	llir_block_add_assignment(assembly->current_block, assignment);
 }
 
-static char *new_temporary(struct llir_generator *assembly, char prefix)
+static char *new_temporary(struct llir_generator *assembly, char prefix,
+			   int64_t length)
 {
 	char *identifier =
 		g_strdup_printf("%c%u", prefix, assembly->temporary_counter++);
 
-	struct llir_field *field = llir_field_new(identifier, 0, false, 1);
+	struct llir_field *field = llir_field_new(identifier, 0, false, length);
 	llir_block_add_field(assembly->current_block, field);
 
 	symbol_table_set(assembly->symbol_table, identifier, field);
@@ -61,17 +96,24 @@ static char *new_temporary(struct llir_generator *assembly, char prefix)
 
 static char *new_local_temporary(struct llir_generator *assembly)
 {
-	return new_temporary(assembly, '$');
+	return new_temporary(assembly, '$', 1);
 }
 
 static char *new_non_local_temporary(struct llir_generator *assembly)
 {
-	return new_temporary(assembly, '#');
+	return new_temporary(assembly, '#', 1);
+}
+
+static char *new_vector_temporary(struct llir_generator *assembly)
+{
+	return new_temporary(assembly, '$', assembly->vector_width);
 }
 
 static struct llir_block *new_block(struct llir_generator *assembly)
 {
-	return llir_block_new(assembly->block_counter++);
+	struct llir_block *block = llir_block_new(assembly->block_counter++);
+	block->frequency = assembly->estimated_frequency;
+	return block;
 }
 
 static void next_block(struct llir_generator *assembly,
@@ -157,6 +199,41 @@ static void generate_bounds_check(struct llir_generator *assembly,
 	next_block(assembly, false_block);
 }
 
+static bool expression_has_call(struct ir_expression *ir_expression)
+{
+	switch (ir_expression->type) {
+	case IR_EXPRESSION_TYPE_BINARY:
+		return expression_has_call(
+			       ir_expression->binary_expression->left) ||
+		       expression_has_call(
+			       ir_expression->binary_expression->right);
+	case IR_EXPRESSION_TYPE_NOT:
+		return expression_has_call(ir_expression->not_expression);
+	case IR_EXPRESSION_TYPE_NEGATE:
+		return expression_has_call(ir_expression->negate_expression);
+	case IR_EXPRESSION_TYPE_METHOD_CALL:
+		return true;
+	case IR_EXPRESSION_TYPE_LOCATION:
+		return ir_expression->location->index != NULL &&
+		       expression_has_call(ir_expression->location->index);
+	default:
+		return false;
+	}
+}
+
+static struct llir_operand
+materialize_global(struct llir_generator *assembly,
+		   struct llir_operand operand)
+{
+	if (operand.type != LLIR_OPERAND_TYPE_FIELD ||
+	    !llir_operand_is_field_global(operand))
+		return operand;
+
+	char *destination = new_local_temporary(assembly);
+	add_move(assembly, operand, destination);
+	return llir_operand_from_field(destination);
+}
+
 static struct llir_operand generate_location(struct llir_generator *assembly,
 					     struct ir_location *ir_location)
 {
@@ -164,17 +241,13 @@ static struct llir_operand generate_location(struct llir_generator *assembly,
 						    ir_location->identifier);
 	g_assert(field != NULL);
 
-	struct llir_operand source = llir_operand_from_field(field->identifier);
-	char *destination = new_local_temporary(assembly);
+	if (ir_location->index == NULL)
+		return llir_operand_from_field(field->identifier);
 
-	if (ir_location->index == NULL) {
-		add_move(assembly, source, destination);
-	} else {
-		struct llir_operand index =
-			generate_expression(assembly, ir_location->index);
-		add_array_access(assembly, index, field->identifier,
-				 destination);
-	}
+	struct llir_operand index =
+		generate_expression(assembly, ir_location->index);
+	char *destination = new_local_temporary(assembly);
+	add_array_access(assembly, index, field->identifier, destination);
 
 	return llir_operand_from_field(destination);
 }
@@ -182,12 +255,23 @@ static struct llir_operand generate_location(struct llir_generator *assembly,
 static struct llir_operand generate_literal(struct llir_generator *assembly,
 					    struct ir_literal *literal)
 {
-	int64_t value = literal_to_int64(literal);
-	struct llir_operand source = llir_operand_from_literal(value);
-	char *destination = new_local_temporary(assembly);
+	return llir_operand_from_literal(literal_to_int64(literal));
+}
 
-	add_move(assembly, source, destination);
-	return llir_operand_from_field(destination);
+static bool later_argument_has_call(struct ir_method_call *ir_method_call,
+				    uint32_t index)
+{
+	for (uint32_t i = index + 1; i < ir_method_call->arguments->len; i++) {
+		struct ir_method_call_argument *ir_method_call_argument =
+			g_array_index(ir_method_call->arguments,
+				      struct ir_method_call_argument *, i);
+		if (ir_method_call_argument->type ==
+			    IR_METHOD_CALL_ARGUMENT_TYPE_EXPRESSION &&
+		    expression_has_call(ir_method_call_argument->expression))
+			return true;
+	}
+
+	return false;
 }
 
 static struct llir_operand
@@ -214,6 +298,9 @@ generate_method_call(struct llir_generator *assembly,
 			argument = generate_expression(
 				assembly, ir_method_call_argument->expression);
 
+		if (later_argument_has_call(ir_method_call, i))
+			argument = materialize_global(assembly, argument);
+
 		call->arguments[i] = argument;
 	}
 
@@ -225,12 +312,7 @@ static struct llir_operand
 generate_len_expression(struct llir_generator *assembly,
 			struct ir_length_expression *length_expression)
 {
-	struct llir_operand source =
-		llir_operand_from_literal(length_expression->length);
-	char *destination = new_local_temporary(assembly);
-
-	add_move(assembly, source, destination);
-	return llir_operand_from_field(destination);
+	return llir_operand_from_literal(length_expression->length);
 }
 
 static struct llir_operand
@@ -311,6 +393,8 @@ generate_binary_expression(struct llir_generator *assembly,
 
 	struct llir_operand left =
 		generate_expression(assembly, ir_binary_expression->left);
+	if (expression_has_call(ir_binary_expression->right))
+		left = materialize_global(assembly, left);
 	struct llir_operand right =
 		generate_expression(assembly, ir_binary_expression->right);
 	char *destination = new_local_temporary(assembly);
@@ -379,6 +463,9 @@ static void generate_assignment(struct llir_generator *assembly,
 	if (ir_assignment->location->index != NULL) {
 		index = generate_expression(assembly,
 					    ir_assignment->location->index);
+		if (ir_assignment->expression != NULL &&
+		    expression_has_call(ir_assignment->expression))
+			index = materialize_global(assembly, index);
 		generate_bounds_check(assembly, index, field->value_count);
 	}
 
@@ -486,15 +573,301 @@ static void generate_for_update(struct llir_generator *assembly,
 	}
 }
 
-static void generate_for_statement(struct llir_generator *assembly,
-				   struct ir_for_statement *ir_for_statement)
+static bool constant_expression(struct ir_expression *ir_expression,
+				int64_t *value)
 {
-	generate_assignment(assembly, ir_for_statement->initial);
+	switch (ir_expression->type) {
+	case IR_EXPRESSION_TYPE_LITERAL:
+		*value = literal_to_int64(ir_expression->literal);
+		return true;
+	case IR_EXPRESSION_TYPE_LEN:
+		*value = ir_expression->length_expression->length;
+		return true;
+	case IR_EXPRESSION_TYPE_NEGATE:
+		if (!constant_expression(ir_expression->negate_expression,
+					 value))
+			return false;
+		*value = -*value;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool block_may_modify(struct ir_block *ir_block, char *identifier,
+			     bool global);
+
+static bool assignment_may_modify(struct ir_assignment *ir_assignment,
+				  char *identifier, bool global)
+{
+	if (g_strcmp0(ir_assignment->location->identifier, identifier) == 0)
+		return true;
+	if (!global)
+		return false;
+
+	return (ir_assignment->location->index != NULL &&
+		expression_has_call(ir_assignment->location->index)) ||
+	       (ir_assignment->expression != NULL &&
+		expression_has_call(ir_assignment->expression));
+}
+
+static bool statement_may_modify(struct ir_statement *ir_statement,
+				 char *identifier, bool global)
+{
+	struct ir_if_statement *ir_if;
+	struct ir_for_statement *ir_for;
+	struct ir_while_statement *ir_while;
+
+	switch (ir_statement->type) {
+	case IR_STATEMENT_TYPE_ASSIGNMENT:
+		return assignment_may_modify(ir_statement->assignment,
+					     identifier, global);
+	case IR_STATEMENT_TYPE_METHOD_CALL:
+		return global;
+	case IR_STATEMENT_TYPE_IF:
+		ir_if = ir_statement->if_statement;
+		return (global && expression_has_call(ir_if->condition)) ||
+		       block_may_modify(ir_if->if_block, identifier, global) ||
+		       (ir_if->else_block != NULL &&
+			block_may_modify(ir_if->else_block, identifier,
+					 global));
+	case IR_STATEMENT_TYPE_FOR:
+		ir_for = ir_statement->for_statement;
+		return assignment_may_modify(ir_for->initial, identifier,
+					     global) ||
+		       (global && expression_has_call(ir_for->condition)) ||
+		       (ir_for->update->type == IR_FOR_UPDATE_TYPE_ASSIGNMENT ?
+				assignment_may_modify(ir_for->update->assignment,
+						      identifier, global) :
+				global) ||
+		       block_may_modify(ir_for->block, identifier, global);
+	case IR_STATEMENT_TYPE_WHILE:
+		ir_while = ir_statement->while_statement;
+		return (global && expression_has_call(ir_while->condition)) ||
+		       block_may_modify(ir_while->block, identifier, global);
+	case IR_STATEMENT_TYPE_RETURN:
+		return global && ir_statement->return_expression != NULL &&
+		       expression_has_call(ir_statement->return_expression);
+	default:
+		return false;
+	}
+}
+
+static bool block_may_modify(struct ir_block *ir_block, char *identifier,
+			     bool global)
+{
+	for (uint32_t i = 0; i < ir_block->statements->len; i++) {
+		struct ir_statement *ir_statement = g_array_index(
+			ir_block->statements, struct ir_statement *, i);
+		if (statement_may_modify(ir_statement, identifier, global))
+			return true;
+	}
+
+	return false;
+}
+
+static uint32_t block_size(struct ir_block *ir_block);
+
+static uint32_t statement_size(struct ir_statement *ir_statement)
+{
+	switch (ir_statement->type) {
+	case IR_STATEMENT_TYPE_IF:
+		return 1 + block_size(ir_statement->if_statement->if_block) +
+		       (ir_statement->if_statement->else_block != NULL ?
+				block_size(ir_statement->if_statement
+						   ->else_block) :
+				0);
+	case IR_STATEMENT_TYPE_FOR:
+		return 1 + block_size(ir_statement->for_statement->block);
+	case IR_STATEMENT_TYPE_WHILE:
+		return 1 + block_size(ir_statement->while_statement->block);
+	default:
+		return 1;
+	}
+}
+
+static uint32_t block_size(struct ir_block *ir_block)
+{
+	uint32_t size = ir_block->fields->len;
+
+	for (uint32_t i = 0; i < ir_block->statements->len; i++) {
+		struct ir_statement *ir_statement = g_array_index(
+			ir_block->statements, struct ir_statement *, i);
+		size += statement_size(ir_statement);
+	}
+
+	return size;
+}
 
+static bool is_loop_invariant(struct llir_generator *assembly,
+			      struct ir_block *ir_block, char *identifier)
+{
+	struct llir_field *field =
+		symbol_table_get(assembly->symbol_table, identifier);
+	bool global = strchr(field->identifier, '@') == NULL;
+
+	return !field->is_array &&
+	       !block_may_modify(ir_block, identifier, global);
+}
+
+static bool find_counted_loop(struct llir_generator *assembly,
+			      struct ir_for_statement *ir_for_statement,
+			      struct counted_loop *loop)
+{
+	if (ir_for_statement->update->type != IR_FOR_UPDATE_TYPE_ASSIGNMENT)
+		return false;
+
+	struct ir_assignment *update = ir_for_statement->update->assignment;
+	char *variable = update->location->identifier;
+	if (update->location->index != NULL ||
+	    ir_for_statement->initial->location->index != NULL ||
+	    g_strcmp0(ir_for_statement->initial->location->identifier,
+		      variable) != 0)
+		return false;
+
+	switch (update->assign_operator) {
+	case IR_ASSIGN_OPERATOR_INCREMENT:
+		loop->step = 1;
+		break;
+	case IR_ASSIGN_OPERATOR_DECREMENT:
+		loop->step = -1;
+		break;
+	case IR_ASSIGN_OPERATOR_ADD:
+	case IR_ASSIGN_OPERATOR_SUB:
+		if (!constant_expression(update->expression, &loop->step))
+			return false;
+		if (update->assign_operator == IR_ASSIGN_OPERATOR_SUB)
+			loop->step = -loop->step;
+		break;
+	default:
+		return false;
+	}
+
+	if (loop->step == 0 || loop->step > UNROLL_STEP_LIMIT ||
+	    loop->step < -UNROLL_STEP_LIMIT)
+		return false;
+
+	struct ir_expression *condition = ir_for_statement->condition;
+	if (condition->type != IR_EXPRESSION_TYPE_BINARY)
+		return false;
+
+	struct ir_expression *left = condition->binary_expression->left;
+	if (left->type != IR_EXPRESSION_TYPE_LOCATION ||
+	    left->location->index != NULL ||
+	    g_strcmp0(left->location->identifier, variable) != 0)
+		return false;
+
+	loop->comparison = condition->binary_expression->binary_operator;
+	switch (loop->comparison) {
+	case IR_BINARY_OPERATOR_LESS:
+	case IR_BINARY_OPERATOR_LESS_EQUAL:
+		if (loop->step < 0)
+			return false;
+		break;
+	case IR_BINARY_OPERATOR_GREATER:
+	case IR_BINARY_OPERATOR_GREATER_EQUAL:
+		if (loop->step > 0)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	int64_t constant;
+	loop->bound = condition->binary_expression->right;
+	if (!constant_expression(loop->bound, &constant) &&
+	    (loop->bound->type != IR_EXPRESSION_TYPE_LOCATION ||
+	     loop->bound->location->index != NULL ||
+	     g_strcmp0(loop->bound->location->identifier, variable) == 0 ||
+	     !is_loop_invariant(assembly, ir_for_statement->block,
+				loop->bound->location->identifier)))
+		return false;
+
+	loop->variable = left->location;
+	return is_loop_invariant(assembly, ir_for_statement->block, variable);
+}
+
+static bool constant_trip_count(struct ir_for_statement *ir_for_statement,
+				struct counted_loop *loop, int64_t *trip_count)
+{
+	int64_t start, bound;
+	if (!constant_expression(ir_for_statement->initial->expression,
+				 &start) ||
+	    !constant_expression(loop->bound, &bound))
+		return false;
+
+	if (start > UNROLL_BOUND_LIMIT || start < -UNROLL_BOUND_LIMIT ||
+	    bound > UNROLL_BOUND_LIMIT || bound < -UNROLL_BOUND_LIMIT)
+		return false;
+
+	int64_t distance, step = loop->step;
+	switch (loop->comparison) {
+	case IR_BINARY_OPERATOR_LESS:
+		distance = bound - start;
+		break;
+	case IR_BINARY_OPERATOR_LESS_EQUAL:
+		distance = bound - start + 1;
+		break;
+	case IR_BINARY_OPERATOR_GREATER:
+		distance = start - bound;
+		step = -step;
+		break;
+	case IR_BINARY_OPERATOR_GREATER_EQUAL:
+		distance = start - bound + 1;
+		step = -step;
+		break;
+	default:
+		g_assert(!"you fucked up");
+		return false;
+	}
+
+	*trip_count = distance <= 0 ? 0 : (distance + step - 1) / step;
+	return true;
+}
+
+static enum llir_branch_type
+exit_branch_type(enum ir_binary_operator comparison)
+{
+	switch (comparison) {
+	case IR_BINARY_OPERATOR_LESS:
+		return LLIR_BRANCH_TYPE_GREATER_EQUAL;
+	case IR_BINARY_OPERATOR_LESS_EQUAL:
+		return LLIR_BRANCH_TYPE_GREATER;
+	case IR_BINARY_OPERATOR_GREATER:
+		return LLIR_BRANCH_TYPE_LESS_EQUAL;
+	case IR_BINARY_OPERATOR_GREATER_EQUAL:
+		return LLIR_BRANCH_TYPE_LESS;
+	default:
+		g_assert(!"you fucked up");
+		return LLIR_BRANCH_TYPE_EQUAL;
+	}
+}
+
+static void generate_for_iteration(struct llir_generator *assembly,
+				   struct ir_for_statement *ir_for_statement,
+				   struct llir_block *end_block)
+{
+	struct llir_block *update_block = new_block(assembly);
+	push_loop(assembly, end_block, update_block);
+
+	generate_block(assembly, ir_for_statement->block, true);
+
+	struct llir_jump *jump = llir_jump_new(update_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_JUMP, jump);
+	next_block(assembly, update_block);
+
+	generate_for_update(assembly, ir_for_statement->update);
+	pop_loop(assembly);
+}
+
+static void generate_for_loop(struct llir_generator *assembly,
+			      struct ir_for_statement *ir_for_statement,
+			      struct llir_block *end_block)
+{
 	struct llir_block *condition_block = new_block(assembly);
 	struct llir_block *loop_block = new_block(assembly);
 	struct llir_block *update_block = new_block(assembly);
-	struct llir_block *end_block = new_block(assembly);
 	push_loop(assembly, end_block, update_block);
 
 	struct llir_jump *jump = llir_jump_new(condition_block);
@@ -529,6 +902,606 @@ static void generate_for_statement(struct llir_generator *assembly,
 	pop_loop(assembly);
 }
 
+static void
+generate_fully_unrolled_for(struct llir_generator *assembly,
+			    struct ir_for_statement *ir_for_statement,
+			    int64_t trip_count)
+{
+	struct llir_block *end_block = new_block(assembly);
+
+	for (int64_t i = 0; i < trip_count; i++)
+		generate_for_iteration(assembly, ir_for_statement, end_block);
+
+	struct llir_jump *jump = llir_jump_new(end_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_JUMP, jump);
+	next_block(assembly, end_block);
+}
+
+static void
+generate_partially_unrolled_for(struct llir_generator *assembly,
+				struct ir_for_statement *ir_for_statement,
+				struct counted_loop *loop, uint32_t unroll_factor)
+{
+	struct llir_block *condition_block = new_block(assembly);
+	struct llir_block *loop_block = new_block(assembly);
+	struct llir_block *remainder_block = new_block(assembly);
+	struct llir_block *end_block = new_block(assembly);
+
+	struct llir_jump *jump = llir_jump_new(condition_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_JUMP, jump);
+	next_block(assembly, condition_block);
+
+	struct llir_operand variable =
+		generate_location(assembly, loop->variable);
+	char *last = new_local_temporary(assembly);
+	add_binary_assignment(
+		assembly, LLIR_ASSIGNMENT_TYPE_ADD, variable,
+		llir_operand_from_literal((unroll_factor - 1) * loop->step),
+		last);
+	struct llir_operand bound = generate_expression(assembly, loop->bound);
+
+	struct llir_branch *branch = llir_branch_new(
+		exit_branch_type(loop->comparison), false,
+		llir_operand_from_field(last), bound, loop_block,
+		remainder_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_BRANCH, branch);
+	next_block(assembly, loop_block);
+
+	for (uint32_t i = 0; i < unroll_factor; i++)
+		generate_for_iteration(assembly, ir_for_statement, end_block);
+
+	jump = llir_jump_new(condition_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_JUMP, jump);
+	next_block(assembly, remainder_block);
+
+	generate_for_loop(assembly, ir_for_statement, end_block);
+}
+
+static bool is_induction_variable(struct ir_expression *ir_expression,
+				  char *variable)
+{
+	return ir_expression->type == IR_EXPRESSION_TYPE_LOCATION &&
+	       ir_expression->location->index == NULL &&
+	       g_strcmp0(ir_expression->location->identifier, variable) == 0;
+}
+
+static bool is_vectorizable_expression(struct ir_expression *ir_expression,
+				       char *variable, GHashTable *reductions)
+{
+	struct ir_location *location;
+
+	switch (ir_expression->type) {
+	case IR_EXPRESSION_TYPE_LITERAL:
+	case IR_EXPRESSION_TYPE_LEN:
+		return true;
+	case IR_EXPRESSION_TYPE_LOCATION:
+		location = ir_expression->location;
+		if (location->index != NULL)
+			return is_induction_variable(location->index, variable);
+		return g_strcmp0(location->identifier, variable) != 0 &&
+		       !g_hash_table_contains(reductions, location->identifier);
+	case IR_EXPRESSION_TYPE_NEGATE:
+		return is_vectorizable_expression(
+			ir_expression->negate_expression, variable, reductions);
+	case IR_EXPRESSION_TYPE_BINARY:
+		if (ir_expression->binary_expression->binary_operator !=
+			    IR_BINARY_OPERATOR_ADD &&
+		    ir_expression->binary_expression->binary_operator !=
+			    IR_BINARY_OPERATOR_SUB)
+			return false;
+		return is_vectorizable_expression(
+			       ir_expression->binary_expression->left, variable,
+			       reductions) &&
+		       is_vectorizable_expression(
+			       ir_expression->binary_expression->right,
+			       variable, reductions);
+	default:
+		return false;
+	}
+}
+
+static bool is_vectorizable_operator(enum ir_assign_operator assign_operator,
+				     bool reduction)
+{
+	switch (assign_operator) {
+	case IR_ASSIGN_OPERATOR_SET:
+		return !reduction;
+	case IR_ASSIGN_OPERATOR_ADD:
+	case IR_ASSIGN_OPERATOR_SUB:
+	case IR_ASSIGN_OPERATOR_INCREMENT:
+	case IR_ASSIGN_OPERATOR_DECREMENT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool is_vectorizable_loop(struct ir_for_statement *ir_for_statement,
+				 struct counted_loop *loop)
+{
+	struct ir_block *ir_block = ir_for_statement->block;
+	if (loop->step != 1 || ir_block->fields->len > 0 ||
+	    ir_block->statements->len == 0 ||
+	    ir_block->statements->len > VECTORIZE_STATEMENT_LIMIT)
+		return false;
+
+	char *variable = loop->variable->identifier;
+	GHashTable *reductions = g_hash_table_new(g_str_hash, g_str_equal);
+	bool vectorizable = true;
+
+	for (uint32_t i = 0; vectorizable && i < ir_block->statements->len;
+	     i++) {
+		struct ir_statement *ir_statement = g_array_index(
+			ir_block->statements, struct ir_statement *, i);
+		if (ir_statement->type != IR_STATEMENT_TYPE_ASSIGNMENT) {
+			vectorizable = false;
+			break;
+		}
+
+		struct ir_location *location =
+			ir_statement->assignment->location;
+		bool reduction = location->index == NULL;
+		vectorizable = is_vectorizable_operator(
+			ir_statement->assignment->assign_operator, reduction);
+
+		if (!reduction)
+			vectorizable &= is_induction_variable(location->index,
+							      variable);
+		else if (g_hash_table_contains(reductions,
+					       location->identifier))
+			vectorizable = false;
+		else
+			g_hash_table_add(reductions, location->identifier);
+	}
+
+	for (uint32_t i = 0; vectorizable && i < ir_block->statements->len;
+	     i++) {
+		struct ir_statement *ir_statement = g_array_index(
+			ir_block->statements, struct ir_statement *, i);
+		struct ir_expression *expression =
+			ir_statement->assignment->expression;
+		vectorizable = expression == NULL ||
+			       is_vectorizable_expression(expression, variable,
+							  reductions);
+	}
+
+	g_hash_table_unref(reductions);
+	return vectorizable;
+}
+
+static bool is_invariant_expression(struct ir_expression *ir_expression)
+{
+	switch (ir_expression->type) {
+	case IR_EXPRESSION_TYPE_LOCATION:
+		return ir_expression->location->index == NULL;
+	case IR_EXPRESSION_TYPE_NEGATE:
+		return is_invariant_expression(
+			ir_expression->negate_expression);
+	case IR_EXPRESSION_TYPE_BINARY:
+		return is_invariant_expression(
+			       ir_expression->binary_expression->left) &&
+		       is_invariant_expression(
+			       ir_expression->binary_expression->right);
+	default:
+		return true;
+	}
+}
+
+static char *generate_broadcast(struct llir_generator *assembly,
+				struct llir_operand source)
+{
+	char *destination = new_vector_temporary(assembly);
+	add_unary_assignment(assembly, LLIR_ASSIGNMENT_TYPE_VECTOR_BROADCAST,
+			     source, destination);
+	return destination;
+}
+
+static void hoist_broadcasts(struct llir_generator *assembly,
+			     struct vector_loop *vector_loop,
+			     struct ir_expression *ir_expression)
+{
+	if (is_invariant_expression(ir_expression)) {
+		struct llir_operand source =
+			generate_expression(assembly, ir_expression);
+		g_hash_table_insert(vector_loop->broadcasts, ir_expression,
+				    generate_broadcast(assembly, source));
+		return;
+	}
+
+	switch (ir_expression->type) {
+	case IR_EXPRESSION_TYPE_NEGATE:
+		if (vector_loop->zero == NULL)
+			vector_loop->zero = generate_broadcast(
+				assembly, llir_operand_from_literal(0));
+		hoist_broadcasts(assembly, vector_loop,
+				 ir_expression->negate_expression);
+		break;
+	case IR_EXPRESSION_TYPE_BINARY:
+		hoist_broadcasts(assembly, vector_loop,
+				 ir_expression->binary_expression->left);
+		hoist_broadcasts(assembly, vector_loop,
+				 ir_expression->binary_expression->right);
+		break;
+	default:
+		break;
+	}
+}
+
+static void generate_vector_preheader(struct llir_generator *assembly,
+				      struct ir_block *ir_block,
+				      struct vector_loop *vector_loop)
+{
+	for (uint32_t i = 0; i < ir_block->statements->len; i++) {
+		struct ir_assignment *ir_assignment =
+			g_array_index(ir_block->statements,
+				      struct ir_statement *, i)
+				->assignment;
+
+		if (ir_assignment->location->index == NULL) {
+			struct llir_field *field = symbol_table_get(
+				assembly->symbol_table,
+				ir_assignment->location->identifier);
+			g_hash_table_insert(
+				vector_loop->accumulators, field->identifier,
+				generate_broadcast(
+					assembly,
+					llir_operand_from_literal(0)));
+		}
+
+		if (ir_assignment->expression != NULL)
+			hoist_broadcasts(assembly, vector_loop,
+					 ir_assignment->expression);
+		else
+			g_hash_table_insert(
+				vector_loop->broadcasts, ir_assignment,
+				generate_broadcast(
+					assembly,
+					llir_operand_from_literal(1)));
+	}
+}
+
+static char *generate_vector_expression(struct llir_generator *assembly,
+					struct vector_loop *vector_loop,
+					struct ir_expression *ir_expression)
+{
+	char *broadcast =
+		g_hash_table_lookup(vector_loop->broadcasts, ir_expression);
+	if (broadcast != NULL)
+		return broadcast;
+
+	char *destination, *left, *right;
+	struct llir_field *field;
+
+	switch (ir_expression->type) {
+	case IR_EXPRESSION_TYPE_LOCATION:
+		field = symbol_table_get(assembly->symbol_table,
+					 ir_expression->location->identifier);
+		generate_bounds_check(
+			assembly, llir_operand_from_field(vector_loop->variable),
+			field->value_count);
+		generate_bounds_check(assembly,
+				      llir_operand_from_field(vector_loop->last),
+				      field->value_count);
+		destination = new_vector_temporary(assembly);
+		llir_block_add_assignment(
+			assembly->current_block,
+			llir_assignment_new_vector_load(
+				llir_operand_from_field(vector_loop->variable),
+				field->identifier, destination));
+		return destination;
+	case IR_EXPRESSION_TYPE_NEGATE:
+		right = generate_vector_expression(
+			assembly, vector_loop,
+			ir_expression->negate_expression);
+		destination = new_vector_temporary(assembly);
+		add_binary_assignment(assembly,
+				      LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT,
+				      llir_operand_from_field(vector_loop->zero),
+				      llir_operand_from_field(right),
+				      destination);
+		return destination;
+	case IR_EXPRESSION_TYPE_BINARY:
+		left = generate_vector_expression(
+			assembly, vector_loop,
+			ir_expression->binary_expression->left);
+		right = generate_vector_expression(
+			assembly, vector_loop,
+			ir_expression->binary_expression->right);
+		destination = new_vector_temporary(assembly);
+		add_binary_assignment(
+			assembly,
+			ir_expression->binary_expression->binary_operator ==
+					IR_BINARY_OPERATOR_ADD ?
+				LLIR_ASSIGNMENT_TYPE_VECTOR_ADD :
+				LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT,
+			llir_operand_from_field(left),
+			llir_operand_from_field(right), destination);
+		return destination;
+	default:
+		g_assert(!"you fucked up");
+		return NULL;
+	}
+}
+
+static void generate_vector_assignment(struct llir_generator *assembly,
+				       struct vector_loop *vector_loop,
+				       struct ir_assignment *ir_assignment)
+{
+	struct llir_field *field = symbol_table_get(
+		assembly->symbol_table, ir_assignment->location->identifier);
+	struct llir_operand index =
+		llir_operand_from_field(vector_loop->variable);
+	bool reduction = ir_assignment->location->index == NULL;
+
+	if (!reduction) {
+		generate_bounds_check(assembly, index, field->value_count);
+		generate_bounds_check(assembly,
+				      llir_operand_from_field(vector_loop->last),
+				      field->value_count);
+	}
+
+	char *value;
+	if (ir_assignment->expression != NULL)
+		value = generate_vector_expression(assembly, vector_loop,
+						   ir_assignment->expression);
+	else
+		value = g_hash_table_lookup(vector_loop->broadcasts,
+					    ir_assignment);
+
+	if (ir_assignment->assign_operator == IR_ASSIGN_OPERATOR_SET) {
+		llir_block_add_assignment(
+			assembly->current_block,
+			llir_assignment_new_vector_store(
+				index, llir_operand_from_field(value),
+				field->identifier));
+		return;
+	}
+
+	enum llir_assignment_type type =
+		ir_assignment->assign_operator == IR_ASSIGN_OPERATOR_ADD ||
+				ir_assignment->assign_operator ==
+					IR_ASSIGN_OPERATOR_INCREMENT ?
+			LLIR_ASSIGNMENT_TYPE_VECTOR_ADD :
+			LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT;
+
+	if (reduction) {
+		char *accumulator = g_hash_table_lookup(
+			vector_loop->accumulators, field->identifier);
+		add_binary_assignment(assembly, type,
+				      llir_operand_from_field(accumulator),
+				      llir_operand_from_field(value),
+				      accumulator);
+		return;
+	}
+
+	char *current = new_vector_temporary(assembly);
+	llir_block_add_assignment(assembly->current_block,
+				  llir_assignment_new_vector_load(
+					  index, field->identifier, current));
+	char *result = new_vector_temporary(assembly);
+	add_binary_assignment(assembly, type, llir_operand_from_field(current),
+			      llir_operand_from_field(value), result);
+	llir_block_add_assignment(assembly->current_block,
+				  llir_assignment_new_vector_store(
+					  index, llir_operand_from_field(result),
+					  field->identifier));
+}
+
+static void generate_reductions(struct llir_generator *assembly,
+				struct ir_block *ir_block,
+				struct vector_loop *vector_loop)
+{
+	for (uint32_t i = 0; i < ir_block->statements->len; i++) {
+		struct ir_location *location =
+			g_array_index(ir_block->statements,
+				      struct ir_statement *, i)
+				->assignment->location;
+		if (location->index != NULL)
+			continue;
+
+		struct llir_field *field = symbol_table_get(
+			assembly->symbol_table, location->identifier);
+		char *accumulator = g_hash_table_lookup(
+			vector_loop->accumulators, field->identifier);
+
+		char *sum = new_local_temporary(assembly);
+		add_unary_assignment(assembly,
+				     LLIR_ASSIGNMENT_TYPE_VECTOR_REDUCE,
+				     llir_operand_from_field(accumulator), sum);
+		add_binary_assignment(assembly, LLIR_ASSIGNMENT_TYPE_ADD,
+				      llir_operand_from_field(field->identifier),
+				      llir_operand_from_field(sum),
+				      field->identifier);
+	}
+}
+
+static void generate_vectorized_for(struct llir_generator *assembly,
+				    struct ir_for_statement *ir_for_statement,
+				    struct counted_loop *loop)
+{
+	struct ir_block *ir_block = ir_for_statement->block;
+	struct llir_field *field = symbol_table_get(assembly->symbol_table,
+						    loop->variable->identifier);
+	struct vector_loop vector_loop = {
+		.variable = field->identifier,
+		.last = new_local_temporary(assembly),
+		.broadcasts = g_hash_table_new(g_direct_hash, g_direct_equal),
+		.accumulators = g_hash_table_new(g_str_hash, g_str_equal),
+		.zero = NULL,
+	};
+	struct llir_operand variable =
+		llir_operand_from_field(vector_loop.variable);
+
+	generate_vector_preheader(assembly, ir_block, &vector_loop);
+
+	struct llir_block *condition_block = new_block(assembly);
+	struct llir_block *loop_block = new_block(assembly);
+	struct llir_block *reduction_block = new_block(assembly);
+
+	struct llir_jump *jump = llir_jump_new(condition_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_JUMP, jump);
+	next_block(assembly, condition_block);
+
+	add_binary_assignment(
+		assembly, LLIR_ASSIGNMENT_TYPE_ADD, variable,
+		llir_operand_from_literal(assembly->vector_width - 1),
+		vector_loop.last);
+	struct llir_operand bound = generate_expression(assembly, loop->bound);
+
+	struct llir_branch *branch = llir_branch_new(
+		exit_branch_type(loop->comparison), false,
+		llir_operand_from_field(vector_loop.last), bound, loop_block,
+		reduction_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_BRANCH, branch);
+	next_block(assembly, loop_block);
+
+	for (uint32_t i = 0; i < ir_block->statements->len; i++) {
+		struct ir_statement *ir_statement = g_array_index(
+			ir_block->statements, struct ir_statement *, i);
+		generate_vector_assignment(assembly, &vector_loop,
+					   ir_statement->assignment);
+	}
+
+	add_binary_assignment(assembly, LLIR_ASSIGNMENT_TYPE_ADD, variable,
+			      llir_operand_from_literal(assembly->vector_width),
+			      vector_loop.variable);
+
+	jump = llir_jump_new(condition_block);
+	llir_block_set_terminal(assembly->current_block,
+				LLIR_BLOCK_TERMINAL_TYPE_JUMP, jump);
+	next_block(assembly, reduction_block);
+
+	generate_reductions(assembly, ir_block, &vector_loop);
+	generate_for_loop(assembly, ir_for_statement, new_block(assembly));
+
+	g_hash_table_unref(vector_loop.broadcasts);
+	g_hash_table_unref(vector_loop.accumulators);
+}
+
+static uint32_t generate_counted_for(struct llir_generator *assembly,
+				     struct ir_for_statement *ir_for_statement,
+				     uint32_t unroll_factor, uint32_t *header)
+{
+	struct counted_loop loop;
+	bool counted = (unroll_factor > 0 || assembly->vector_width > 0) &&
+		       find_counted_loop(assembly, ir_for_statement, &loop);
+
+	if (counted) {
+		int64_t size = block_size(ir_for_statement->block);
+		int64_t trip_count = 0;
+		bool constant =
+			constant_trip_count(ir_for_statement, &loop, &trip_count);
+
+		if (unroll_factor > 0 && constant &&
+		    trip_count <= UNROLL_FULL_TRIP_COUNT_LIMIT &&
+		    trip_count * size <= UNROLL_FULL_SIZE_LIMIT) {
+			generate_fully_unrolled_for(assembly, ir_for_statement,
+						    trip_count);
+			return 0;
+		}
+
+		if (assembly->vector_width > 0 &&
+		    is_vectorizable_loop(ir_for_statement, &loop) &&
+		    (!constant || trip_count >= assembly->vector_width)) {
+			generate_vectorized_for(assembly, ir_for_statement,
+						&loop);
+			return 0;
+		}
+
+		if (unroll_factor > 1 && size <= UNROLL_PARTIAL_SIZE_LIMIT &&
+		    (!constant || trip_count >= unroll_factor)) {
+			*header = assembly->block_counter;
+			generate_partially_unrolled_for(
+				assembly, ir_for_statement, &loop,
+				unroll_factor);
+			return unroll_factor;
+		}
+	}
+
+	struct llir_block *end_block = new_block(assembly);
+	*header = assembly->block_counter;
+	generate_for_loop(assembly, ir_for_statement, end_block);
+	return counted ? 1 : 0;
+}
+
+static void record_profile_loop(struct llir_generator *assembly,
+				struct ir_for_statement *ir_for_statement,
+				uint32_t preheader, uint32_t header,
+				uint32_t unroll_factor)
+{
+	struct profile_loop *profile_loop =
+		g_hash_table_lookup(assembly->profile_loops, ir_for_statement);
+	if (profile_loop != NULL) {
+		profile_loop->repeated = true;
+		return;
+	}
+
+	profile_loop = g_new0(struct profile_loop, 1);
+	profile_loop->preheader = preheader;
+	profile_loop->header = header;
+	profile_loop->end = assembly->block_counter;
+	profile_loop->unroll_factor = unroll_factor;
+	g_hash_table_insert(assembly->profile_loops, ir_for_statement,
+			    profile_loop);
+}
+
+static void generate_profiled_for(struct llir_generator *assembly,
+				  struct ir_for_statement *ir_for_statement,
+				  struct profile_loop *profile_loop)
+{
+	uint32_t header;
+	uint64_t estimated_frequency = assembly->estimated_frequency;
+	assembly->estimated_frequency = profile_loop->header_frequency;
+
+	// blocks of a loop whose unrolling changed take ids past the ones the
+	// instrumented build used, so every block after it keeps its profile
+	bool spare = assembly->block_counter < assembly->spare_block_base;
+	if (spare)
+		assembly->block_counter = assembly->spare_block_counter;
+
+	generate_counted_for(assembly, ir_for_statement,
+			     profile_loop->unroll_factor, &header);
+	assembly->current_block->frequency = profile_loop->entry_frequency;
+	assembly->estimated_frequency = estimated_frequency;
+
+	if (spare) {
+		assembly->spare_block_counter = assembly->block_counter;
+		assembly->block_counter = profile_loop->end;
+	}
+}
+
+static void generate_for_statement(struct llir_generator *assembly,
+				   struct ir_for_statement *ir_for_statement)
+{
+	generate_assignment(assembly, ir_for_statement->initial);
+
+	if (assembly->profile_overrides) {
+		struct profile_loop *profile_loop = g_hash_table_lookup(
+			assembly->profile_loops, ir_for_statement);
+		if (profile_loop != NULL) {
+			generate_profiled_for(assembly, ir_for_statement,
+					      profile_loop);
+			return;
+		}
+	}
+
+	uint32_t preheader = assembly->current_block->id;
+	uint32_t header;
+	uint32_t unroll_factor = generate_counted_for(
+		assembly, ir_for_statement, assembly->unroll_factor, &header);
+
+	if (assembly->profile != NULL && !assembly->profile_overrides &&
+	    unroll_factor > 0 && assembly->unroll_factor > 1)
+		record_profile_loop(assembly, ir_for_statement, preheader,
+				    header, unroll_factor);
+}
+
 static void
 generate_while_statement(struct llir_generator *assembly,
 			 struct ir_while_statement *ir_while_statement)
@@ -643,13 +1616,10 @@ static void generate_field_initialization(struct llir_generator *assembly,
 		return;
 	}
 
-	for (uint32_t i = 0; i < field->value_count; i++) {
-		struct llir_operand source =
-			llir_operand_from_literal(field->values[i]);
-		struct llir_operand index = llir_operand_from_literal(i);
-
-		add_array_update(assembly, index, source, field->identifier);
-	}
+	struct llir_assignment *assignment =
+		llir_assignment_new_array_initialize(
+			field->value_count, field->values, field->identifier);
+	llir_block_add_assignment(assembly->current_block, assignment);
 }
 
 static void generate_block(struct llir_generator *assembly,
@@ -738,14 +1708,15 @@ static struct llir_field *generate_field(struct llir_generator *assembly,
 	struct llir_field *field = llir_field_new(
 		ir_field->identifier, scope_level,
 		ir_data_type_is_array(ir_field->type), ir_field->array_length);
+	field->is_constant = ir_field->constant;
 	get_field_initializer(ir_field->initializer, field->values);
 
 	symbol_table_set(assembly->symbol_table, ir_field->identifier, field);
 	return field;
 }
 
-static struct llir *generate_llir(struct llir_generator *assembly,
-				  struct ir_program *ir_program)
+static struct llir *generate_globals(struct llir_generator *assembly,
+				     struct ir_program *ir_program)
 {
 	struct llir *llir = llir_new();
 
@@ -757,6 +1728,14 @@ static struct llir *generate_llir(struct llir_generator *assembly,
 		llir_add_field(llir, field);
 	}
 
+	return llir;
+}
+
+static struct llir *generate_llir(struct llir_generator *assembly,
+				  struct ir_program *ir_program)
+{
+	struct llir *llir = generate_globals(assembly, ir_program);
+
 	for (uint32_t i = 0; i < ir_program->methods->len; i++) {
 		struct ir_method *ir_method = g_array_index(
 			ir_program->methods, struct ir_method *, i);
@@ -769,10 +1748,94 @@ static struct llir *generate_llir(struct llir_generator *assembly,
 	return llir;
 }
 
-struct llir_generator *llir_generator_new(void)
+static uint32_t profile_unroll_factor(struct llir_generator *assembly,
+				      struct llir *llir,
+				      struct profile_loop *profile_loop)
+{
+	if (profile_loop->entry_frequency == 0 ||
+	    !profile_is_hot(llir, profile_loop->header_frequency))
+		return 1;
+
+	uint64_t trip_count = (profile_loop->header_frequency /
+				       profile_loop->entry_frequency -
+			       1) *
+			      profile_loop->unroll_factor;
+	if (trip_count < assembly->unroll_factor)
+		return 1;
+	if (trip_count >= PROFILE_LONG_TRIP_COUNT)
+		return MAX(assembly->unroll_factor, PROFILE_LONG_UNROLL_FACTOR);
+	return assembly->unroll_factor;
+}
+
+static bool choose_unroll_factors(struct llir_generator *assembly,
+				  struct llir *llir)
+{
+	GHashTable *blocks = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+
+		for (uint32_t j = 0; j < method->blocks->len; j++) {
+			struct llir_block *block = g_array_index(
+				method->blocks, struct llir_block *, j);
+			g_hash_table_insert(blocks, GUINT_TO_POINTER(block->id),
+					    block);
+		}
+	}
+
+	GHashTableIter iterator;
+	struct profile_loop *profile_loop;
+	g_hash_table_iter_init(&iterator, assembly->profile_loops);
+	while (g_hash_table_iter_next(&iterator, NULL,
+				      (gpointer *)&profile_loop)) {
+		struct llir_block *preheader = g_hash_table_lookup(
+			blocks, GUINT_TO_POINTER(profile_loop->preheader));
+		struct llir_block *header = g_hash_table_lookup(
+			blocks, GUINT_TO_POINTER(profile_loop->header));
+		if (profile_loop->repeated || preheader == NULL ||
+		    header == NULL) {
+			g_hash_table_iter_remove(&iterator);
+			continue;
+		}
+
+		profile_loop->entry_frequency = preheader->frequency;
+		profile_loop->header_frequency = header->frequency;
+
+		uint32_t unroll_factor =
+			profile_unroll_factor(assembly, llir, profile_loop);
+		if (unroll_factor == profile_loop->unroll_factor) {
+			g_hash_table_iter_remove(&iterator);
+			continue;
+		}
+
+		if (assembly->debug)
+			g_print("profile: unrolling the loop at block %u %u times instead of %u\n",
+				profile_loop->header, unroll_factor,
+				profile_loop->unroll_factor);
+		profile_loop->unroll_factor = unroll_factor;
+	}
+
+	g_hash_table_unref(blocks);
+	return g_hash_table_size(assembly->profile_loops) > 0;
+}
+
+struct llir_generator *llir_generator_new(uint32_t unroll_factor,
+					  uint32_t vector_width,
+					  struct profile *profile, bool debug)
 {
 	struct llir_generator *assembly = g_new(struct llir_generator, 1);
 
+	assembly->unroll_factor = unroll_factor;
+	assembly->vector_width = vector_width;
+	assembly->profile = profile;
+	assembly->debug = debug;
+	assembly->profile_loops = g_hash_table_new_full(
+		g_direct_hash, g_direct_equal, NULL, g_free);
+	assembly->profile_overrides = false;
+	assembly->spare_block_base = 0;
+	assembly->spare_block_counter = 0;
+	assembly->estimated_frequency = 0;
+
 	assembly->break_blocks =
 		g_array_new(false, false, sizeof(struct llir_block *));
 	assembly->continue_blocks =
@@ -787,7 +1850,47 @@ struct llir *llir_generator_generate_llir(struct llir_generator *assembly,
 {
 	assembly->temporary_counter = 0;
 	assembly->block_counter = 0;
-	return generate_llir(assembly, ir);
+	assembly->profile_overrides = false;
+	g_hash_table_remove_all(assembly->profile_loops);
+
+	struct llir *llir = generate_llir(assembly, ir);
+	if (assembly->profile == NULL)
+		return llir;
+
+	uint32_t block_limit = assembly->block_counter;
+	profile_annotate(assembly->profile, llir, block_limit);
+	if (!choose_unroll_factors(assembly, llir))
+		return llir;
+
+	assembly->spare_block_base = block_limit;
+	assembly->spare_block_counter = block_limit;
+	assembly->temporary_counter = 0;
+	assembly->block_counter = 0;
+	assembly->profile_overrides = true;
+	llir_free(llir);
+
+	llir = generate_llir(assembly, ir);
+	profile_annotate(assembly->profile, llir, block_limit);
+	return llir;
+}
+
+struct llir *llir_generator_generate_globals(struct llir_generator *assembly,
+					     struct ir_program *ir)
+{
+	g_assert(assembly->profile == NULL);
+
+	assembly->temporary_counter = 0;
+	assembly->block_counter = 0;
+	assembly->profile_overrides = false;
+
+	return generate_globals(assembly, ir);
+}
+
+struct llir_method *
+llir_generator_generate_method(struct llir_generator *assembly,
+			       struct ir_method *ir_method)
+{
+	return generate_method(assembly, ir_method);
 }
 
 void llir_generator_free(struct llir_generator *assembly)
@@ -795,5 +1898,6 @@ void llir_generator_free(struct llir_generator *assembly)
 	g_array_free(assembly->break_blocks, true);
 	g_array_free(assembly->continue_blocks, true);
 	symbol_table_free(assembly->symbol_table);
+	g_hash_table_unref(assembly->profile_loops);
 	g_free(assembly);
 }
@@ -1,8 +1,11 @@
 #pragma once
 #include "assembly/llir.h"
+#include "assembly/profile.h"
 #include "assembly/symbol_table.h"
 
 struct llir_generator {
+	uint32_t unroll_factor;
+	uint32_t vector_width;
 	uint32_t temporary_counter;
 	uint32_t block_counter;
 	struct symbol_table *symbol_table;
@@ -10,11 +13,26 @@ struct llir_generator {
 	GArray *continue_blocks;
 	struct llir_method *current_method;
 	struct llir_block *current_block;
+	struct profile *profile;
+	GHashTable *profile_loops;
+	bool profile_overrides;
+	uint32_t spare_block_base;
+	uint32_t spare_block_counter;
+	uint64_t estimated_frequency;
+	bool debug;
 };
 
-struct llir_generator *llir_generator_new(void);
+struct llir_generator *llir_generator_new(uint32_t unroll_factor,
+					  uint32_t vector_width,
+					  struct profile *profile, bool debug);
 
 struct llir *llir_generator_generate_llir(struct llir_generator *assembly,
 					  struct ir_program *ir);
 
+struct llir *llir_generator_generate_globals(struct llir_generator *assembly,
+					     struct ir_program *ir);
+struct llir_method *
+llir_generator_generate_method(struct llir_generator *assembly,
+			       struct ir_method *ir_method);
+
 void llir_generator_free(struct llir_generator *assembly);
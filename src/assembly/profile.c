@@ -0,0 +1,147 @@
+#include <stdio.h>
+
+#include "assembly/profile.h"
+
+#define PROFILE_HOT_FRACTION 100
+#define PROFILE_INFERENCE_LIMIT 16
+
+struct profile *profile_load(const char *file_name)
+{
+	char *contents = NULL;
+	if (!g_file_get_contents(file_name, &contents, NULL, NULL)) {
+		g_printerr("Failed to read profile %s\n", file_name);
+		return NULL;
+	}
+
+	struct profile *profile = g_new(struct profile, 1);
+	profile->methods = g_hash_table_new_full(g_str_hash, g_str_equal,
+						 g_free, NULL);
+	profile->frequencies = g_hash_table_new_full(
+		g_direct_hash, g_direct_equal, NULL, g_free);
+
+	char **lines = g_strsplit(contents, "\n", -1);
+	for (uint32_t i = 0; lines[i] != NULL; i++) {
+		char method[256];
+		uint32_t id = 0;
+		unsigned long long frequency = 0;
+		if (lines[i][0] == '\0')
+			continue;
+
+		if (sscanf(lines[i], "%255s %u %llu", method, &id,
+			   &frequency) != 3) {
+			g_printerr("Malformed line %u in profile %s\n", i + 1,
+				   file_name);
+			g_strfreev(lines);
+			g_free(contents);
+			profile_free(profile);
+			return NULL;
+		}
+
+		uint64_t *value = g_hash_table_lookup(profile->frequencies,
+						      GUINT_TO_POINTER(id));
+		if (value == NULL) {
+			value = g_new0(uint64_t, 1);
+			g_hash_table_insert(profile->frequencies,
+					    GUINT_TO_POINTER(id), value);
+		}
+		*value += frequency;
+
+		g_hash_table_add(profile->methods, g_strdup(method));
+	}
+
+	g_strfreev(lines);
+	g_free(contents);
+	return profile;
+}
+
+static bool is_merged_successor(struct llir_block *block)
+{
+	if (block->predecessors->len != 1)
+		return false;
+
+	struct llir_block *predecessor =
+		g_array_index(block->predecessors, struct llir_block *, 0);
+	return predecessor->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP &&
+	       predecessor->frequency > 0;
+}
+
+static void annotate_method(struct profile *profile,
+			    struct llir_method *method, uint32_t block_limit)
+{
+	GHashTable *missing = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		uint64_t *frequency =
+			g_hash_table_lookup(profile->frequencies,
+					    GUINT_TO_POINTER(block->id));
+
+		if (frequency != NULL && block->id < block_limit)
+			block->frequency = *frequency;
+		else if (block->frequency == 0)
+			g_hash_table_add(missing, block);
+	}
+
+	// blocks the instrumented build merged into their only predecessor
+	// ran exactly as often as that predecessor
+	bool changed = true;
+	for (uint32_t round = 0; changed && round < PROFILE_INFERENCE_LIMIT;
+	     round++) {
+		changed = false;
+
+		for (uint32_t i = 0; i < method->blocks->len; i++) {
+			struct llir_block *block = g_array_index(
+				method->blocks, struct llir_block *, i);
+			if (!g_hash_table_contains(missing, block) ||
+			    !is_merged_successor(block))
+				continue;
+
+			block->frequency =
+				g_array_index(block->predecessors,
+					      struct llir_block *, 0)
+					->frequency;
+			g_hash_table_remove(missing, block);
+			changed = true;
+		}
+	}
+
+	g_hash_table_unref(missing);
+	method->profiled = true;
+}
+
+void profile_annotate(struct profile *profile, struct llir *llir,
+		      uint32_t block_limit)
+{
+	llir->max_frequency = 0;
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		if (!g_hash_table_contains(profile->methods,
+					   method->identifier))
+			continue;
+
+		annotate_method(profile, method, block_limit);
+
+		for (uint32_t j = 0; j < method->blocks->len; j++) {
+			struct llir_block *block = g_array_index(
+				method->blocks, struct llir_block *, j);
+			llir->max_frequency =
+				MAX(llir->max_frequency, block->frequency);
+		}
+	}
+}
+
+bool profile_is_hot(struct llir *llir, uint64_t frequency)
+{
+	return frequency > 0 &&
+	       frequency >= llir->max_frequency / PROFILE_HOT_FRACTION;
+}
+
+void profile_free(struct profile *profile)
+{
+	g_hash_table_unref(profile->methods);
+	g_hash_table_unref(profile->frequencies);
+	g_free(profile);
+}
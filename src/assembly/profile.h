@@ -0,0 +1,16 @@
+#pragma once
+#include "assembly/llir.h"
+
+struct profile {
+	GHashTable *methods;
+	GHashTable *frequencies;
+};
+
+struct profile *profile_load(const char *file_name);
+
+void profile_annotate(struct profile *profile, struct llir *llir,
+		      uint32_t block_limit);
+
+bool profile_is_hot(struct llir *llir, uint64_t frequency);
+
+void profile_free(struct profile *profile);
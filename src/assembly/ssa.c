@@ -26,16 +26,20 @@ static bool rename_operand(struct ssa_context *ssa,
 static void rename_assignment_operands(struct ssa_context *ssa,
 				       struct llir_assignment *assignment)
 {
-	if (assignment->type == LLIR_ASSIGNMENT_TYPE_PHI)
+	if (assignment->type == LLIR_ASSIGNMENT_TYPE_PHI ||
+	    assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE)
 		return;
 
 	if (assignment->type == LLIR_ASSIGNMENT_TYPE_MOVE ||
 	    assignment->type == LLIR_ASSIGNMENT_TYPE_NOT ||
-	    assignment->type == LLIR_ASSIGNMENT_TYPE_NEGATE) {
+	    assignment->type == LLIR_ASSIGNMENT_TYPE_NEGATE ||
+	    llir_assignment_is_vector_unary(assignment)) {
 		rename_operand(ssa, &assignment->source);
-	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS) {
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS ||
+		   assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD) {
 		rename_operand(ssa, &assignment->access_index);
-	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE) {
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE ||
+		   assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_STORE) {
 		rename_operand(ssa, &assignment->update_index);
 		rename_operand(ssa, &assignment->update_value);
 	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL) {
@@ -51,7 +55,9 @@ static void rename_destination(struct ssa_context *ssa,
 			       struct llir_block *block,
 			       struct llir_assignment *assignment)
 {
-	if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE)
+	if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE ||
+	    assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE ||
+	    assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_STORE)
 		return;
 
 	uint64_t counter = (uint64_t)g_hash_table_lookup(
@@ -0,0 +1,411 @@
+#include "assembly/stack_slots.h"
+
+#define BITS_PER_WORD (8 * sizeof(gulong))
+
+struct slot_context {
+	struct llir_method *method;
+	GHashTable *indices;
+	GArray *fields;
+	uint32_t words;
+	GHashTable *blocks;
+	gulong **live_in;
+	GArray **neighbours;
+};
+
+static bool bitset_test(gulong *set, uint32_t index)
+{
+	return (set[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+}
+
+static void bitset_set(gulong *set, uint32_t index)
+{
+	set[index / BITS_PER_WORD] |= 1UL << (index % BITS_PER_WORD);
+}
+
+static void bitset_clear(gulong *set, uint32_t index)
+{
+	set[index / BITS_PER_WORD] &= ~(1UL << (index % BITS_PER_WORD));
+}
+
+static bool is_slot_field(struct llir_field *field)
+{
+	return !field->is_array && field->value_count == 1;
+}
+
+static void add_field(struct slot_context *context, struct llir_field *field)
+{
+	if (!is_slot_field(field))
+		return;
+
+	g_array_append_val(context->fields, field);
+	g_hash_table_insert(context->indices, field->identifier,
+			    GUINT_TO_POINTER(context->fields->len));
+}
+
+static int32_t field_index(struct slot_context *context, char *identifier)
+{
+	if (identifier == NULL)
+		return -1;
+
+	return (int32_t)GPOINTER_TO_UINT(
+		       g_hash_table_lookup(context->indices, identifier)) -
+	       1;
+}
+
+static void mark_operand(struct slot_context *context, gulong *live,
+			 struct llir_operand operand)
+{
+	if (operand.type != LLIR_OPERAND_TYPE_FIELD)
+		return;
+
+	int32_t index = field_index(context, operand.field);
+	if (index >= 0)
+		bitset_set(live, index);
+}
+
+static void mark_assignment_uses(struct slot_context *context, gulong *live,
+				 struct llir_assignment *assignment)
+{
+	if (llir_assignment_is_unary(assignment) ||
+	    llir_assignment_is_vector_unary(assignment)) {
+		mark_operand(context, live, assignment->source);
+		return;
+	}
+	if (llir_assignment_is_binary(assignment) ||
+	    llir_assignment_is_vector_binary(assignment)) {
+		mark_operand(context, live, assignment->left);
+		mark_operand(context, live, assignment->right);
+		return;
+	}
+
+	switch (assignment->type) {
+	case LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_STORE:
+		mark_operand(context, live, assignment->update_index);
+		mark_operand(context, live, assignment->update_value);
+		break;
+	case LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD:
+		mark_operand(context, live, assignment->access_index);
+		break;
+	case LLIR_ASSIGNMENT_TYPE_METHOD_CALL:
+		for (uint32_t i = 0; i < assignment->argument_count; i++)
+			mark_operand(context, live, assignment->arguments[i]);
+		break;
+	case LLIR_ASSIGNMENT_TYPE_PHI:
+		for (uint32_t i = 0; i < assignment->phi_arguments->len; i++)
+			mark_operand(context, live,
+				     g_array_index(assignment->phi_arguments,
+						   struct llir_operand, i));
+		break;
+	case LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE:
+		break;
+	default:
+		g_assert(!"you fucked up");
+		break;
+	}
+}
+
+static void mark_terminal_uses(struct slot_context *context, gulong *live,
+			       struct llir_block *block)
+{
+	switch (block->terminal_type) {
+	case LLIR_BLOCK_TERMINAL_TYPE_BRANCH:
+		mark_operand(context, live, block->branch->left);
+		mark_operand(context, live, block->branch->right);
+		break;
+	case LLIR_BLOCK_TERMINAL_TYPE_RETURN:
+		mark_operand(context, live, block->llir_return->source);
+		break;
+	default:
+		break;
+	}
+}
+
+static void merge_successor(struct slot_context *context, gulong *live,
+			    struct llir_block *successor)
+{
+	uint32_t index =
+		GPOINTER_TO_UINT(g_hash_table_lookup(context->blocks, successor));
+	g_assert(index != 0);
+
+	gulong *successor_live = context->live_in[index - 1];
+	for (uint32_t i = 0; i < context->words; i++)
+		live[i] |= successor_live[i];
+}
+
+static void compute_live_out(struct slot_context *context, gulong *live,
+			     struct llir_block *block)
+{
+	memset(live, 0, context->words * sizeof(gulong));
+
+	if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP) {
+		merge_successor(context, live, block->jump->block);
+	} else if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_BRANCH) {
+		merge_successor(context, live, block->branch->true_block);
+		merge_successor(context, live, block->branch->false_block);
+	}
+
+	mark_terminal_uses(context, live, block);
+}
+
+static void add_interference(struct slot_context *context, uint32_t left,
+			     uint32_t right)
+{
+	g_array_append_val(context->neighbours[left], right);
+	g_array_append_val(context->neighbours[right], left);
+}
+
+static void interfere_with_live(struct slot_context *context, gulong *live,
+				uint32_t definition, int32_t copied)
+{
+	for (uint32_t i = 0; i < context->words; i++) {
+		gulong word = live[i];
+
+		for (gint bit = g_bit_nth_lsf(word, -1); bit >= 0;
+		     bit = g_bit_nth_lsf(word, bit)) {
+			uint32_t index = i * BITS_PER_WORD + bit;
+			if (index != definition && (int32_t)index != copied)
+				add_interference(context, definition, index);
+		}
+	}
+}
+
+static void scan_block(struct slot_context *context, gulong *live,
+		       struct llir_block *block, bool interfere)
+{
+	compute_live_out(context, live, block);
+
+	for (uint32_t i = block->assignments->len; i-- > 0;) {
+		struct llir_assignment *assignment = g_array_index(
+			block->assignments, struct llir_assignment *, i);
+
+		int32_t definition =
+			field_index(context, assignment->destination);
+		if (definition >= 0) {
+			int32_t copied = -1;
+			if (assignment->type == LLIR_ASSIGNMENT_TYPE_MOVE &&
+			    assignment->source.type == LLIR_OPERAND_TYPE_FIELD)
+				copied = field_index(context,
+						     assignment->source.field);
+
+			if (interfere)
+				interfere_with_live(context, live, definition,
+						    copied);
+			bitset_clear(live, definition);
+		}
+
+		mark_assignment_uses(context, live, assignment);
+	}
+}
+
+static void compute_liveness(struct slot_context *context)
+{
+	gulong *live = g_new(gulong, context->words);
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+
+		for (uint32_t i = context->method->blocks->len; i-- > 0;) {
+			struct llir_block *block = g_array_index(
+				context->method->blocks, struct llir_block *, i);
+			scan_block(context, live, block, false);
+
+			if (memcmp(live, context->live_in[i],
+				   context->words * sizeof(gulong)) != 0) {
+				memcpy(context->live_in[i], live,
+				       context->words * sizeof(gulong));
+				changed = true;
+			}
+		}
+	}
+
+	g_free(live);
+}
+
+static void build_interference(struct slot_context *context)
+{
+	gulong *live = g_new(gulong, context->words);
+
+	for (uint32_t i = 0; i < context->method->blocks->len; i++) {
+		struct llir_block *block = g_array_index(
+			context->method->blocks, struct llir_block *, i);
+		scan_block(context, live, block, true);
+	}
+
+	memcpy(live, context->live_in[0], context->words * sizeof(gulong));
+	for (uint32_t i = 0; i < context->method->arguments->len; i++) {
+		struct llir_field *argument = g_array_index(
+			context->method->arguments, struct llir_field *, i);
+		int32_t index = field_index(context, argument->identifier);
+		if (index >= 0)
+			bitset_set(live, index);
+	}
+
+	for (uint32_t i = 0; i < context->fields->len; i++) {
+		if (bitset_test(live, i))
+			interfere_with_live(context, live, i, -1);
+	}
+
+	g_free(live);
+}
+
+static uint32_t color_fields(struct slot_context *context, uint32_t *colors)
+{
+	uint32_t *taken = g_new0(uint32_t, context->fields->len + 1);
+	uint32_t slot_count = 0;
+
+	for (uint32_t i = 0; i < context->fields->len; i++) {
+		GArray *neighbours = context->neighbours[i];
+
+		for (uint32_t j = 0; j < neighbours->len; j++) {
+			uint32_t neighbour = g_array_index(neighbours, uint32_t, j);
+			if (neighbour < i)
+				taken[colors[neighbour]] = i + 1;
+		}
+
+		uint32_t color = 0;
+		while (taken[color] == i + 1)
+			color++;
+
+		colors[i] = color;
+		slot_count = MAX(slot_count, color + 1);
+	}
+
+	g_free(taken);
+	return slot_count;
+}
+
+static uint64_t allocate_field(struct llir_field *field, GHashTable *offsets,
+			       uint64_t stack_size)
+{
+	stack_size += field->value_count * 8;
+	g_hash_table_insert(offsets, field->identifier, (gpointer)stack_size);
+	return stack_size;
+}
+
+static uint64_t allocate_fields(struct llir_method *method, GHashTable *offsets,
+				bool include_slot_fields)
+{
+	uint64_t stack_size = 0;
+
+	for (uint32_t i = 0; i < method->arguments->len; i++) {
+		struct llir_field *field = g_array_index(
+			method->arguments, struct llir_field *, i);
+		if (include_slot_fields || !is_slot_field(field))
+			stack_size = allocate_field(field, offsets, stack_size);
+	}
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+
+		for (uint32_t j = 0; j < block->fields->len; j++) {
+			struct llir_field *field = g_array_index(
+				block->fields, struct llir_field *, j);
+			if (include_slot_fields || !is_slot_field(field))
+				stack_size = allocate_field(field, offsets,
+							    stack_size);
+		}
+	}
+
+	return stack_size;
+}
+
+static uint64_t allocate_colored_fields(struct llir_method *method,
+					GHashTable *offsets)
+{
+	struct slot_context context = {
+		.method = method,
+		.indices = g_hash_table_new(g_str_hash, g_str_equal),
+		.fields = g_array_new(false, false, sizeof(struct llir_field *)),
+		.blocks = g_hash_table_new(g_direct_hash, g_direct_equal),
+	};
+
+	for (uint32_t i = 0; i < method->arguments->len; i++)
+		add_field(&context, g_array_index(method->arguments,
+						  struct llir_field *, i));
+
+	context.live_in = g_new(gulong *, method->blocks->len);
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		g_hash_table_insert(context.blocks, block,
+				    GUINT_TO_POINTER(i + 1));
+
+		for (uint32_t j = 0; j < block->fields->len; j++)
+			add_field(&context, g_array_index(block->fields,
+							  struct llir_field *,
+							  j));
+	}
+
+	context.words = context.fields->len / BITS_PER_WORD + 1;
+	for (uint32_t i = 0; i < method->blocks->len; i++)
+		context.live_in[i] = g_new0(gulong, context.words);
+
+	context.neighbours = g_new(GArray *, context.fields->len);
+	for (uint32_t i = 0; i < context.fields->len; i++)
+		context.neighbours[i] =
+			g_array_new(false, false, sizeof(uint32_t));
+
+	compute_liveness(&context);
+	build_interference(&context);
+
+	uint32_t *colors = g_new(uint32_t, context.fields->len);
+	uint32_t slot_count = color_fields(&context, colors);
+
+	uint64_t stack_size = allocate_fields(method, offsets, false);
+	for (uint32_t i = 0; i < context.fields->len; i++) {
+		struct llir_field *field =
+			g_array_index(context.fields, struct llir_field *, i);
+		g_hash_table_insert(offsets, field->identifier,
+				    (gpointer)(stack_size + 8 * (colors[i] + 1)));
+	}
+	stack_size += 8 * slot_count;
+
+	for (uint32_t i = 0; i < context.fields->len; i++)
+		g_array_free(context.neighbours[i], true);
+	for (uint32_t i = 0; i < method->blocks->len; i++)
+		g_free(context.live_in[i]);
+	g_free(context.neighbours);
+	g_free(context.live_in);
+	g_free(colors);
+	g_hash_table_unref(context.blocks);
+	g_hash_table_unref(context.indices);
+	g_array_free(context.fields, true);
+	return stack_size;
+}
+
+static uint64_t fields_size(GArray *fields)
+{
+	uint64_t size = 0;
+
+	for (uint32_t i = 0; i < fields->len; i++)
+		size += g_array_index(fields, struct llir_field *, i)
+				->value_count *
+			8;
+
+	return size;
+}
+
+uint64_t stack_slots_frame_size(struct llir_method *method)
+{
+	uint64_t stack_size = fields_size(method->arguments);
+
+	for (uint32_t i = 0; i < method->blocks->len; i++)
+		stack_size += fields_size(
+			g_array_index(method->blocks, struct llir_block *, i)
+				->fields);
+
+	return stack_size;
+}
+
+uint64_t stack_slots_allocate(struct llir_method *method, GHashTable *offsets,
+			      bool color)
+{
+	if (color)
+		return allocate_colored_fields(method, offsets);
+
+	return allocate_fields(method, offsets, true);
+}
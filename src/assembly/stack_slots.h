@@ -0,0 +1,7 @@
+#pragma once
+#include "assembly/llir.h"
+
+uint64_t stack_slots_frame_size(struct llir_method *method);
+
+uint64_t stack_slots_allocate(struct llir_method *method, GHashTable *offsets,
+			      bool color);
@@ -0,0 +1,222 @@
+#include <string.h>
+
+#include "batch.h"
+#include "output.h"
+#include "scanner/source.h"
+#include "time_report.h"
+
+struct batch_file {
+	char *input_file;
+	char *output_file;
+	GString *output;
+	GString *errors;
+	int result;
+};
+
+struct batch_context {
+	batch_compile_t compile;
+	void *user_data;
+};
+
+struct batch *batch_new(const char *output_dir, const char *extension,
+			uint32_t jobs)
+{
+	struct batch *batch = g_new(struct batch, 1);
+	batch->input_files = g_ptr_array_new_with_free_func(g_free);
+	batch->output_dir = g_strdup(output_dir);
+	batch->extension = g_strdup(extension);
+	batch->jobs = MAX(jobs, 1);
+	return batch;
+}
+
+static int add_response_file(struct batch *batch, const char *file_name)
+{
+	char *contents;
+	GError *error = NULL;
+	if (!g_file_get_contents(file_name, &contents, NULL, &error)) {
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return -1;
+	}
+
+	char **lines = g_strsplit(contents, "\n", -1);
+	for (uint32_t i = 0; lines[i] != NULL; i++) {
+		char *line = g_strstrip(lines[i]);
+		if (line[0] != '\0')
+			g_ptr_array_add(batch->input_files, g_strdup(line));
+	}
+
+	g_strfreev(lines);
+	g_free(contents);
+	return 0;
+}
+
+int batch_add_input(struct batch *batch, const char *argument)
+{
+	// @<file> names a response file with one input per line
+	if (argument[0] == '@')
+		return add_response_file(batch, argument + 1);
+
+	g_ptr_array_add(batch->input_files, g_strdup(argument));
+	return 0;
+}
+
+static char *output_file_name(struct batch *batch, const char *input_file)
+{
+	char *base_name = g_path_get_basename(input_file);
+	if (g_str_has_suffix(base_name, ".dcf"))
+		base_name[strlen(base_name) - 4] = '\0';
+
+	char *file_name = g_strconcat(base_name, ".", batch->extension, NULL);
+	char *output_file =
+		g_build_filename(batch->output_dir, file_name, NULL);
+
+	g_free(file_name);
+	g_free(base_name);
+	return output_file;
+}
+
+static int check_output_files(struct batch_file *files, uint32_t count)
+{
+	GHashTable *inputs = g_hash_table_new(g_str_hash, g_str_equal);
+	int result = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		char *input_file =
+			g_hash_table_lookup(inputs, files[i].output_file);
+		if (input_file != NULL) {
+			g_printerr("%s and %s would both be written to %s\n",
+				   input_file, files[i].input_file,
+				   files[i].output_file);
+			result = -1;
+			continue;
+		}
+
+		g_hash_table_insert(inputs, files[i].output_file,
+				    files[i].input_file);
+	}
+
+	g_hash_table_unref(inputs);
+	return result;
+}
+
+static void compile_file(gpointer data, gpointer user_data)
+{
+	struct batch_file *file = data;
+	struct batch_context *context = user_data;
+
+	// every worker prints into the buffers of the file it is compiling
+	output_capture_begin(file->output, file->errors);
+	time_report_begin("file", file->input_file);
+
+	struct source *source = source_load(file->input_file);
+	if (source == NULL)
+		file->result = -1;
+	else
+		file->result = context->compile(file->input_file,
+						source->contents,
+						context->user_data);
+
+	GError *error = NULL;
+
+	if (file->result == 0 &&
+	    !g_file_set_contents(file->output_file, file->output->str,
+				 file->output->len, &error)) {
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		file->result = -1;
+	}
+
+	if (source != NULL)
+		source_free(source);
+	time_report_end();
+	output_capture_end();
+}
+
+static void compile_files(struct batch *batch, struct batch_file *files,
+			  uint32_t count, struct batch_context *context)
+{
+	GThreadPool *pool = g_thread_pool_new(
+		compile_file, context, MIN(batch->jobs, count), false, NULL);
+	for (uint32_t i = 0; i < count; i++)
+		g_thread_pool_push(pool, &files[i], NULL);
+	g_thread_pool_free(pool, false, true);
+}
+
+static int report_files(struct batch_file *files, uint32_t count,
+			int64_t elapsed)
+{
+	uint32_t failed = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (files[i].result != 0)
+			failed++;
+
+		g_printerr("%-6s %s\n", files[i].result == 0 ? "ok" : "failed",
+			   files[i].input_file);
+		g_printerr("%s", files[i].errors->str);
+	}
+
+	double seconds = elapsed / (double)G_USEC_PER_SEC;
+	g_printerr("%u files, %u failed in %.3f s (%.1f files/s)\n", count,
+		   failed, seconds, seconds > 0 ? count / seconds : 0.0);
+
+	return failed > 0 ? -1 : 0;
+}
+
+int batch_run(struct batch *batch, batch_compile_t compile, void *user_data)
+{
+	uint32_t count = batch->input_files->len;
+	if (count == 0) {
+		g_printerr("No input file passed in.\n");
+		return -1;
+	}
+
+	if (g_mkdir_with_parents(batch->output_dir, 0755) != 0) {
+		g_printerr("Failed to create output directory %s\n",
+			   batch->output_dir);
+		return -1;
+	}
+
+	struct batch_file *files = g_new(struct batch_file, count);
+	for (uint32_t i = 0; i < count; i++) {
+		char *input_file = g_ptr_array_index(batch->input_files, i);
+		files[i] = (struct batch_file){
+			.input_file = input_file,
+			.output_file = output_file_name(batch, input_file),
+			.output = g_string_new(NULL),
+			.errors = g_string_new(NULL),
+			.result = 0,
+		};
+	}
+
+	int result = check_output_files(files, count);
+	if (result == 0) {
+		struct batch_context context = {
+			.compile = compile,
+			.user_data = user_data,
+		};
+
+		int64_t start = g_get_monotonic_time();
+		compile_files(batch, files, count, &context);
+		result = report_files(files, count,
+				      g_get_monotonic_time() - start);
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		g_free(files[i].output_file);
+		g_string_free(files[i].output, true);
+		g_string_free(files[i].errors, true);
+	}
+	g_free(files);
+
+	return result;
+}
+
+void batch_free(struct batch *batch)
+{
+	g_ptr_array_unref(batch->input_files);
+	g_free(batch->output_dir);
+	g_free(batch->extension);
+	g_free(batch);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <glib.h>
+
+typedef int (*batch_compile_t)(const char *input_file, char *source,
+			       void *user_data);
+
+struct batch {
+	GPtrArray *input_files;
+	char *output_dir;
+	char *extension;
+	uint32_t jobs;
+};
+
+struct batch *batch_new(const char *output_dir, const char *extension,
+			uint32_t jobs);
+
+int batch_add_input(struct batch *batch, const char *argument);
+
+int batch_run(struct batch *batch, batch_compile_t compile, void *user_data);
+
+void batch_free(struct batch *batch);
@@ -0,0 +1,466 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "output.h"
+
+// trimming stops below the limit so the next few compiles do not trim again
+#define TRIM_PERCENT 90
+
+struct cache_entry {
+	char *path;
+	int64_t access_time;
+	uint64_t size;
+};
+
+struct cache_stats {
+	uint64_t hits[CACHE_KIND_COUNT];
+	uint64_t misses[CACHE_KIND_COUNT];
+	uint64_t size;
+};
+
+static const char *KIND_NAMES[] = {
+	[CACHE_KIND_FILE] = "file",
+	[CACHE_KIND_METHOD] = "method",
+};
+
+static char *hash_program(const char *program)
+{
+	char *path = g_find_program_in_path(program);
+	if (path == NULL)
+		return g_strdup("");
+
+	// the compiler binary itself is the version, so a rebuilt roast never
+	// sees the output of an older one
+	char *contents;
+	gsize length;
+	char *version = NULL;
+	if (g_file_get_contents(path, &contents, &length, NULL)) {
+		GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+		g_checksum_update(checksum, (guchar *)contents, length);
+		version = g_strdup(g_checksum_get_string(checksum));
+		g_checksum_free(checksum);
+		g_free(contents);
+	}
+
+	g_free(path);
+	return version != NULL ? version : g_strdup("");
+}
+
+// hashing the binary is the slowest part of opening a cache, so it happens
+// once per process, an empty version means the binary could not be read
+static const char *program_version(const char *program)
+{
+	static gsize version = 0;
+
+	if (g_once_init_enter(&version))
+		g_once_init_leave(&version, (gsize)hash_program(program));
+
+	return (const char *)version;
+}
+
+void cache_warm_up(const char *program)
+{
+	program_version(program);
+}
+
+struct cache *cache_new(const char *directory, const char *program,
+			uint64_t size_limit)
+{
+	const char *version = program_version(program);
+	if (version[0] == '\0') {
+		g_printerr("Failed to read %s, compiling without the cache.\n",
+			   program);
+		return NULL;
+	}
+
+	if (g_mkdir_with_parents(directory, 0755) != 0) {
+		g_printerr("Failed to create cache directory %s\n", directory);
+		return NULL;
+	}
+
+	struct cache *cache = g_new0(struct cache, 1);
+	cache->directory = g_strdup(directory);
+	cache->version = g_strdup(version);
+	cache->size_limit = size_limit;
+	g_mutex_init(&cache->lock);
+	return cache;
+}
+
+static GChecksum *key_checksum_new(struct cache *cache, const char *kind,
+				   const char *flags)
+{
+	GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	g_checksum_update(checksum, (guchar *)cache->version, -1);
+	g_checksum_update(checksum, (guchar *)"\n", 1);
+	g_checksum_update(checksum, (guchar *)kind, -1);
+	g_checksum_update(checksum, (guchar *)"\n", 1);
+	g_checksum_update(checksum, (guchar *)flags, -1);
+	g_checksum_update(checksum, (guchar *)"\n", 1);
+	return checksum;
+}
+
+static char *key_checksum_free(GChecksum *checksum)
+{
+	char *key = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+	return key;
+}
+
+static void checksum_printf(GChecksum *checksum, const char *format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	char *string = g_strdup_vprintf(format, arguments);
+	va_end(arguments);
+
+	g_checksum_update(checksum, (guchar *)string, -1);
+	g_free(string);
+}
+
+static void checksum_field(GChecksum *checksum, struct llir_field *field)
+{
+	checksum_printf(checksum, "%s %d %d %lld\n", field->identifier,
+			field->is_array, field->is_constant,
+			field->value_count);
+	g_checksum_update(checksum, (guchar *)field->values,
+			  field->value_count * sizeof(int64_t));
+}
+
+char *cache_file_key(struct cache *cache, const char *flags,
+		     const char *source)
+{
+	GChecksum *checksum = key_checksum_new(cache, "file", flags);
+	g_checksum_update(checksum, (guchar *)source, -1);
+	return key_checksum_free(checksum);
+}
+
+char *cache_program_key(struct cache *cache, const char *flags,
+			struct llir *llir)
+{
+	GChecksum *checksum = key_checksum_new(cache, "program", flags);
+	for (uint32_t i = 0; i < llir->fields->len; i++)
+		checksum_field(checksum, g_array_index(llir->fields,
+						       struct llir_field *, i));
+	return key_checksum_free(checksum);
+}
+
+char *cache_method_key(struct cache *cache, const char *program_key,
+		       struct llir_method *method)
+{
+	GChecksum *checksum = key_checksum_new(cache, "method", program_key);
+
+	// the printed LLIR covers the code and the block frequencies, the
+	// arguments and locals decide the frame layout
+	GString *text = g_string_new(NULL);
+	output_capture_begin(text, NULL);
+	llir_method_print(method);
+	output_capture_end();
+	g_checksum_update(checksum, (guchar *)text->str, text->len);
+	g_string_free(text, true);
+
+	checksum_printf(checksum, "profiled %d\n", method->profiled);
+	for (uint32_t i = 0; i < method->arguments->len; i++)
+		checksum_field(checksum, g_array_index(method->arguments,
+						       struct llir_field *, i));
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		checksum_printf(checksum, "block %u\n", block->id);
+		for (uint32_t j = 0; j < block->fields->len; j++)
+			checksum_field(checksum,
+				       g_array_index(block->fields,
+						     struct llir_field *, j));
+	}
+
+	return key_checksum_free(checksum);
+}
+
+static char *entry_directory(struct cache *cache, const char *key)
+{
+	char *shard = g_strndup(key, 2);
+	char *directory = g_build_filename(cache->directory, shard, NULL);
+	g_free(shard);
+	return directory;
+}
+
+static char *entry_path(struct cache *cache, const char *key)
+{
+	char *directory = entry_directory(cache, key);
+	char *path = g_build_filename(directory, key + 2, NULL);
+	g_free(directory);
+	return path;
+}
+
+char *cache_lookup(struct cache *cache, enum cache_kind kind,
+		   const char *key)
+{
+	char *path = entry_path(cache, key);
+	char *contents = NULL;
+	bool hit = g_file_get_contents(path, &contents, NULL, NULL);
+
+	// the modification time doubles as the last use for eviction
+	if (hit)
+		utime(path, NULL);
+	g_free(path);
+
+	g_mutex_lock(&cache->lock);
+	if (hit)
+		cache->hits[kind]++;
+	else
+		cache->misses[kind]++;
+	g_mutex_unlock(&cache->lock);
+
+	return contents;
+}
+
+static bool write_all(int descriptor, const char *contents, gsize length)
+{
+	while (length > 0) {
+		ssize_t written = write(descriptor, contents, length);
+		if (written < 0)
+			return false;
+
+		contents += written;
+		length -= written;
+	}
+
+	return true;
+}
+
+void cache_store(struct cache *cache, const char *key, const char *contents,
+		 gsize length)
+{
+	char *directory = entry_directory(cache, key);
+	char *temporary = g_build_filename(directory, "tmp.XXXXXX", NULL);
+	char *path = entry_path(cache, key);
+
+	// other roast processes only ever see complete entries, the rename
+	// replaces an entry atomically
+	int descriptor = -1;
+	if (g_mkdir_with_parents(directory, 0755) == 0)
+		descriptor = g_mkstemp(temporary);
+
+	if (descriptor >= 0) {
+		bool written = write_all(descriptor, contents, length);
+		if (close(descriptor) != 0 || !written ||
+		    rename(temporary, path) != 0) {
+			unlink(temporary);
+		} else {
+			g_mutex_lock(&cache->lock);
+			cache->stored_bytes += length;
+			g_mutex_unlock(&cache->lock);
+		}
+	}
+
+	g_free(path);
+	g_free(temporary);
+	g_free(directory);
+}
+
+static uint64_t *stats_counter(struct cache_stats *stats, const char *name)
+{
+	for (uint32_t i = 0; i < CACHE_KIND_COUNT; i++) {
+		size_t length = strlen(KIND_NAMES[i]);
+		if (strncmp(name, KIND_NAMES[i], length) != 0)
+			continue;
+
+		if (strcmp(name + length, "_hits") == 0)
+			return &stats->hits[i];
+		if (strcmp(name + length, "_misses") == 0)
+			return &stats->misses[i];
+	}
+
+	if (strcmp(name, "size") == 0)
+		return &stats->size;
+
+	return NULL;
+}
+
+static void read_stats(struct cache *cache, struct cache_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	char *path = g_build_filename(cache->directory, "stats", NULL);
+	char *contents;
+	if (!g_file_get_contents(path, &contents, NULL, NULL)) {
+		g_free(path);
+		return;
+	}
+
+	char **lines = g_strsplit(contents, "\n", -1);
+	for (uint32_t i = 0; lines[i] != NULL; i++) {
+		char name[32];
+		unsigned long long value;
+		if (sscanf(lines[i], "%31s %llu", name, &value) != 2)
+			continue;
+
+		uint64_t *counter = stats_counter(stats, name);
+		if (counter != NULL)
+			*counter = value;
+	}
+
+	g_strfreev(lines);
+	g_free(contents);
+	g_free(path);
+}
+
+static void write_stats(struct cache *cache, struct cache_stats *stats)
+{
+	GString *contents = g_string_new(NULL);
+	for (uint32_t i = 0; i < CACHE_KIND_COUNT; i++) {
+		g_string_append_printf(contents, "%s_hits %llu\n",
+				       KIND_NAMES[i], stats->hits[i]);
+		g_string_append_printf(contents, "%s_misses %llu\n",
+				       KIND_NAMES[i], stats->misses[i]);
+	}
+	g_string_append_printf(contents, "size %llu\n", stats->size);
+
+	char *path = g_build_filename(cache->directory, "stats", NULL);
+	g_file_set_contents(path, contents->str, contents->len, NULL);
+	g_free(path);
+	g_string_free(contents, true);
+}
+
+static void add_entries(GArray *entries, const char *directory)
+{
+	GDir *dir = g_dir_open(directory, 0, NULL);
+	if (dir == NULL)
+		return;
+
+	const char *name;
+	while ((name = g_dir_read_name(dir)) != NULL) {
+		char *path = g_build_filename(directory, name, NULL);
+		struct stat status;
+		if (stat(path, &status) != 0 || !S_ISREG(status.st_mode)) {
+			g_free(path);
+			continue;
+		}
+
+		struct cache_entry entry = {
+			.path = path,
+			.access_time = status.st_mtime,
+			.size = status.st_size,
+		};
+		g_array_append_val(entries, entry);
+	}
+
+	g_dir_close(dir);
+}
+
+static gint compare_entries(gconstpointer a, gconstpointer b)
+{
+	const struct cache_entry *left = a;
+	const struct cache_entry *right = b;
+	return (left->access_time > right->access_time) -
+	       (left->access_time < right->access_time);
+}
+
+static uint64_t trim(struct cache *cache)
+{
+	GArray *entries = g_array_new(false, false, sizeof(struct cache_entry));
+
+	GDir *dir = g_dir_open(cache->directory, 0, NULL);
+	if (dir != NULL) {
+		const char *name;
+		while ((name = g_dir_read_name(dir)) != NULL) {
+			if (strlen(name) != 2)
+				continue;
+
+			char *shard =
+				g_build_filename(cache->directory, name, NULL);
+			add_entries(entries, shard);
+			g_free(shard);
+		}
+		g_dir_close(dir);
+	}
+
+	uint64_t size = 0;
+	for (uint32_t i = 0; i < entries->len; i++)
+		size += g_array_index(entries, struct cache_entry, i).size;
+
+	// least recently used entries go first
+	g_array_sort(entries, compare_entries);
+	uint64_t target = cache->size_limit / 100 * TRIM_PERCENT;
+	for (uint32_t i = 0; i < entries->len; i++) {
+		struct cache_entry *entry =
+			&g_array_index(entries, struct cache_entry, i);
+		if (size > target && unlink(entry->path) == 0)
+			size -= entry->size;
+		g_free(entry->path);
+	}
+
+	g_array_free(entries, true);
+	return size;
+}
+
+void cache_flush(struct cache *cache)
+{
+	// every roast process sharing the directory merges its counters and
+	// trims under the same lock
+	char *lock_path = g_build_filename(cache->directory, "lock", NULL);
+	int lock = open(lock_path, O_RDWR | O_CREAT, 0644);
+	if (lock >= 0)
+		flock(lock, LOCK_EX);
+
+	struct cache_stats stats;
+	read_stats(cache, &stats);
+	for (uint32_t i = 0; i < CACHE_KIND_COUNT; i++) {
+		stats.hits[i] += cache->hits[i];
+		stats.misses[i] += cache->misses[i];
+	}
+
+	// the running size is only an estimate between trims, overwritten
+	// entries are counted twice
+	stats.size += cache->stored_bytes;
+	if (stats.size > cache->size_limit)
+		stats.size = trim(cache);
+	write_stats(cache, &stats);
+
+	if (lock >= 0) {
+		flock(lock, LOCK_UN);
+		close(lock);
+	}
+	g_free(lock_path);
+}
+
+static void print_stats_row(const char *name, uint64_t hits, uint64_t misses)
+{
+	uint64_t lookups = hits + misses;
+	g_printerr("%-16s %10llu %10llu %9.1f%%\n", name, hits, misses,
+		   lookups > 0 ? 100.0 * hits / lookups : 0.0);
+}
+
+void cache_print_stats(struct cache *cache)
+{
+	struct cache_stats stats;
+	read_stats(cache, &stats);
+
+	g_printerr("Cache            %10s %10s %10s\n", "Hits", "Misses",
+		   "Hit rate");
+	print_stats_row("run files", cache->hits[CACHE_KIND_FILE],
+			cache->misses[CACHE_KIND_FILE]);
+	print_stats_row("run methods", cache->hits[CACHE_KIND_METHOD],
+			cache->misses[CACHE_KIND_METHOD]);
+	print_stats_row("total files", stats.hits[CACHE_KIND_FILE],
+			stats.misses[CACHE_KIND_FILE]);
+	print_stats_row("total methods", stats.hits[CACHE_KIND_METHOD],
+			stats.misses[CACHE_KIND_METHOD]);
+	g_printerr("%.1f of %.1f MB used in %s\n", stats.size / 1048576.0,
+		   cache->size_limit / 1048576.0, cache->directory);
+}
+
+void cache_free(struct cache *cache)
+{
+	g_mutex_clear(&cache->lock);
+	g_free(cache->directory);
+	g_free(cache->version);
+	g_free(cache);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <glib.h>
+
+#include "assembly/llir.h"
+
+enum cache_kind {
+	CACHE_KIND_FILE,
+	CACHE_KIND_METHOD,
+	CACHE_KIND_COUNT,
+};
+
+struct cache {
+	char *directory;
+	char *version;
+	uint64_t size_limit;
+	GMutex lock;
+	uint64_t hits[CACHE_KIND_COUNT];
+	uint64_t misses[CACHE_KIND_COUNT];
+	uint64_t stored_bytes;
+};
+
+void cache_warm_up(const char *program);
+
+struct cache *cache_new(const char *directory, const char *program,
+			uint64_t size_limit);
+
+char *cache_file_key(struct cache *cache, const char *flags,
+		     const char *source);
+char *cache_program_key(struct cache *cache, const char *flags,
+			struct llir *llir);
+char *cache_method_key(struct cache *cache, const char *program_key,
+		       struct llir_method *method);
+
+char *cache_lookup(struct cache *cache, enum cache_kind kind,
+		   const char *key);
+void cache_store(struct cache *cache, const char *key, const char *contents,
+		 gsize length);
+
+void cache_flush(struct cache *cache);
+void cache_print_stats(struct cache *cache);
+void cache_free(struct cache *cache);
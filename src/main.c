@@ -1,14 +1,24 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <glib.h>
 
 #include "scanner/scanner.h"
+#include "scanner/source.h"
 #include "parser/parser.h"
 #include "semantics/semantics.h"
 #include "assembly/llir_generator.h"
 #include "assembly/code_generator.h"
 #include "assembly/ssa.h"
 #include "optimizations/optimizations.h"
+#include "time_report.h"
+#include "batch.h"
+#include "cache.h"
+#include "output.h"
+#include "server.h"
+
+#define DEFAULT_PROFILE_FILE "roast.profile"
+#define DEFAULT_CACHE_SIZE 256
 
 enum target {
 	TARGET_SCAN,
@@ -20,15 +30,44 @@ enum target {
 struct options {
 	enum target target;
 	char *output_file;
+	char *output_dir;
 	enum optimzation optimizations;
+	char *passes;
+	uint32_t unroll_factor;
+	uint32_t jobs;
+	bool stream;
+	bool avx2;
+	bool frame_report;
+	bool time_report;
+	bool time_report_methods;
+	char *time_trace;
+	char *profile_generate;
+	char *profile_use;
 	bool debug;
+	char *cache_dir;
+	uint64_t cache_size;
+	bool cache_stats;
+	struct cache *cache;
+	char *cache_flags;
 	char *input_file;
+	GPtrArray *input_files;
 };
 
 static void free_options(struct options *options)
 {
 	g_free(options->output_file);
+	g_free(options->output_dir);
+	g_free(options->passes);
+	g_free(options->time_trace);
+	g_free(options->profile_generate);
+	g_free(options->profile_use);
+	g_free(options->cache_dir);
+	g_free(options->cache_flags);
+	if (options->cache != NULL)
+		cache_free(options->cache);
 	g_free(options->input_file);
+	if (options->input_files != NULL)
+		g_ptr_array_unref(options->input_files);
 }
 
 static int parse_target(char *target, struct options *options)
@@ -78,6 +117,40 @@ static int parse_optimizations(char *optimizations, struct options *options)
 			options->optimizations |= OPTIMIZATION_PH;
 		else if (g_strcmp0(optimization, "-ph") == 0)
 			options->optimizations &= ~OPTIMIZATION_PH;
+		else if (g_strcmp0(optimization, "inline") == 0)
+			options->optimizations |= OPTIMIZATION_INLINE;
+		else if (g_strcmp0(optimization, "-inline") == 0)
+			options->optimizations &= ~OPTIMIZATION_INLINE;
+		else if (g_strcmp0(optimization, "tce") == 0)
+			options->optimizations |= OPTIMIZATION_TCE;
+		else if (g_strcmp0(optimization, "-tce") == 0)
+			options->optimizations &= ~OPTIMIZATION_TCE;
+		else if (g_strcmp0(optimization, "ipo") == 0)
+			options->optimizations |= OPTIMIZATION_IPO;
+		else if (g_strcmp0(optimization, "-ipo") == 0)
+			options->optimizations &= ~OPTIMIZATION_IPO;
+		else if (g_strcmp0(optimization, "cfg") == 0)
+			options->optimizations |= OPTIMIZATION_CFG;
+		else if (g_strcmp0(optimization, "-cfg") == 0)
+			options->optimizations &= ~OPTIMIZATION_CFG;
+		else if (g_strcmp0(optimization, "unroll") == 0)
+			options->optimizations |= OPTIMIZATION_UNROLL;
+		else if (g_strcmp0(optimization, "-unroll") == 0)
+			options->optimizations &= ~OPTIMIZATION_UNROLL;
+		else if (g_strcmp0(optimization, "vectorize") == 0)
+			options->optimizations |= OPTIMIZATION_VECTORIZE;
+		else if (g_strcmp0(optimization, "-vectorize") == 0)
+			options->optimizations &= ~OPTIMIZATION_VECTORIZE;
+		else if (g_strcmp0(optimization, "slots") == 0)
+			options->optimizations |= OPTIMIZATION_SLOTS;
+		else if (g_strcmp0(optimization, "-slots") == 0)
+			options->optimizations &= ~OPTIMIZATION_SLOTS;
+		else if (g_strcmp0(optimization, "0") == 0)
+			options->optimizations = 0;
+		else if (g_strcmp0(optimization, "1") == 0)
+			options->optimizations = OPTIMIZATION_LEVEL_1;
+		else if (g_strcmp0(optimization, "2") == 0)
+			options->optimizations = OPTIMIZATION_ALL;
 		else if (g_strcmp0(optimization, "all") == 0)
 			options->optimizations |= OPTIMIZATION_ALL;
 		else if (g_strcmp0(optimization, "-all") == 0)
@@ -94,12 +167,47 @@ static int parse_optimizations(char *optimizations, struct options *options)
 	return 0;
 }
 
+static void normalize_arguments(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++) {
+		if (strlen(argv[i]) == 3 && g_str_has_prefix(argv[i], "-O") &&
+		    argv[i][2] >= '0' && argv[i][2] <= '2')
+			argv[i] = g_strconcat("--optimizations=", argv[i] + 2,
+					      NULL);
+		else if (g_str_has_prefix(argv[i], "-passes="))
+			argv[i] = g_strconcat("-", argv[i], NULL);
+		else if (strcmp(argv[i], "-fprofile-generate") == 0 ||
+			 strcmp(argv[i], "-fprofile-use") == 0)
+			argv[i] = g_strconcat("--", argv[i] + 2, "=",
+					      DEFAULT_PROFILE_FILE, NULL);
+		else if (g_str_has_prefix(argv[i], "-fprofile-generate=") ||
+			 g_str_has_prefix(argv[i], "-fprofile-use="))
+			argv[i] = g_strconcat("--", argv[i] + 2, NULL);
+	}
+}
+
 static int parse_options(int argc, char **argv, struct options *options)
 {
 	char *target = NULL;
 	char *optimizations = NULL;
+	char *passes = NULL;
 	char *output_file = NULL;
-	bool debug = false;
+	char *output_dir = NULL;
+	int unroll_factor = 4;
+	int jobs = 1;
+	gboolean stream = false;
+	gboolean avx2 = false;
+	gboolean frame_report = false;
+	gboolean time_report = false;
+	gboolean time_report_methods = false;
+	char *time_trace = NULL;
+	char *profile_generate = NULL;
+	char *profile_use = NULL;
+	gboolean debug = false;
+	char *cache_dir = NULL;
+	int cache_size = DEFAULT_CACHE_SIZE;
+	gboolean cache_stats = false;
+	char *server_socket = NULL;
 
 	const GOptionEntry option_entries[] = {
 		{
@@ -121,6 +229,16 @@ static int parse_options(int argc, char **argv, struct options *options)
 			.description = "Writes output to <output>",
 			.arg_description = "<output>",
 		},
+		{
+			.long_name = "output-dir",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_FILENAME,
+			.arg_data = (void *)&output_dir,
+			.description =
+				"Compiles every input file, or every file listed in an @<file> argument, into <dir> using -j workers.",
+			.arg_description = "<dir>",
+		},
 		{
 			.long_name = "optimizations",
 			.short_name = 'O',
@@ -128,9 +246,169 @@ static int parse_options(int argc, char **argv, struct options *options)
 			.arg = G_OPTION_ARG_STRING,
 			.arg_data = (void *)&optimizations,
 			.description =
-				"<optimization> is one of 'cf', 'cp', 'dce' or 'all'.",
+				"<optimization> is one of 'cf', 'cp', 'dce', 'inline', 'tce', 'ipo', 'cfg', 'unroll', 'vectorize', 'slots', 'all' or one of the levels '0', '1' and '2'.",
 			.arg_description = "<optimization>,...",
 		},
+		{
+			.long_name = "passes",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_STRING,
+			.arg_data = (void *)&passes,
+			.description =
+				"Runs the LLIR passes <pass>,... in order instead of the '-O' pipeline. Consecutive 'cf', 'cp', 'dce' and 'cfg' passes are repeated per method until nothing changes.",
+			.arg_description = "<pass>,...",
+		},
+		{
+			.long_name = "unroll-factor",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_INT,
+			.arg_data = (void *)&unroll_factor,
+			.description =
+				"Unrolls counted loops <factor> times with '-O unroll' (default 4).",
+			.arg_description = "<factor>",
+		},
+		{
+			.long_name = "jobs",
+			.short_name = 'j',
+			.flags = 0,
+			.arg = G_OPTION_ARG_INT,
+			.arg_data = (void *)&jobs,
+			.description =
+				"Scans large sources in chunks and optimizes and generates code for up to <n> methods in parallel, 0 uses every processor (default 1).",
+			.arg_description = "<n>",
+		},
+		{
+			.long_name = "stream",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_NONE,
+			.arg_data = (void *)&stream,
+			.description =
+				"Lowers, optimizes and emits one method at a time to bound memory use, skipping the 'tce', 'inline' and 'ipo' passes that need the whole program.",
+			.arg_description = NULL,
+		},
+		{
+			.long_name = "avx2",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_NONE,
+			.arg_data = (void *)&avx2,
+			.description =
+				"Emits AVX2 instead of SSE2 code with '-O vectorize'.",
+			.arg_description = NULL,
+		},
+		{
+			.long_name = "frame-report",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_NONE,
+			.arg_data = (void *)&frame_report,
+			.description =
+				"Prints the stack frame size of every method before and after stack slot coloring.",
+			.arg_description = NULL,
+		},
+		{
+			.long_name = "time-report",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_NONE,
+			.arg_data = (void *)&time_report,
+			.description =
+				"Prints wall time, CPU time, allocations and peak RSS growth of every compiler phase and optimization pass.",
+			.arg_description = NULL,
+		},
+		{
+			.long_name = "time-report-methods",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_NONE,
+			.arg_data = (void *)&time_report_methods,
+			.description =
+				"Adds a per-method breakdown of optimization passes and code generation to --time-report.",
+			.arg_description = NULL,
+		},
+		{
+			.long_name = "time-trace",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_FILENAME,
+			.arg_data = (void *)&time_trace,
+			.description =
+				"Writes the --time-report data as Chrome trace event JSON to <file>.",
+			.arg_description = "<file>",
+		},
+		{
+			.long_name = "profile-generate",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_FILENAME,
+			.arg_data = (void *)&profile_generate,
+			.description =
+				"Instruments every block with a counter and writes the counts to <file> when the program exits.",
+			.arg_description = "<file>",
+		},
+		{
+			.long_name = "profile-use",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_FILENAME,
+			.arg_data = (void *)&profile_use,
+			.description =
+				"Uses the block counts in <file> for block layout, inlining and unrolling. Compile with the same flags as the instrumented build.",
+			.arg_description = "<file>",
+		},
+		{
+			.long_name = "cache-dir",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_FILENAME,
+			.arg_data = (void *)&cache_dir,
+			.description =
+				"Reuses the output of earlier compiles of the same source, and the assembly of unchanged methods, from <dir>.",
+			.arg_description = "<dir>",
+		},
+		{
+			.long_name = "cache-size",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_INT,
+			.arg_data = (void *)&cache_size,
+			.description =
+				"Evicts the least recently used entries once --cache-dir grows beyond <MB> megabytes (default 256).",
+			.arg_description = "<MB>",
+		},
+		{
+			.long_name = "cache-stats",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_NONE,
+			.arg_data = (void *)&cache_stats,
+			.description =
+				"Prints the --cache-dir hits and misses of this run and of all runs so far.",
+			.arg_description = NULL,
+		},
+		{
+			.long_name = "server",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_FILENAME,
+			.arg_data = (void *)&server_socket,
+			.description =
+				"Keeps a warm roast listening on the Unix socket <socket> and compiles every --connect request in a fork of it.",
+			.arg_description = "<socket>",
+		},
+		{
+			.long_name = "connect",
+			.short_name = 0,
+			.flags = 0,
+			.arg = G_OPTION_ARG_FILENAME,
+			.arg_data = (void *)&server_socket,
+			.description =
+				"Hands the rest of the command line to the --server on <socket>, compiles locally if none is listening.",
+			.arg_description = "<socket>",
+		},
 		{
 			.long_name = "debug",
 			.short_name = 'd',
@@ -143,6 +421,8 @@ static int parse_options(int argc, char **argv, struct options *options)
 		{ 0 },
 	};
 
+	normalize_arguments(argc, argv);
+
 	GOptionContext *context = g_option_context_new("- decaf compiler.");
 	g_option_context_add_main_entries(context, option_entries, NULL);
 
@@ -154,17 +434,66 @@ static int parse_options(int argc, char **argv, struct options *options)
 		return -1;
 	}
 
-	if (argc != 2) {
-		g_printerr(argc < 2 ? "No input file passed in.\n" :
-				      "Too many input files passed in.\n");
-		options->input_file = NULL;
+	options->input_file = argc >= 2 ? g_strdup(argv[1]) : NULL;
+	options->input_files = g_ptr_array_new_with_free_func(g_free);
+	for (int i = 1; i < argc; i++)
+		g_ptr_array_add(options->input_files, g_strdup(argv[i]));
+
+	if (argc < 2) {
+		g_printerr("No input file passed in.\n");
+		result = -1;
+	} else if (output_dir == NULL && (argc > 2 || argv[1][0] == '@')) {
+		g_printerr("Multiple input files require --output-dir.\n");
+		result = -1;
+	}
+
+	if (output_dir != NULL && output_file != NULL) {
+		g_printerr("--output and --output-dir cannot be combined.\n");
 		result = -1;
-	} else {
-		options->input_file = g_strdup(argv[1]);
 	}
 
 	options->output_file = output_file;
+	options->output_dir = output_dir;
+	options->stream = stream;
+	options->avx2 = avx2;
+	options->frame_report = frame_report;
+	options->time_report = time_report || time_report_methods;
+	options->time_report_methods = time_report_methods;
+	options->time_trace = time_trace;
+	options->profile_generate = profile_generate;
+	options->profile_use = profile_use;
 	options->debug = debug;
+	options->cache_dir = cache_dir;
+	options->cache_stats = cache_stats;
+
+	if (stream && (profile_generate != NULL || profile_use != NULL)) {
+		g_printerr(
+			"--stream cannot be combined with --profile-generate or --profile-use.\n");
+		result = -1;
+	}
+
+	if (cache_size < 1) {
+		g_printerr("Cache size must be at least 1 MB.\n");
+		result = -1;
+	}
+	options->cache_size = (uint64_t)cache_size * 1024 * 1024;
+
+	if (cache_stats && cache_dir == NULL) {
+		g_printerr("--cache-stats requires --cache-dir.\n");
+		result = -1;
+	}
+
+	if (unroll_factor < 1) {
+		g_printerr("Unroll factor must be at least 1.\n");
+		result = -1;
+	}
+	options->unroll_factor = unroll_factor;
+
+	if (jobs < 0) {
+		g_printerr("Job count must not be negative.\n");
+		result = -1;
+	}
+	options->jobs = jobs == 0 ? g_get_num_processors() : (uint32_t)jobs;
 
 	if (parse_target(target, options) != 0)
 		result = -1;
@@ -172,8 +501,19 @@ static int parse_options(int argc, char **argv, struct options *options)
 	if (parse_optimizations(optimizations, options) != 0)
 		result = -1;
 
+	options->passes = passes;
+	if (passes != NULL) {
+		struct optimization_pipeline *pipeline =
+			optimization_pipeline_parse(passes);
+		if (pipeline == NULL)
+			result = -1;
+		else
+			optimization_pipeline_free(pipeline);
+	}
+
 	g_free(target);
 	g_free(optimizations);
+	g_free(server_socket);
 	g_option_context_free(context);
 	return result;
 }
@@ -188,83 +528,281 @@ static int set_output_file(char *output_file)
 	return 0;
 }
 
-static int get_input_file_contents(char *input_file, char **file_contents)
-{
-	GError *error = NULL;
-	if (!g_file_get_contents(input_file, file_contents, NULL, &error)) {
-		g_printerr("%s\n", error->message);
-		return -1;
-	}
-
-	return 0;
-}
-
 static int run_scan_target(char *file_name, char *source, bool print_output,
-			   GArray **token_list)
+			   uint32_t jobs, struct token_stream **tokens)
 {
 	struct scanner *scanner = scanner_new();
 
+	time_report_begin("scan", NULL);
 	int result = scanner_tokenize(scanner, file_name, source, print_output,
-				      token_list);
+				      jobs, tokens);
+	time_report_end();
 
 	scanner_free(scanner);
 	return result;
 }
 
-static int run_parse_target(char *file_name, char *source,
+static int run_parse_target(char *file_name, char *source, uint32_t jobs,
 			    struct ast_node **ast)
 {
-	GArray *tokens;
-	if (run_scan_target(file_name, source, false, &tokens) != 0)
+	struct token_stream *tokens;
+	if (run_scan_target(file_name, source, false, jobs, &tokens) != 0)
 		return -1;
 
 	struct parser *parser = parser_new();
 
+	time_report_begin("parse", NULL);
 	int result = parser_parse(parser, tokens, ast);
+	time_report_end();
 
 	parser_free(parser);
-	g_array_free(tokens, true);
+	token_stream_free(tokens);
 	return result;
 }
 
 static int run_intermediate_target(char *file_name, char *source,
-				   struct ir_program **ir)
+				   uint32_t jobs, struct ir_program **ir)
 {
 	struct ast_node *ast;
-	if (run_parse_target(file_name, source, &ast) != 0)
+	if (run_parse_target(file_name, source, jobs, &ast) != 0)
 		return -1;
 
 	struct semantics *semantics = semantics_new();
 
-	int result = semantics_analyze(semantics, ast, ir);
+	struct token_unit unit = {
+		.file_name = file_name,
+		.source = source,
+	};
+	int result = semantics_analyze(semantics, &unit, ast, ir);
 
 	semantics_free(semantics);
 	ast_node_free(ast);
 	return result;
 }
 
-static int run_assembly_target(char *file_name, char *source,
-			       enum optimzation optimizations, bool debug)
+static bool caches_methods(struct options *options)
+{
+	// instrumentation numbers blocks across the whole program and the
+	// reports print per method, so those always regenerate every method.
+	// streamed methods are gone before the next one is looked up
+	return options->cache != NULL && !options->debug &&
+	       !options->frame_report && !options->stream &&
+	       options->profile_generate == NULL;
+}
+
+static void optimize_uncached_methods(struct options *options,
+				      struct optimization_pipeline *pipeline,
+				      struct llir *llir,
+				      GHashTable *method_texts,
+				      GHashTable *method_keys)
+{
+	// the passes up to the last module pass see the whole program, the
+	// function passes after it only run for methods missing from the cache
+	struct optimization_pipeline *tail =
+		optimization_pipeline_split(pipeline);
+	optimization_pipeline_run(pipeline, llir, options->jobs);
+
+	time_report_begin("cache", NULL);
+	char *program_key =
+		cache_program_key(options->cache, options->cache_flags, llir);
+
+	struct llir uncached = *llir;
+	uncached.methods =
+		g_array_new(false, false, sizeof(struct llir_method *));
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		char *key =
+			cache_method_key(options->cache, program_key, method);
+		char *text =
+			cache_lookup(options->cache, CACHE_KIND_METHOD, key);
+
+		if (text != NULL) {
+			g_hash_table_insert(method_texts, method, text);
+			g_free(key);
+		} else {
+			g_hash_table_insert(method_keys, method, key);
+			g_array_append_val(uncached.methods, method);
+		}
+	}
+
+	g_free(program_key);
+	time_report_end();
+
+	optimization_pipeline_run(tail, &uncached, options->jobs);
+	g_array_free(uncached.methods, true);
+	optimization_pipeline_free(tail);
+}
+
+static void store_cached_methods(struct cache *cache, GHashTable *method_keys,
+				 GHashTable *method_texts)
+{
+	GHashTableIter iterator;
+	gpointer method, key;
+
+	g_hash_table_iter_init(&iterator, method_keys);
+	while (g_hash_table_iter_next(&iterator, &method, &key)) {
+		char *text = g_hash_table_lookup(method_texts, method);
+		cache_store(cache, key, text, strlen(text));
+	}
+}
+
+static struct llir_generator *new_llir_generator(struct options *options,
+						 struct profile *profile)
+{
+	enum optimzation optimizations = options->optimizations;
+
+	uint32_t vector_width = 0;
+	if (optimizations & OPTIMIZATION_VECTORIZE)
+		vector_width = options->avx2 ? 4 : 2;
+
+	return llir_generator_new(optimizations & OPTIMIZATION_UNROLL ?
+					  options->unroll_factor :
+					  0,
+				  vector_width, profile, options->debug);
+}
+
+static struct optimization_pipeline *new_pipeline(struct options *options)
+{
+	return options->passes != NULL ?
+		       optimization_pipeline_parse(options->passes) :
+		       optimization_pipeline_new(options->optimizations);
+}
+
+static struct code_generator *new_code_generator(struct options *options,
+						 GHashTable *method_texts)
+{
+	enum optimzation optimizations = options->optimizations;
+
+	return code_generator_new(optimizations & OPTIMIZATION_PH,
+				  options->avx2,
+				  optimizations & OPTIMIZATION_SLOTS,
+				  options->frame_report, options->jobs,
+				  options->profile_generate, method_texts);
+}
+
+static void stream_assembly(struct options *options, struct ir_program *ir)
+{
+	struct llir_generator *llir_generator =
+		new_llir_generator(options, NULL);
+	struct optimization_pipeline *pipeline = new_pipeline(options);
+	optimization_pipeline_drop_module_passes(pipeline);
+
+	// only the globals stay around, every method is lowered, optimized,
+	// emitted and freed before the next one
+	struct llir *llir =
+		llir_generator_generate_globals(llir_generator, ir);
+	struct code_generator *generator = NULL;
+	if (!options->debug) {
+		generator = new_code_generator(options, NULL);
+		code_generator_start(generator, llir);
+	}
+
+	for (uint32_t i = 0; i < ir->methods->len; i++) {
+		struct ir_method *ir_method =
+			g_array_index(ir->methods, struct ir_method *, i);
+
+		time_report_begin("llir", NULL);
+		struct llir_method *method = llir_generator_generate_method(
+			llir_generator, ir_method);
+		time_report_end();
+		g_array_append_val(llir->methods, method);
+
+		time_report_begin("optimize", NULL);
+		optimization_pipeline_run(pipeline, llir, 1);
+		time_report_end();
+
+		if (options->debug) {
+			llir_method_print(method);
+		} else {
+			time_report_begin("codegen", NULL);
+			code_generator_generate_method(generator, method);
+			time_report_end();
+		}
+
+		// the LLIR borrows names and strings from the IR method
+		g_array_set_size(llir->methods, 0);
+		llir_method_free(method);
+		ir_method_free(ir_method);
+	}
+	g_array_set_size(ir->methods, 0);
+
+	if (generator != NULL) {
+		code_generator_finish(generator);
+		code_generator_free(generator);
+	}
+
+	optimization_pipeline_free(pipeline);
+	llir_generator_free(llir_generator);
+	llir_free(llir);
+}
+
+static int run_assembly_target(struct options *options, char *source)
 {
 	struct ir_program *ir;
-	if (run_intermediate_target(file_name, source, &ir) != 0)
+	if (run_intermediate_target(options->input_file, source, options->jobs,
+				    &ir) != 0)
 		return -1;
 
-	struct llir_generator *llir_generator = llir_generator_new();
+	if (options->stream) {
+		stream_assembly(options, ir);
+		ir_program_free(ir);
+		return 0;
+	}
+
+	struct profile *profile = NULL;
+	if (options->profile_use != NULL) {
+		profile = profile_load(options->profile_use);
+		if (profile == NULL) {
+			ir_program_free(ir);
+			return -1;
+		}
+	}
+
+	struct llir_generator *llir_generator =
+		new_llir_generator(options, profile);
+	time_report_begin("llir", NULL);
 	struct llir *llir = llir_generator_generate_llir(llir_generator, ir);
 	llir_generator_free(llir_generator);
+	time_report_end();
 
-	optimization_apply(llir, optimizations);
+	struct optimization_pipeline *pipeline = new_pipeline(options);
+	GHashTable *method_texts = NULL;
+	GHashTable *method_keys = NULL;
+	time_report_begin("optimize", NULL);
+	if (caches_methods(options)) {
+		method_texts = g_hash_table_new_full(
+			g_direct_hash, g_direct_equal, NULL, g_free);
+		method_keys = g_hash_table_new_full(
+			g_direct_hash, g_direct_equal, NULL, g_free);
+		optimize_uncached_methods(options, pipeline, llir, method_texts,
+					  method_keys);
+	} else {
+		optimization_pipeline_run(pipeline, llir, options->jobs);
+	}
+	time_report_end();
+	optimization_pipeline_free(pipeline);
 
-	if (debug) {
+	if (options->debug) {
 		llir_print(llir);
 	} else {
 		struct code_generator *generator =
-			code_generator_new(optimizations & OPTIMIZATION_PH);
+			new_code_generator(options, method_texts);
+		time_report_begin("codegen", NULL);
 		code_generator_generate(generator, llir);
+		time_report_end();
 		code_generator_free(generator);
 	}
 
+	if (method_keys != NULL) {
+		store_cached_methods(options->cache, method_keys,
+				     method_texts);
+		g_hash_table_unref(method_keys);
+		g_hash_table_unref(method_texts);
+	}
+
+	if (profile != NULL)
+		profile_free(profile);
 	llir_free(llir);
 	ir_program_free(ir);
 	return 0;
@@ -274,43 +812,247 @@ static int run_target(struct options *options, char *source)
 {
 	switch (options->target) {
 	case TARGET_SCAN:
-		return run_scan_target(options->input_file, source, true, NULL);
+		return run_scan_target(options->input_file, source, true,
+				       options->jobs, NULL);
 	case TARGET_PARSE:
-		return run_parse_target(options->input_file, source, NULL);
+		return run_parse_target(options->input_file, source,
+					options->jobs, NULL);
 	case TARGET_INTER:
 		return run_intermediate_target(options->input_file, source,
-					       NULL);
+					       options->jobs, NULL);
 	case TARGET_ASSEMBLY:
-		return run_assembly_target(options->input_file, source,
-					   options->optimizations,
-					   options->debug);
+		return run_assembly_target(options, source);
 	default:
 		g_assert(!"Unknown target");
 		return -1;
 	}
 }
 
-int main(int argc, char *argv[])
+static char *cache_flags(struct options *options)
+{
+	// everything besides the source that changes the output, the job
+	// count does not
+	GString *flags = g_string_new(NULL);
+	g_string_append_printf(
+		flags,
+		"target %d\noptimizations %u\npasses %s\nunroll %u\navx2 %d\n"
+		"debug %d\nprofile-generate %s\n",
+		options->target, options->optimizations,
+		options->passes != NULL ? options->passes : "",
+		options->unroll_factor, options->avx2, options->debug,
+		options->profile_generate != NULL ? options->profile_generate :
+						    "");
+
+	char *profile;
+	if (options->profile_use != NULL &&
+	    g_file_get_contents(options->profile_use, &profile, NULL, NULL)) {
+		g_string_append(flags, "profile-use\n");
+		g_string_append(flags, profile);
+		g_free(profile);
+	}
+
+	return g_string_free(flags, false);
+}
+
+static int run_cached_target(struct options *options, char *source)
+{
+	// capturing the whole output to store it would undo the memory bound
+	// of --stream, so streamed compiles bypass the cache
+	if (options->cache == NULL || options->frame_report || options->stream)
+		return run_target(options, source);
+
+	char *key = cache_file_key(options->cache, options->cache_flags,
+				   source);
+	char *output = cache_lookup(options->cache, CACHE_KIND_FILE, key);
+	if (output != NULL) {
+		g_print("%s", output);
+		g_free(output);
+		g_free(key);
+		return 0;
+	}
+
+	// errors are not cached, so a failing file reports them every time
+	GString *text = g_string_new(NULL);
+	output_capture_begin(text, NULL);
+	int result = run_target(options, source);
+	output_capture_end();
+
+	g_print("%s", text->str);
+	if (result == 0)
+		cache_store(options->cache, key, text->str, text->len);
+
+	g_string_free(text, true);
+	g_free(key);
+	return result;
+}
+
+static void finish_cache(struct options *options)
+{
+	if (options->cache == NULL)
+		return;
+
+	cache_flush(options->cache);
+	if (options->cache_stats)
+		cache_print_stats(options->cache);
+}
+
+static const char *target_extension(enum target target)
+{
+	switch (target) {
+	case TARGET_SCAN:
+		return "scan";
+	case TARGET_PARSE:
+		return "parse";
+	case TARGET_INTER:
+		return "inter";
+	case TARGET_ASSEMBLY:
+		return "s";
+	default:
+		g_assert(!"Unknown target");
+		return NULL;
+	}
+}
+
+static int compile_batch_file(const char *input_file, char *source,
+			      void *user_data)
+{
+	// the files themselves are compiled in parallel, so each one
+	// optimizes and generates its methods serially
+	struct options options = *(struct options *)user_data;
+	options.input_file = (char *)input_file;
+	options.jobs = 1;
+	return run_cached_target(&options, source);
+}
+
+static int run_batch(struct options *options)
+{
+	struct batch *batch =
+		batch_new(options->output_dir,
+			  target_extension(options->target), options->jobs);
+
+	int result = 0;
+	for (uint32_t i = 0; i < options->input_files->len; i++) {
+		char *input = g_ptr_array_index(options->input_files, i);
+		if (batch_add_input(batch, input) != 0)
+			result = -1;
+	}
+
+	if (result == 0)
+		result = batch_run(batch, compile_batch_file, options);
+
+	batch_free(batch);
+	return result;
+}
+
+static int compile_main(int argc, char **argv)
 {
 	struct options options = { 0 };
-	char *file_contents = NULL;
+	struct source *source = NULL;
 
 	if (parse_options(argc, argv, &options) != 0)
 		goto error_cleanup;
 
-	if (set_output_file(options.output_file) != 0)
-		goto error_cleanup;
+	if (options.cache_dir != NULL) {
+		options.cache = cache_new(options.cache_dir, argv[0],
+					  options.cache_size);
+		options.cache_flags = cache_flags(&options);
+	}
 
-	if (get_input_file_contents(options.input_file, &file_contents) != 0)
-		goto error_cleanup;
+	if (options.output_dir != NULL) {
+		if (options.time_report || options.time_trace != NULL)
+			time_report_enable(options.time_report_methods);
+
+		if (run_batch(&options) != 0)
+			goto error_cleanup;
+	} else {
+		if (set_output_file(options.output_file) != 0)
+			goto error_cleanup;
 
-	if (run_target(&options, file_contents) != 0)
+		if (options.time_report || options.time_trace != NULL)
+			time_report_enable(options.time_report_methods);
+
+		time_report_begin("load", NULL);
+		source = source_load(options.input_file);
+		time_report_end();
+		if (source == NULL)
+			goto error_cleanup;
+
+		if (run_cached_target(&options, source->contents) != 0)
+			goto error_cleanup;
+	}
+
+	if (options.time_report)
+		time_report_print();
+	if (options.time_trace != NULL &&
+	    time_report_write_trace(options.time_trace) != 0)
 		goto error_cleanup;
+	time_report_free();
+	finish_cache(&options);
 
 	return 0;
 
 error_cleanup:
-	g_free(file_contents);
+	finish_cache(&options);
+	if (source != NULL)
+		source_free(source);
 	free_options(&options);
 	return -1;
 }
+
+// --server and --connect decide where the compile runs rather than what it
+// does, so they are taken out before the regular options are parsed
+static char *take_mode_argument(int *argc, char **argv, const char *name)
+{
+	size_t length = strlen(name);
+
+	for (int i = 1; i < *argc; i++) {
+		char *value = NULL;
+		int taken = 0;
+		if (strncmp(argv[i], name, length) == 0 &&
+		    argv[i][length] == '=') {
+			value = g_strdup(argv[i] + length + 1);
+			taken = 1;
+		} else if (strcmp(argv[i], name) == 0 && i + 1 < *argc) {
+			value = g_strdup(argv[i + 1]);
+			taken = 2;
+		}
+
+		if (taken == 0)
+			continue;
+
+		// argv[argc] is NULL and moves along
+		memmove(&argv[i], &argv[i + taken],
+			(*argc - i - taken + 1) * sizeof(char *));
+		*argc -= taken;
+		return value;
+	}
+
+	return NULL;
+}
+
+static int run_server(const char *socket_path, const char *program)
+{
+	// everything every compile would otherwise redo at startup is done
+	// once here and inherited by the forked requests
+	scanner_free(scanner_new());
+	cache_warm_up(program);
+
+	return server_run(socket_path, compile_main);
+}
+
+int main(int argc, char *argv[])
+{
+	char *server_socket = take_mode_argument(&argc, argv, "--server");
+	char *client_socket = take_mode_argument(&argc, argv, "--connect");
+	int result;
+
+	if (server_socket != NULL)
+		result = run_server(server_socket, argv[0]);
+	else if (client_socket == NULL ||
+		 !server_forward(client_socket, argc, argv, &result))
+		result = compile_main(argc, argv);
+
+	g_free(server_socket);
+	g_free(client_socket);
+	return result;
+}
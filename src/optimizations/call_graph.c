@@ -0,0 +1,215 @@
+#include "optimizations/call_graph.h"
+
+struct scc_context {
+	struct call_graph *call_graph;
+	GHashTable *indices;
+	GHashTable *low_links;
+	GHashTable *on_stack;
+	GArray *stack;
+	uint64_t index;
+};
+
+static void add_callee(struct call_graph *call_graph, GArray *callees,
+		       char *callee)
+{
+	uint64_t call_count =
+		(uint64_t)g_hash_table_lookup(call_graph->call_counts, callee);
+	g_hash_table_insert(call_graph->call_counts, callee,
+			    (gpointer)(call_count + 1));
+
+	for (uint32_t i = 0; i < callees->len; i++) {
+		if (g_strcmp0(g_array_index(callees, char *, i), callee) == 0)
+			return;
+	}
+
+	g_array_append_val(callees, callee);
+}
+
+static void add_method_callees(struct call_graph *call_graph,
+			       struct llir_method *method)
+{
+	GArray *callees = g_array_new(false, false, sizeof(char *));
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+
+		for (uint32_t j = 0; j < block->assignments->len; j++) {
+			struct llir_assignment *assignment =
+				g_array_index(block->assignments,
+					      struct llir_assignment *, j);
+			if (assignment->type !=
+				    LLIR_ASSIGNMENT_TYPE_METHOD_CALL ||
+			    call_graph_get_method(call_graph,
+						  assignment->method) == NULL)
+				continue;
+
+			add_callee(call_graph, callees, assignment->method);
+		}
+	}
+
+	g_hash_table_insert(call_graph->callees, method->identifier, callees);
+}
+
+static void pop_strongly_connected_component(struct scc_context *scc,
+					     char *root)
+{
+	struct call_graph *call_graph = scc->call_graph;
+	uint32_t start = scc->stack->len;
+
+	do {
+		start--;
+	} while (g_strcmp0(g_array_index(scc->stack, char *, start), root) !=
+		 0);
+
+	bool recursive = scc->stack->len - start > 1;
+	for (uint32_t i = start; i < scc->stack->len; i++) {
+		char *identifier = g_array_index(scc->stack, char *, i);
+		GArray *callees = call_graph_get_callees(call_graph, identifier);
+
+		for (uint32_t j = 0; j < callees->len; j++) {
+			if (g_strcmp0(g_array_index(callees, char *, j),
+				      identifier) == 0)
+				recursive = true;
+		}
+	}
+
+	for (uint32_t i = start; i < scc->stack->len; i++) {
+		char *identifier = g_array_index(scc->stack, char *, i);
+		struct llir_method *method =
+			call_graph_get_method(call_graph, identifier);
+
+		g_hash_table_remove(scc->on_stack, identifier);
+		if (recursive)
+			g_hash_table_insert(call_graph->recursive, identifier,
+					    (gpointer) true);
+		g_array_append_val(call_graph->bottom_up_order, method);
+	}
+
+	g_array_set_size(scc->stack, start);
+}
+
+static void visit_method(struct scc_context *scc, char *identifier)
+{
+	struct call_graph *call_graph = scc->call_graph;
+
+	uint64_t index = ++scc->index;
+	uint64_t low_link = index;
+	g_hash_table_insert(scc->indices, identifier, (gpointer)index);
+	g_hash_table_insert(scc->on_stack, identifier, (gpointer) true);
+	g_array_append_val(scc->stack, identifier);
+
+	GArray *callees = call_graph_get_callees(call_graph, identifier);
+	for (uint32_t i = 0; i < callees->len; i++) {
+		char *callee = g_array_index(callees, char *, i);
+
+		if (g_hash_table_lookup(scc->indices, callee) == NULL) {
+			visit_method(scc, callee);
+			low_link = MIN(low_link,
+				       (uint64_t)g_hash_table_lookup(
+					       scc->low_links, callee));
+		} else if (g_hash_table_lookup(scc->on_stack, callee)) {
+			low_link = MIN(low_link,
+				       (uint64_t)g_hash_table_lookup(
+					       scc->indices, callee));
+		}
+	}
+
+	g_hash_table_insert(scc->low_links, identifier, (gpointer)low_link);
+	if (low_link == index)
+		pop_strongly_connected_component(scc, identifier);
+}
+
+static void find_strongly_connected_components(struct call_graph *call_graph,
+					       struct llir *llir)
+{
+	struct scc_context scc = {
+		.call_graph = call_graph,
+		.indices = g_hash_table_new(g_str_hash, g_str_equal),
+		.low_links = g_hash_table_new(g_str_hash, g_str_equal),
+		.on_stack = g_hash_table_new(g_str_hash, g_str_equal),
+		.stack = g_array_new(false, false, sizeof(char *)),
+		.index = 0,
+	};
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		if (g_hash_table_lookup(scc.indices, method->identifier) ==
+		    NULL)
+			visit_method(&scc, method->identifier);
+	}
+
+	g_hash_table_unref(scc.indices);
+	g_hash_table_unref(scc.low_links);
+	g_hash_table_unref(scc.on_stack);
+	g_array_free(scc.stack, true);
+}
+
+struct call_graph *call_graph_new(struct llir *llir)
+{
+	struct call_graph *call_graph = g_new(struct call_graph, 1);
+
+	call_graph->methods = g_hash_table_new(g_str_hash, g_str_equal);
+	call_graph->callees = g_hash_table_new(g_str_hash, g_str_equal);
+	call_graph->call_counts = g_hash_table_new(g_str_hash, g_str_equal);
+	call_graph->recursive = g_hash_table_new(g_str_hash, g_str_equal);
+	call_graph->bottom_up_order =
+		g_array_new(false, false, sizeof(struct llir_method *));
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		g_hash_table_insert(call_graph->methods, method->identifier,
+				    method);
+	}
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		add_method_callees(call_graph, method);
+	}
+
+	find_strongly_connected_components(call_graph, llir);
+	return call_graph;
+}
+
+struct llir_method *call_graph_get_method(struct call_graph *call_graph,
+					  char *identifier)
+{
+	return g_hash_table_lookup(call_graph->methods, identifier);
+}
+
+GArray *call_graph_get_callees(struct call_graph *call_graph,
+			       char *identifier)
+{
+	return g_hash_table_lookup(call_graph->callees, identifier);
+}
+
+uint32_t call_graph_get_call_count(struct call_graph *call_graph,
+				   char *identifier)
+{
+	return (uint64_t)g_hash_table_lookup(call_graph->call_counts,
+					     identifier);
+}
+
+bool call_graph_is_recursive(struct call_graph *call_graph, char *identifier)
+{
+	return g_hash_table_lookup(call_graph->recursive, identifier) != NULL;
+}
+
+static void free_callees(gpointer key, gpointer value, gpointer user_data)
+{
+	g_array_free(value, true);
+}
+
+void call_graph_free(struct call_graph *call_graph)
+{
+	g_hash_table_foreach(call_graph->callees, free_callees, NULL);
+	g_hash_table_unref(call_graph->methods);
+	g_hash_table_unref(call_graph->callees);
+	g_hash_table_unref(call_graph->call_counts);
+	g_hash_table_unref(call_graph->recursive);
+	g_array_free(call_graph->bottom_up_order, true);
+	g_free(call_graph);
+}
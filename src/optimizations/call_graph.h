@@ -0,0 +1,25 @@
+#pragma once
+#include "assembly/llir.h"
+
+struct call_graph {
+	GHashTable *methods;
+	GHashTable *callees;
+	GHashTable *call_counts;
+	GHashTable *recursive;
+	GArray *bottom_up_order;
+};
+
+struct call_graph *call_graph_new(struct llir *llir);
+
+struct llir_method *call_graph_get_method(struct call_graph *call_graph,
+					  char *identifier);
+
+GArray *call_graph_get_callees(struct call_graph *call_graph,
+			       char *identifier);
+
+uint32_t call_graph_get_call_count(struct call_graph *call_graph,
+				   char *identifier);
+
+bool call_graph_is_recursive(struct call_graph *call_graph, char *identifier);
+
+void call_graph_free(struct call_graph *call_graph);
@@ -1,6 +1,7 @@
 #include "optimizations/cf.h"
 
-static void find_definition_in_block(struct llir_block *block,
+static void find_definition_in_block(struct llir_block *entry,
+				     struct llir_block *block,
 				     int32_t start_index, char *identifier,
 				     GHashTable *visited, GArray *definitions)
 {
@@ -13,6 +14,11 @@ static void find_definition_in_block(struct llir_block *block,
 		}
 	}
 
+	if (block == entry) {
+		struct llir_assignment *argument = NULL;
+		g_array_append_val(definitions, argument);
+	}
+
 	for (uint32_t i = 0; i < block->predecessors->len; i++) {
 		struct llir_block *predecessor = g_array_index(
 			block->predecessors, struct llir_block *, i);
@@ -20,19 +26,20 @@ static void find_definition_in_block(struct llir_block *block,
 			continue;
 
 		g_hash_table_insert(visited, predecessor, (gpointer) true);
-		find_definition_in_block(predecessor,
+		find_definition_in_block(entry, predecessor,
 					 predecessor->assignments->len - 1,
 					 identifier, visited, definitions);
 	}
 }
 
-static GArray *find_definitions(struct llir_block *block,
+static GArray *find_definitions(struct llir_block *entry,
+				struct llir_block *block,
 				uint32_t assignment_index, char *identifier)
 {
 	GHashTable *visited = g_hash_table_new(g_direct_hash, g_direct_equal);
 	GArray *definitions =
 		g_array_new(false, false, sizeof(struct llir_assignment *));
-	find_definition_in_block(block, assignment_index - 1, identifier,
+	find_definition_in_block(entry, block, assignment_index - 1, identifier,
 				 visited, definitions);
 
 	g_hash_table_unref(visited);
@@ -48,7 +55,8 @@ static bool all_definitions_are_constant(GArray *definitions, int64_t *constant)
 	for (uint32_t i = 0; i < definitions->len; i++) {
 		struct llir_assignment *assignment =
 			g_array_index(definitions, struct llir_assignment *, i);
-		if (assignment->type != LLIR_ASSIGNMENT_TYPE_MOVE ||
+		if (assignment == NULL ||
+		    assignment->type != LLIR_ASSIGNMENT_TYPE_MOVE ||
 		    assignment->source.type != LLIR_OPERAND_TYPE_LITERAL)
 			return false;
 
@@ -70,12 +78,17 @@ static void optimize_operand(struct llir_iterator *iterator,
 	if (llir_operand_is_field_global(*operand))
 		return;
 
-	GArray *definitions = find_definitions(
-		iterator->block, iterator->assignment_index, operand->field);
+	struct llir_block *entry =
+		g_array_index(iterator->method->blocks, struct llir_block *, 0);
+	GArray *definitions =
+		find_definitions(entry, iterator->block,
+				 iterator->assignment_index, operand->field);
 
 	int64_t constant;
-	if (all_definitions_are_constant(definitions, &constant))
+	if (all_definitions_are_constant(definitions, &constant)) {
 		*operand = llir_operand_from_literal(constant);
+		iterator->changed = true;
+	}
 
 	g_array_free(definitions, true);
 }
@@ -101,11 +114,13 @@ static void optimize_unary_operation(struct llir_iterator *iterator)
 	struct llir_assignment *assignment = iterator->assignment;
 	optimize_operand(iterator, &assignment->source);
 
-	if (assignment->source.type == LLIR_OPERAND_TYPE_LITERAL) {
+	if (assignment->source.type == LLIR_OPERAND_TYPE_LITERAL &&
+	    assignment->type != LLIR_ASSIGNMENT_TYPE_MOVE) {
 		int64_t new_literal = unary_operation(
 			assignment->source.literal, assignment->type);
 		assignment->type = LLIR_ASSIGNMENT_TYPE_MOVE;
 		assignment->source = llir_operand_from_literal(new_literal);
+		iterator->changed = true;
 	}
 }
 
@@ -155,9 +170,22 @@ static void optimize_binary_operation(struct llir_iterator *iterator)
 		iterator->assignment->type = LLIR_ASSIGNMENT_TYPE_MOVE;
 		iterator->assignment->source =
 			llir_operand_from_literal(new_literal);
+		iterator->changed = true;
 	}
 }
 
+static void optimize_vector_unary_operation(struct llir_iterator *iterator)
+{
+	optimize_operand(iterator, &iterator->assignment->source);
+}
+
+static void optimize_vector_binary_operation(struct llir_iterator *iterator)
+{
+	struct llir_assignment *assignment = iterator->assignment;
+	optimize_operand(iterator, &assignment->left);
+	optimize_operand(iterator, &assignment->right);
+}
+
 static void optimize_array_update(struct llir_iterator *iterator)
 {
 	struct llir_assignment *assignment = iterator->assignment;
@@ -184,15 +212,23 @@ static void optimize_assignment(struct llir_iterator *iterator)
 		optimize_unary_operation(iterator);
 	else if (llir_assignment_is_binary(iterator->assignment))
 		optimize_binary_operation(iterator);
+	else if (llir_assignment_is_vector_unary(iterator->assignment))
+		optimize_vector_unary_operation(iterator);
+	else if (llir_assignment_is_vector_binary(iterator->assignment))
+		optimize_vector_binary_operation(iterator);
 	else if (iterator->assignment->type ==
-		 LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE)
+			 LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE ||
+		 iterator->assignment->type ==
+			 LLIR_ASSIGNMENT_TYPE_VECTOR_STORE)
 		optimize_array_update(iterator);
 	else if (iterator->assignment->type ==
-		 LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS)
+			 LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS ||
+		 iterator->assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD)
 		optimzie_array_access(iterator);
 	else if (iterator->assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL)
 		optimize_method_call(iterator);
-	else
+	else if (iterator->assignment->type !=
+		 LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE)
 		g_assert(!"You fucked up");
 }
 
@@ -271,8 +307,9 @@ static void optimize_terminal(struct llir_iterator *iterator)
 	}
 }
 
-void optimization_constant_folding(struct llir *llir)
+bool optimization_constant_folding(struct llir *llir,
+				   struct llir_method *method)
 {
-	llir_iterate(llir, NULL, NULL, optimize_assignment, optimize_terminal,
-		     true);
+	return llir_iterate_method(llir, method, NULL, optimize_assignment,
+				   optimize_terminal, true);
 }
@@ -1,4 +1,5 @@
 #pragma once
 #include "assembly/llir.h"
 
-void optimization_constant_folding(struct llir *llir);
+bool optimization_constant_folding(struct llir *llir,
+				   struct llir_method *method);
@@ -0,0 +1,266 @@
+#include "optimizations/cfg.h"
+
+static bool has_phi(struct llir_block *block)
+{
+	return block->assignments->len > 0 &&
+	       g_array_index(block->assignments, struct llir_assignment *, 0)
+			       ->type == LLIR_ASSIGNMENT_TYPE_PHI;
+}
+
+static bool is_branch_taken(struct llir_branch *branch)
+{
+	int64_t left = branch->left.literal;
+	int64_t right = branch->right.literal;
+	bool is_unsigned = branch->unsigned_comparison;
+
+	switch (branch->type) {
+	case LLIR_BRANCH_TYPE_EQUAL:
+		return left == right;
+	case LLIR_BRANCH_TYPE_NOT_EQUAL:
+		return left != right;
+	case LLIR_BRANCH_TYPE_LESS:
+		return is_unsigned ? (uint64_t)left < (uint64_t)right :
+				     left < right;
+	case LLIR_BRANCH_TYPE_LESS_EQUAL:
+		return is_unsigned ? (uint64_t)left <= (uint64_t)right :
+				     left <= right;
+	case LLIR_BRANCH_TYPE_GREATER:
+		return is_unsigned ? (uint64_t)left > (uint64_t)right :
+				     left > right;
+	case LLIR_BRANCH_TYPE_GREATER_EQUAL:
+		return is_unsigned ? (uint64_t)left >= (uint64_t)right :
+				     left >= right;
+	default:
+		g_assert(!"you fucked up");
+		return false;
+	}
+}
+
+static void redirect_successor(struct llir_block *block,
+			       struct llir_block *old_successor,
+			       struct llir_block *new_successor)
+{
+	struct llir_block **successors[2] = { NULL, NULL };
+
+	if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP) {
+		successors[0] = &block->jump->block;
+	} else if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_BRANCH) {
+		successors[0] = &block->branch->true_block;
+		successors[1] = &block->branch->false_block;
+	}
+
+	for (uint32_t i = 0; i < G_N_ELEMENTS(successors); i++) {
+		if (successors[i] == NULL || *successors[i] != old_successor)
+			continue;
+
+		*successors[i] = new_successor;
+		llir_block_remove_predecessor(old_successor, block);
+		g_array_append_val(new_successor->predecessors, block);
+	}
+}
+
+static bool fold_branches(struct llir_method *method)
+{
+	bool changed = false;
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (block->terminal_type != LLIR_BLOCK_TERMINAL_TYPE_BRANCH)
+			continue;
+
+		struct llir_branch *branch = block->branch;
+		struct llir_block *target;
+		if (branch->true_block == branch->false_block)
+			target = branch->true_block;
+		else if (branch->left.type == LLIR_OPERAND_TYPE_LITERAL &&
+			 branch->right.type == LLIR_OPERAND_TYPE_LITERAL)
+			target = is_branch_taken(branch) ? branch->false_block :
+							   branch->true_block;
+		else
+			continue;
+
+		llir_block_remove_predecessor(branch->true_block, block);
+		llir_block_remove_predecessor(branch->false_block, block);
+		llir_branch_free(branch);
+		llir_block_set_terminal(block, LLIR_BLOCK_TERMINAL_TYPE_JUMP,
+					llir_jump_new(target));
+		changed = true;
+	}
+
+	return changed;
+}
+
+static bool thread_jumps(struct llir_method *method)
+{
+	bool changed = false;
+
+	for (uint32_t i = 1; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (block->assignments->len > 0 ||
+		    block->terminal_type != LLIR_BLOCK_TERMINAL_TYPE_JUMP)
+			continue;
+
+		struct llir_block *target = block->jump->block;
+		if (target == block || has_phi(target))
+			continue;
+
+		while (block->predecessors->len > 0) {
+			struct llir_block *predecessor = g_array_index(
+				block->predecessors, struct llir_block *, 0);
+			redirect_successor(predecessor, block, target);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+static void merge_block(struct llir_method *method, struct llir_block *block,
+			uint32_t successor_index)
+{
+	struct llir_block *successor = g_array_index(
+		method->blocks, struct llir_block *, successor_index);
+
+	g_array_append_vals(block->fields, successor->fields->data,
+			    successor->fields->len);
+	g_array_append_vals(block->assignments, successor->assignments->data,
+			    successor->assignments->len);
+	g_array_set_size(successor->fields, 0);
+	g_array_set_size(successor->assignments, 0);
+
+	llir_jump_free(block->jump);
+	block->terminal_type = successor->terminal_type;
+	block->terminal = successor->terminal;
+	successor->terminal_type = LLIR_BLOCK_TERMINAL_TYPE_UNKNOWN;
+	successor->terminal = NULL;
+
+	if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP) {
+		llir_block_replace_predecessor(block->jump->block, successor,
+					       block);
+	} else if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_BRANCH) {
+		llir_block_replace_predecessor(block->branch->true_block,
+					       successor, block);
+		llir_block_replace_predecessor(block->branch->false_block,
+					       successor, block);
+	}
+
+	g_array_remove_index(method->blocks, successor_index);
+	llir_block_free(successor);
+}
+
+static int32_t block_index(struct llir_method *method, struct llir_block *block)
+{
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		if (g_array_index(method->blocks, struct llir_block *, i) ==
+		    block)
+			return i;
+	}
+
+	return -1;
+}
+
+static bool merge_blocks(struct llir_method *method)
+{
+	bool changed = false;
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (block->terminal_type != LLIR_BLOCK_TERMINAL_TYPE_JUMP)
+			continue;
+
+		struct llir_block *successor = block->jump->block;
+		int32_t successor_index = block_index(method, successor);
+		if (successor == block || successor_index <= 0 ||
+		    successor->predecessors->len != 1 || has_phi(successor))
+			continue;
+
+		merge_block(method, block, successor_index);
+		if ((uint32_t)successor_index < i)
+			i--;
+		i--;
+		changed = true;
+	}
+
+	return changed;
+}
+
+static void mark_reachable(struct llir_block *block, GHashTable *reachable)
+{
+	if (g_hash_table_contains(reachable, block))
+		return;
+
+	g_hash_table_add(reachable, block);
+
+	if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP) {
+		mark_reachable(block->jump->block, reachable);
+	} else if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_BRANCH) {
+		mark_reachable(block->branch->true_block, reachable);
+		mark_reachable(block->branch->false_block, reachable);
+	}
+}
+
+static void detach_block(struct llir_block *block)
+{
+	if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP) {
+		llir_block_remove_predecessor(block->jump->block, block);
+	} else if (block->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_BRANCH) {
+		llir_block_remove_predecessor(block->branch->true_block, block);
+		llir_block_remove_predecessor(block->branch->false_block,
+					      block);
+	}
+}
+
+static bool remove_unreachable_blocks(struct llir_method *method)
+{
+	struct llir_block *entry =
+		g_array_index(method->blocks, struct llir_block *, 0);
+	GHashTable *reachable = g_hash_table_new(g_direct_hash, g_direct_equal);
+	mark_reachable(entry, reachable);
+
+	GArray *unreachable =
+		g_array_new(false, false, sizeof(struct llir_block *));
+	for (uint32_t i = method->blocks->len; i-- > 0;) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (g_hash_table_contains(reachable, block))
+			continue;
+
+		detach_block(block);
+		g_array_append_val(unreachable, block);
+		g_array_remove_index(method->blocks, i);
+	}
+
+	for (uint32_t i = 0; i < unreachable->len; i++) {
+		struct llir_block *block =
+			g_array_index(unreachable, struct llir_block *, i);
+
+		g_array_append_vals(entry->fields, block->fields->data,
+				    block->fields->len);
+		g_array_set_size(block->fields, 0);
+		llir_block_free(block);
+	}
+
+	bool changed = unreachable->len > 0;
+	g_array_free(unreachable, true);
+	g_hash_table_unref(reachable);
+	return changed;
+}
+
+bool optimization_simplify_cfg(struct llir *llir, struct llir_method *method)
+{
+	bool simplified = false;
+	bool changed = true;
+
+	while (changed) {
+		changed = fold_branches(method);
+		changed |= thread_jumps(method);
+		changed |= remove_unreachable_blocks(method);
+		changed |= merge_blocks(method);
+		simplified |= changed;
+	}
+
+	return simplified;
+}
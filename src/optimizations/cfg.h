@@ -0,0 +1,4 @@
+#pragma once
+#include "assembly/llir.h"
+
+bool optimization_simplify_cfg(struct llir *llir, struct llir_method *method);
@@ -1,6 +1,7 @@
 #include "optimizations/cp.h"
 
-static void find_definition_in_block(struct llir_block *block,
+static void find_definition_in_block(struct llir_block *entry,
+				     struct llir_block *block,
 				     int32_t start_index, char *identifier,
 				     GHashTable *visited, GArray *definitions,
 				     GHashTable *mutated)
@@ -17,6 +18,11 @@ static void find_definition_in_block(struct llir_block *block,
 				    (gpointer)1);
 	}
 
+	if (block == entry) {
+		struct llir_assignment *argument = NULL;
+		g_array_append_val(definitions, argument);
+	}
+
 	for (uint32_t i = 0; i < block->predecessors->len; i++) {
 		struct llir_block *predecessor = g_array_index(
 			block->predecessors, struct llir_block *, i);
@@ -24,14 +30,15 @@ static void find_definition_in_block(struct llir_block *block,
 			continue;
 
 		g_hash_table_insert(visited, predecessor, (gpointer)1);
-		find_definition_in_block(predecessor,
+		find_definition_in_block(entry, predecessor,
 					 predecessor->assignments->len - 1,
 					 identifier, visited, definitions,
 					 mutated);
 	}
 }
 
-static GArray *find_definitions(struct llir_block *block,
+static GArray *find_definitions(struct llir_block *entry,
+				struct llir_block *block,
 				uint32_t assignment_index, char *identifier,
 				GHashTable **mutated)
 {
@@ -39,7 +46,7 @@ static GArray *find_definitions(struct llir_block *block,
 	GArray *definitions =
 		g_array_new(false, false, sizeof(struct llir_assignment *));
 	*mutated = g_hash_table_new(g_str_hash, g_str_equal);
-	find_definition_in_block(block, assignment_index - 1, identifier,
+	find_definition_in_block(entry, block, assignment_index - 1, identifier,
 				 visited, definitions, *mutated);
 
 	g_hash_table_unref(visited);
@@ -56,7 +63,8 @@ static bool can_propagate_copy(GArray *definitions, GHashTable *mutated,
 	for (uint32_t i = 0; i < definitions->len; i++) {
 		struct llir_assignment *assignment =
 			g_array_index(definitions, struct llir_assignment *, i);
-		if (assignment->type != LLIR_ASSIGNMENT_TYPE_MOVE ||
+		if (assignment == NULL ||
+		    assignment->type != LLIR_ASSIGNMENT_TYPE_MOVE ||
 		    assignment->source.type != LLIR_OPERAND_TYPE_FIELD)
 			return false;
 
@@ -84,14 +92,19 @@ static void optimize_operand(struct llir_iterator *iterator,
 	if (llir_operand_is_field_global(*operand))
 		return;
 
+	struct llir_block *entry =
+		g_array_index(iterator->method->blocks, struct llir_block *, 0);
 	GHashTable *mutations;
-	GArray *definitions = find_definitions(iterator->block,
+	GArray *definitions = find_definitions(entry, iterator->block,
 					       iterator->assignment_index,
 					       operand->field, &mutations);
 
 	char *field;
-	if (can_propagate_copy(definitions, mutations, &field))
+	if (can_propagate_copy(definitions, mutations, &field) &&
+	    g_strcmp0(field, operand->field) != 0) {
 		*operand = llir_operand_from_field(field);
+		iterator->changed = true;
+	}
 
 	g_array_free(definitions, true);
 	g_hash_table_unref(mutations);
@@ -110,6 +123,18 @@ static void optimize_binary_operation(struct llir_iterator *iterator)
 	optimize_operand(iterator, &assignment->right);
 }
 
+static void optimize_vector_unary_operation(struct llir_iterator *iterator)
+{
+	optimize_operand(iterator, &iterator->assignment->source);
+}
+
+static void optimize_vector_binary_operation(struct llir_iterator *iterator)
+{
+	struct llir_assignment *assignment = iterator->assignment;
+	optimize_operand(iterator, &assignment->left);
+	optimize_operand(iterator, &assignment->right);
+}
+
 static void optimize_array_update(struct llir_iterator *iterator)
 {
 	struct llir_assignment *assignment = iterator->assignment;
@@ -136,15 +161,23 @@ static void optimize_assignment(struct llir_iterator *iterator)
 		optimize_unary_operation(iterator);
 	else if (llir_assignment_is_binary(iterator->assignment))
 		optimize_binary_operation(iterator);
+	else if (llir_assignment_is_vector_unary(iterator->assignment))
+		optimize_vector_unary_operation(iterator);
+	else if (llir_assignment_is_vector_binary(iterator->assignment))
+		optimize_vector_binary_operation(iterator);
 	else if (iterator->assignment->type ==
-		 LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE)
+			 LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE ||
+		 iterator->assignment->type ==
+			 LLIR_ASSIGNMENT_TYPE_VECTOR_STORE)
 		optimize_array_update(iterator);
 	else if (iterator->assignment->type ==
-		 LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS)
+			 LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS ||
+		 iterator->assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD)
 		optimzie_array_access(iterator);
 	else if (iterator->assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL)
 		optimize_method_call(iterator);
-	else
+	else if (iterator->assignment->type !=
+		 LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE)
 		g_assert(!"You fucked up");
 }
 
@@ -179,8 +212,9 @@ static void optimize_terminal(struct llir_iterator *iterator)
 	}
 }
 
-void optimization_copy_propagation(struct llir *llir)
+bool optimization_copy_propagation(struct llir *llir,
+				   struct llir_method *method)
 {
-	llir_iterate(llir, NULL, NULL, optimize_assignment, optimize_terminal,
-		     true);
+	return llir_iterate_method(llir, method, NULL, optimize_assignment,
+				   optimize_terminal, true);
 }
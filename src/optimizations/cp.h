@@ -1,4 +1,5 @@
 #pragma once
 #include "assembly/llir.h"
 
-void optimization_copy_propagation(struct llir *llir);
+bool optimization_copy_propagation(struct llir *llir,
+				   struct llir_method *method);
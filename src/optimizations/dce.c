@@ -1,14 +1,15 @@
 #include "optimizations/dce.h"
 
-GHashTable *live_set = NULL;
+// per thread so methods can be optimized in parallel
+static _Thread_local GHashTable *live_set = NULL;
 
-char *current_method = NULL;
+static _Thread_local char *current_method = NULL;
 
-struct llir_assignment **current_assignment = NULL;
+static _Thread_local struct llir_assignment **current_assignment = NULL;
 
-bool past_current_assignment = false;
+static _Thread_local bool past_current_assignment = false;
 
-bool current_assignment_destination_variable_used = false;
+static _Thread_local bool current_assignment_destination_variable_used = false;
 
 static GHashTable *live_set_init(void)
 {
@@ -199,6 +200,8 @@ static void add_live_variables_from_assignments(struct llir_iterator *iterator)
 	case LLIR_ASSIGNMENT_TYPE_MOVE:
 	case LLIR_ASSIGNMENT_TYPE_NEGATE:
 	case LLIR_ASSIGNMENT_TYPE_NOT:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_BROADCAST:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_REDUCE:
 		add_live_variable_from_operand(iterator->assignment->source);
 		break;
 	case LLIR_ASSIGNMENT_TYPE_ADD:
@@ -212,16 +215,20 @@ static void add_live_variables_from_assignments(struct llir_iterator *iterator)
 	case LLIR_ASSIGNMENT_TYPE_LESS_EQUAL:
 	case LLIR_ASSIGNMENT_TYPE_EQUAL:
 	case LLIR_ASSIGNMENT_TYPE_NOT_EQUAL:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_ADD:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT:
 		add_live_variable_from_operand(iterator->assignment->left);
 		add_live_variable_from_operand(iterator->assignment->right);
 		break;
 	case LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_STORE:
 		add_live_variable_from_operand(
 			iterator->assignment->update_index);
 		add_live_variable_from_operand(
 			iterator->assignment->update_value);
 		break;
 	case LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD:
 		add_live_variable_from_operand(
 			iterator->assignment->access_index);
 		break;
@@ -252,6 +259,7 @@ static void prune_dead_variables(struct llir_iterator *iterator)
 		g_array_remove_index(iterator->block->assignments,
 				     iterator->assignment_index);
 		iterator->assignment_index--;
+		iterator->changed = true;
 	}
 }
 
@@ -278,6 +286,8 @@ static bool assignment_uses_variable(struct llir_iterator *iterator,
 	case LLIR_ASSIGNMENT_TYPE_MOVE:
 	case LLIR_ASSIGNMENT_TYPE_NEGATE:
 	case LLIR_ASSIGNMENT_TYPE_NOT:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_BROADCAST:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_REDUCE:
 		return operand_contains_variable(iterator->assignment->source,
 						 variable);
 	case LLIR_ASSIGNMENT_TYPE_ADD:
@@ -291,16 +301,20 @@ static bool assignment_uses_variable(struct llir_iterator *iterator,
 	case LLIR_ASSIGNMENT_TYPE_LESS_EQUAL:
 	case LLIR_ASSIGNMENT_TYPE_EQUAL:
 	case LLIR_ASSIGNMENT_TYPE_NOT_EQUAL:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_ADD:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_SUBTRACT:
 		return operand_contains_variable(iterator->assignment->left,
 						 variable) ||
 		       operand_contains_variable(iterator->assignment->right,
 						 variable);
 	case LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_STORE:
 		return operand_contains_variable(
 			       iterator->assignment->update_index, variable) ||
 		       operand_contains_variable(
 			       iterator->assignment->update_value, variable);
 	case LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD:
 		return operand_contains_variable(
 			iterator->assignment->access_index, variable);
 	case LLIR_ASSIGNMENT_TYPE_METHOD_CALL:
@@ -392,10 +406,10 @@ static void remove_assignment_of_method_args_if_redefined_later(
 	// }
 }
 
-static void
-dead_code_elimination_of_current_method(struct llir_iterator *iterator)
+bool optimization_dead_code_elimination(struct llir *llir,
+				       struct llir_method *method)
 {
-	set_current_method(iterator->method->identifier);
+	set_current_method(method->identifier);
 
 	// llir_iterate(iterator->llir, NULL,
 	// 	     remove_assignment_of_method_args_if_redefined_later,
@@ -403,11 +417,10 @@ dead_code_elimination_of_current_method(struct llir_iterator *iterator)
 
 	live_set = live_set_init();
 
-	add_live_variables_from_globals(iterator->llir);
+	add_live_variables_from_globals(llir);
 
-	llir_iterate(
-		iterator->llir, NULL,
-		add_live_variables_from_fields_of_current_method,
+	llir_iterate_method(
+		llir, method, add_live_variables_from_fields_of_current_method,
 		add_live_variables_from_method_call_arguments_of_current_method,
 		add_live_variables_from_terminals_of_current_method, true);
 
@@ -415,20 +428,16 @@ dead_code_elimination_of_current_method(struct llir_iterator *iterator)
 
 	do {
 		prev_live_count = live_set_count();
-		llir_iterate(
-			iterator->llir, NULL, NULL,
+		llir_iterate_method(
+			llir, method, NULL,
 			add_live_variables_from_assignments_of_current_method,
 			NULL, true);
 	} while (live_set_count() != prev_live_count);
 
-	llir_iterate(iterator->llir, NULL, NULL,
-		     prune_dead_variables_of_curent_method, NULL, true);
+	bool changed = llir_iterate_method(
+		llir, method, NULL, prune_dead_variables_of_curent_method,
+		NULL, true);
 
 	live_set_free();
-}
-
-void optimization_dead_code_elimination(struct llir *llir)
-{
-	llir_iterate(llir, dead_code_elimination_of_current_method, NULL, NULL,
-		     NULL, true);
+	return changed;
 }
@@ -1,4 +1,5 @@
 #pragma once
 #include "assembly/llir.h"
 
-void optimization_dead_code_elimination(struct llir *llir);
+bool optimization_dead_code_elimination(struct llir *llir,
+				       struct llir_method *method);
@@ -0,0 +1,366 @@
+#include "optimizations/inline.h"
+#include "optimizations/call_graph.h"
+#include "assembly/profile.h"
+
+#define INLINE_CALLEE_SIZE_LIMIT 48
+#define INLINE_HOT_CALLEE_SIZE_LIMIT 192
+#define INLINE_SINGLE_CALL_SITE_SIZE_LIMIT 512
+#define INLINE_CALLER_SIZE_LIMIT 8192
+
+struct inline_context {
+	struct llir *llir;
+	struct call_graph *call_graph;
+	uint32_t block_counter;
+	uint32_t instance_counter;
+	GHashTable *renamed_fields;
+	GHashTable *cloned_blocks;
+};
+
+static uint32_t method_size(struct llir_method *method)
+{
+	uint32_t size = 0;
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		size += block->assignments->len + 1;
+	}
+
+	return size;
+}
+
+static bool should_inline(struct inline_context *context,
+			  struct llir_method *caller, uint32_t caller_size,
+			  struct llir_block *block,
+			  struct llir_assignment *assignment)
+{
+	if (assignment->type != LLIR_ASSIGNMENT_TYPE_METHOD_CALL)
+		return false;
+
+	struct llir_method *callee = call_graph_get_method(
+		context->call_graph, assignment->method);
+	if (callee == NULL || callee == caller)
+		return false;
+
+	if (call_graph_is_recursive(context->call_graph, callee->identifier))
+		return false;
+
+	uint32_t callee_size = method_size(callee);
+	uint32_t size_limit = INLINE_CALLEE_SIZE_LIMIT;
+	if (call_graph_get_call_count(context->call_graph,
+				      callee->identifier) == 1)
+		size_limit = INLINE_SINGLE_CALL_SITE_SIZE_LIMIT;
+	else if (caller->profiled && block->frequency == 0)
+		return false;
+	else if (caller->profiled &&
+		 profile_is_hot(context->llir, block->frequency))
+		size_limit = INLINE_HOT_CALLEE_SIZE_LIMIT;
+
+	return callee_size <= size_limit &&
+	       caller_size + callee_size <= INLINE_CALLER_SIZE_LIMIT;
+}
+
+static char *rename_field(struct inline_context *context, char *identifier)
+{
+	char *renamed = g_hash_table_lookup(context->renamed_fields, identifier);
+	return renamed != NULL ? renamed : identifier;
+}
+
+static struct llir_operand rename_operand(struct inline_context *context,
+					  struct llir_operand operand)
+{
+	if (operand.type != LLIR_OPERAND_TYPE_FIELD)
+		return operand;
+
+	return llir_operand_from_field(rename_field(context, operand.field));
+}
+
+static struct llir_field *clone_field(struct inline_context *context,
+				      struct llir_field *field)
+{
+	char *identifier = g_strdup_printf("%s.%u", field->identifier,
+					   context->instance_counter);
+	struct llir_field *clone = llir_field_new(identifier, 0, field->is_array,
+						  field->value_count);
+	memcpy(clone->values, field->values,
+	       field->value_count * sizeof(int64_t));
+
+	g_hash_table_insert(context->renamed_fields, field->identifier,
+			    clone->identifier);
+
+	g_free(identifier);
+	return clone;
+}
+
+static struct llir_assignment *
+clone_assignment(struct inline_context *context,
+		 struct llir_assignment *assignment)
+{
+	struct llir_assignment *clone = llir_assignment_copy(assignment);
+	clone->destination = rename_field(context, assignment->destination);
+
+	if (llir_assignment_is_unary(assignment) ||
+	    llir_assignment_is_vector_unary(assignment)) {
+		clone->source = rename_operand(context, assignment->source);
+	} else if (llir_assignment_is_binary(assignment) ||
+		   llir_assignment_is_vector_binary(assignment)) {
+		clone->left = rename_operand(context, assignment->left);
+		clone->right = rename_operand(context, assignment->right);
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE ||
+		   assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_STORE) {
+		clone->update_index =
+			rename_operand(context, assignment->update_index);
+		clone->update_value =
+			rename_operand(context, assignment->update_value);
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS ||
+		   assignment->type == LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD) {
+		clone->access_index =
+			rename_operand(context, assignment->access_index);
+		clone->access_array =
+			rename_field(context, assignment->access_array);
+	} else if (assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL) {
+		for (uint32_t i = 0; i < assignment->argument_count; i++)
+			clone->arguments[i] = rename_operand(
+				context, assignment->arguments[i]);
+	} else if (assignment->type != LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE) {
+		g_assert(!"you fucked up");
+	}
+
+	return clone;
+}
+
+static struct llir_block *get_cloned_block(struct inline_context *context,
+					   struct llir_block *block)
+{
+	return g_hash_table_lookup(context->cloned_blocks, block);
+}
+
+static void clone_terminal(struct inline_context *context,
+			   struct llir_block *block, struct llir_block *clone,
+			   char *return_destination,
+			   struct llir_block *return_block)
+{
+	struct llir_branch *branch;
+	struct llir_jump *jump;
+	struct llir_assignment *move;
+	struct llir_shit_yourself *exit;
+
+	switch (block->terminal_type) {
+	case LLIR_BLOCK_TERMINAL_TYPE_JUMP:
+		jump = llir_jump_new(
+			get_cloned_block(context, block->jump->block));
+		llir_block_set_terminal(clone, LLIR_BLOCK_TERMINAL_TYPE_JUMP,
+					jump);
+		break;
+	case LLIR_BLOCK_TERMINAL_TYPE_BRANCH:
+		branch = llir_branch_new(
+			block->branch->type, block->branch->unsigned_comparison,
+			rename_operand(context, block->branch->left),
+			rename_operand(context, block->branch->right),
+			get_cloned_block(context, block->branch->true_block),
+			get_cloned_block(context, block->branch->false_block));
+		llir_block_set_terminal(clone, LLIR_BLOCK_TERMINAL_TYPE_BRANCH,
+					branch);
+		break;
+	case LLIR_BLOCK_TERMINAL_TYPE_RETURN:
+		move = llir_assignment_new_unary(
+			LLIR_ASSIGNMENT_TYPE_MOVE,
+			rename_operand(context, block->llir_return->source),
+			return_destination);
+		llir_block_add_assignment(clone, move);
+
+		jump = llir_jump_new(return_block);
+		llir_block_set_terminal(clone, LLIR_BLOCK_TERMINAL_TYPE_JUMP,
+					jump);
+		break;
+	case LLIR_BLOCK_TERMINAL_TYPE_SHIT_YOURSELF:
+		exit = llir_shit_yourself_new(
+			block->shit_yourself->return_value);
+		llir_block_set_terminal(clone,
+					LLIR_BLOCK_TERMINAL_TYPE_SHIT_YOURSELF,
+					exit);
+		break;
+	default:
+		g_assert(!"you fucked up");
+		break;
+	}
+}
+
+static void move_terminal(struct llir_block *from, struct llir_block *to)
+{
+	to->terminal_type = from->terminal_type;
+	to->terminal = from->terminal;
+	from->terminal_type = LLIR_BLOCK_TERMINAL_TYPE_UNKNOWN;
+	from->terminal = NULL;
+
+	if (to->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_JUMP) {
+		llir_block_replace_predecessor(to->jump->block, from, to);
+	} else if (to->terminal_type == LLIR_BLOCK_TERMINAL_TYPE_BRANCH) {
+		llir_block_replace_predecessor(to->branch->true_block, from,
+					       to);
+		llir_block_replace_predecessor(to->branch->false_block, from,
+					       to);
+	}
+}
+
+static struct llir_block *split_block(struct inline_context *context,
+				      struct llir_block *block,
+				      uint32_t assignment_index)
+{
+	struct llir_block *continuation =
+		llir_block_new(context->block_counter++);
+	continuation->frequency = block->frequency;
+
+	for (uint32_t i = assignment_index + 1; i < block->assignments->len;
+	     i++) {
+		struct llir_assignment *assignment = g_array_index(
+			block->assignments, struct llir_assignment *, i);
+		llir_block_add_assignment(continuation, assignment);
+	}
+
+	struct llir_assignment *call = g_array_index(
+		block->assignments, struct llir_assignment *, assignment_index);
+	llir_assignment_free(call);
+	g_array_set_size(block->assignments, assignment_index);
+
+	move_terminal(block, continuation);
+	return continuation;
+}
+
+static uint32_t inline_call(struct inline_context *context,
+			    struct llir_method *caller, uint32_t block_index,
+			    uint32_t assignment_index)
+{
+	struct llir_block *block =
+		g_array_index(caller->blocks, struct llir_block *, block_index);
+	struct llir_assignment *call = g_array_index(
+		block->assignments, struct llir_assignment *, assignment_index);
+	struct llir_method *callee =
+		call_graph_get_method(context->call_graph, call->method);
+
+	context->instance_counter++;
+	g_hash_table_remove_all(context->renamed_fields);
+	g_hash_table_remove_all(context->cloned_blocks);
+
+	for (uint32_t i = 0; i < callee->arguments->len; i++) {
+		struct llir_field *argument = g_array_index(
+			callee->arguments, struct llir_field *, i);
+		struct llir_field *clone = clone_field(context, argument);
+		llir_block_add_field(block, clone);
+
+		struct llir_assignment *move = llir_assignment_new_unary(
+			LLIR_ASSIGNMENT_TYPE_MOVE, call->arguments[i],
+			clone->identifier);
+		g_array_insert_val(block->assignments, assignment_index++,
+				   move);
+	}
+
+	char *return_destination = call->destination;
+	struct llir_block *continuation =
+		split_block(context, block, assignment_index);
+	uint64_t callee_frequency =
+		g_array_index(callee->blocks, struct llir_block *, 0)->frequency;
+
+	GArray *clones = g_array_new(false, false, sizeof(struct llir_block *));
+	for (uint32_t i = 0; i < callee->blocks->len; i++) {
+		struct llir_block *callee_block =
+			g_array_index(callee->blocks, struct llir_block *, i);
+		struct llir_block *clone =
+			llir_block_new(context->block_counter++);
+		clone->profile_id = callee_block->profile_id;
+		clone->frequency =
+			callee_frequency > 0 ?
+				(double)callee_block->frequency *
+					block->frequency / callee_frequency :
+				block->frequency;
+
+		for (uint32_t j = 0; j < callee_block->fields->len; j++) {
+			struct llir_field *field = g_array_index(
+				callee_block->fields, struct llir_field *, j);
+			llir_block_add_field(clone,
+					     clone_field(context, field));
+		}
+
+		g_hash_table_insert(context->cloned_blocks, callee_block,
+				    clone);
+		g_array_append_val(clones, clone);
+	}
+
+	for (uint32_t i = 0; i < callee->blocks->len; i++) {
+		struct llir_block *callee_block =
+			g_array_index(callee->blocks, struct llir_block *, i);
+		struct llir_block *clone =
+			g_array_index(clones, struct llir_block *, i);
+
+		for (uint32_t j = 0; j < callee_block->assignments->len; j++) {
+			struct llir_assignment *assignment =
+				g_array_index(callee_block->assignments,
+					      struct llir_assignment *, j);
+			llir_block_add_assignment(
+				clone, clone_assignment(context, assignment));
+		}
+
+		clone_terminal(context, callee_block, clone,
+			       return_destination, continuation);
+	}
+
+	struct llir_jump *jump =
+		llir_jump_new(g_array_index(clones, struct llir_block *, 0));
+	llir_block_set_terminal(block, LLIR_BLOCK_TERMINAL_TYPE_JUMP, jump);
+
+	uint32_t continuation_index = block_index + 1 + clones->len;
+	g_array_insert_vals(caller->blocks, block_index + 1, clones->data,
+			    clones->len);
+	g_array_insert_val(caller->blocks, continuation_index, continuation);
+
+	g_array_free(clones, true);
+	return continuation_index;
+}
+
+static void inline_method_calls(struct inline_context *context,
+				struct llir_method *method)
+{
+	uint32_t size = method_size(method);
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+
+		for (uint32_t j = 0; j < block->assignments->len; j++) {
+			struct llir_assignment *assignment = g_array_index(
+				block->assignments, struct llir_assignment *,
+				j);
+			if (!should_inline(context, method, size, block,
+					   assignment))
+				continue;
+
+			size += method_size(call_graph_get_method(
+				context->call_graph, assignment->method));
+			i = inline_call(context, method, i, j) - 1;
+			break;
+		}
+	}
+}
+
+void optimization_inlining(struct llir *llir)
+{
+	struct inline_context context = {
+		.llir = llir,
+		.call_graph = call_graph_new(llir),
+		.block_counter = llir_next_block_id(llir),
+		.instance_counter = 0,
+		.renamed_fields = g_hash_table_new(g_str_hash, g_str_equal),
+		.cloned_blocks = g_hash_table_new(g_direct_hash, g_direct_equal),
+	};
+
+	GArray *order = context.call_graph->bottom_up_order;
+	for (uint32_t i = 0; i < order->len; i++) {
+		struct llir_method *method =
+			g_array_index(order, struct llir_method *, i);
+		inline_method_calls(&context, method);
+	}
+
+	g_hash_table_unref(context.renamed_fields);
+	g_hash_table_unref(context.cloned_blocks);
+	call_graph_free(context.call_graph);
+}
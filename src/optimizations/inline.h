@@ -0,0 +1,4 @@
+#pragma once
+#include "assembly/llir.h"
+
+void optimization_inlining(struct llir *llir);
@@ -0,0 +1,350 @@
+#include "optimizations/ipo.h"
+#include "optimizations/call_graph.h"
+
+struct call_site {
+	struct llir_block *block;
+	struct llir_assignment *call;
+};
+
+struct ipo_context {
+	GHashTable *call_sites;
+	uint32_t block_counter;
+};
+
+static void mark_reachable(struct call_graph *call_graph, char *identifier,
+			   GHashTable *reachable)
+{
+	struct llir_method *method =
+		call_graph_get_method(call_graph, identifier);
+	if (method == NULL || g_hash_table_contains(reachable, identifier))
+		return;
+
+	g_hash_table_add(reachable, method->identifier);
+
+	GArray *callees = call_graph_get_callees(call_graph, identifier);
+	for (uint32_t i = 0; i < callees->len; i++)
+		mark_reachable(call_graph, g_array_index(callees, char *, i),
+			       reachable);
+}
+
+static void remove_dead_methods(struct llir *llir)
+{
+	struct call_graph *call_graph = call_graph_new(llir);
+	GHashTable *reachable = g_hash_table_new(g_str_hash, g_str_equal);
+	mark_reachable(call_graph, "main", reachable);
+	call_graph_free(call_graph);
+
+	for (uint32_t i = llir->methods->len; i-- > 0;) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		if (g_hash_table_contains(reachable, method->identifier))
+			continue;
+
+		g_array_remove_index(llir->methods, i);
+		llir_method_free(method);
+	}
+
+	g_hash_table_unref(reachable);
+}
+
+static void add_call_site(GHashTable *call_sites, struct llir_block *block,
+			  struct llir_assignment *call)
+{
+	GArray *sites = g_hash_table_lookup(call_sites, call->method);
+	if (sites == NULL) {
+		sites = g_array_new(false, false, sizeof(struct call_site));
+		g_hash_table_insert(call_sites, call->method, sites);
+	}
+
+	struct call_site site = { .block = block, .call = call };
+	g_array_append_val(sites, site);
+}
+
+static GHashTable *find_call_sites(struct llir *llir)
+{
+	GHashTable *call_sites =
+		g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+				      (GDestroyNotify)g_array_unref);
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+
+		for (uint32_t j = 0; j < method->blocks->len; j++) {
+			struct llir_block *block = g_array_index(
+				method->blocks, struct llir_block *, j);
+
+			for (uint32_t k = 0; k < block->assignments->len; k++) {
+				struct llir_assignment *assignment =
+					g_array_index(block->assignments,
+						      struct llir_assignment *,
+						      k);
+				if (assignment->type ==
+				    LLIR_ASSIGNMENT_TYPE_METHOD_CALL)
+					add_call_site(call_sites, block,
+						      assignment);
+			}
+		}
+	}
+
+	return call_sites;
+}
+
+static bool operand_reads(struct llir_operand operand, char *identifier)
+{
+	return operand.type == LLIR_OPERAND_TYPE_FIELD &&
+	       g_strcmp0(operand.field, identifier) == 0;
+}
+
+static bool assignment_reads(struct llir_assignment *assignment,
+			     char *identifier)
+{
+	if (llir_assignment_is_unary(assignment) ||
+	    llir_assignment_is_vector_unary(assignment))
+		return operand_reads(assignment->source, identifier);
+	if (llir_assignment_is_binary(assignment) ||
+	    llir_assignment_is_vector_binary(assignment))
+		return operand_reads(assignment->left, identifier) ||
+		       operand_reads(assignment->right, identifier);
+
+	switch (assignment->type) {
+	case LLIR_ASSIGNMENT_TYPE_ARRAY_UPDATE:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_STORE:
+		return operand_reads(assignment->update_index, identifier) ||
+		       operand_reads(assignment->update_value, identifier);
+	case LLIR_ASSIGNMENT_TYPE_ARRAY_ACCESS:
+	case LLIR_ASSIGNMENT_TYPE_VECTOR_LOAD:
+		return operand_reads(assignment->access_index, identifier) ||
+		       g_strcmp0(assignment->access_array, identifier) == 0;
+	case LLIR_ASSIGNMENT_TYPE_METHOD_CALL:
+		for (uint32_t i = 0; i < assignment->argument_count; i++) {
+			if (operand_reads(assignment->arguments[i], identifier))
+				return true;
+		}
+		return false;
+	case LLIR_ASSIGNMENT_TYPE_PHI:
+		for (uint32_t i = 0; i < assignment->phi_arguments->len; i++) {
+			if (operand_reads(g_array_index(assignment->phi_arguments,
+							struct llir_operand, i),
+					  identifier))
+				return true;
+		}
+		return false;
+	case LLIR_ASSIGNMENT_TYPE_ARRAY_INITIALIZE:
+		return false;
+	default:
+		g_assert(!"you fucked up");
+		return false;
+	}
+}
+
+static bool terminal_reads(struct llir_block *block, char *identifier)
+{
+	switch (block->terminal_type) {
+	case LLIR_BLOCK_TERMINAL_TYPE_BRANCH:
+		return operand_reads(block->branch->left, identifier) ||
+		       operand_reads(block->branch->right, identifier);
+	case LLIR_BLOCK_TERMINAL_TYPE_RETURN:
+		return operand_reads(block->llir_return->source, identifier);
+	default:
+		return false;
+	}
+}
+
+static bool method_reads(struct llir_method *method, char *identifier)
+{
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+
+		for (uint32_t j = 0; j < block->assignments->len; j++) {
+			struct llir_assignment *assignment = g_array_index(
+				block->assignments, struct llir_assignment *,
+				j);
+			if (assignment_reads(assignment, identifier))
+				return true;
+		}
+
+		if (terminal_reads(block, identifier))
+			return true;
+	}
+
+	return false;
+}
+
+static struct llir_operand resolve_operand(struct llir_block *block,
+					   uint32_t index,
+					   struct llir_operand operand)
+{
+	if (operand.type != LLIR_OPERAND_TYPE_FIELD ||
+	    llir_operand_is_field_global(operand))
+		return operand;
+
+	for (uint32_t i = index; i-- > 0;) {
+		struct llir_assignment *assignment = g_array_index(
+			block->assignments, struct llir_assignment *, i);
+		if (g_strcmp0(assignment->destination, operand.field) != 0)
+			continue;
+
+		if (assignment->type == LLIR_ASSIGNMENT_TYPE_MOVE &&
+		    assignment->source.type == LLIR_OPERAND_TYPE_LITERAL)
+			return assignment->source;
+		break;
+	}
+
+	return operand;
+}
+
+static uint32_t assignment_index(struct llir_block *block,
+				 struct llir_assignment *assignment)
+{
+	for (uint32_t i = 0; i < block->assignments->len; i++) {
+		if (g_array_index(block->assignments, struct llir_assignment *,
+				  i) == assignment)
+			return i;
+	}
+
+	g_assert(!"you fucked up");
+	return 0;
+}
+
+static bool constant_argument(GArray *sites, uint32_t index, int64_t *constant)
+{
+	for (uint32_t i = 0; i < sites->len; i++) {
+		struct call_site site = g_array_index(sites, struct call_site, i);
+		struct llir_operand argument = resolve_operand(
+			site.block, assignment_index(site.block, site.call),
+			site.call->arguments[index]);
+		if (argument.type != LLIR_OPERAND_TYPE_LITERAL)
+			return false;
+		if (i > 0 && argument.literal != *constant)
+			return false;
+
+		*constant = argument.literal;
+	}
+
+	return sites->len > 0;
+}
+
+static bool constant_return(struct llir_method *method, int64_t *constant)
+{
+	bool found = false;
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (block->terminal_type != LLIR_BLOCK_TERMINAL_TYPE_RETURN)
+			continue;
+
+		struct llir_operand source =
+			resolve_operand(block, block->assignments->len,
+					block->llir_return->source);
+		if (source.type != LLIR_OPERAND_TYPE_LITERAL)
+			return false;
+		if (found && source.literal != *constant)
+			return false;
+
+		found = true;
+		*constant = source.literal;
+	}
+
+	return found;
+}
+
+static struct llir_block *entry_block(struct ipo_context *context,
+				      struct llir_method *method)
+{
+	struct llir_block *entry =
+		g_array_index(method->blocks, struct llir_block *, 0);
+	if (entry->predecessors->len == 0)
+		return entry;
+
+	struct llir_block *block = llir_block_new(context->block_counter++);
+	llir_block_set_terminal(block, LLIR_BLOCK_TERMINAL_TYPE_JUMP,
+				llir_jump_new(entry));
+	g_array_prepend_val(method->blocks, block);
+	return block;
+}
+
+static void remove_call_argument(GArray *sites, uint32_t index)
+{
+	for (uint32_t i = 0; i < sites->len; i++) {
+		struct llir_assignment *call =
+			g_array_index(sites, struct call_site, i).call;
+
+		memmove(&call->arguments[index], &call->arguments[index + 1],
+			(call->argument_count - index - 1) *
+				sizeof(struct llir_operand));
+		call->argument_count--;
+	}
+}
+
+static void propagate_return(GArray *sites, int64_t constant)
+{
+	for (uint32_t i = 0; i < sites->len; i++) {
+		struct call_site site = g_array_index(sites, struct call_site, i);
+		struct llir_assignment *move = llir_assignment_new_unary(
+			LLIR_ASSIGNMENT_TYPE_MOVE,
+			llir_operand_from_literal(constant),
+			site.call->destination);
+		g_array_insert_val(site.block->assignments,
+				   assignment_index(site.block, site.call) + 1,
+				   move);
+	}
+}
+
+static void optimize_method(struct ipo_context *context,
+			    struct llir_method *method)
+{
+	if (g_strcmp0(method->identifier, "main") == 0)
+		return;
+
+	GArray *sites = g_hash_table_lookup(context->call_sites,
+					    method->identifier);
+	if (sites == NULL)
+		return;
+
+	int64_t constant = 0;
+	if (constant_return(method, &constant))
+		propagate_return(sites, constant);
+
+	for (uint32_t i = method->arguments->len; i-- > 0;) {
+		struct llir_field *argument = g_array_index(
+			method->arguments, struct llir_field *, i);
+
+		bool is_constant = constant_argument(sites, i, &constant);
+		if (!is_constant && method_reads(method, argument->identifier))
+			continue;
+
+		struct llir_block *entry = entry_block(context, method);
+		if (is_constant)
+			llir_block_prepend_assignment(
+				entry, llir_assignment_new_unary(
+					       LLIR_ASSIGNMENT_TYPE_MOVE,
+					       llir_operand_from_literal(
+						       constant),
+					       argument->identifier));
+
+		g_array_remove_index(method->arguments, i);
+		llir_block_add_field(entry, argument);
+		remove_call_argument(sites, i);
+	}
+}
+
+void optimization_interprocedural(struct llir *llir)
+{
+	remove_dead_methods(llir);
+
+	struct ipo_context context = {
+		.call_sites = find_call_sites(llir),
+		.block_counter = llir_next_block_id(llir),
+	};
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		optimize_method(&context, method);
+	}
+
+	g_hash_table_unref(context.call_sites);
+}
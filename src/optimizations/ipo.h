@@ -0,0 +1,4 @@
+#pragma once
+#include "assembly/llir.h"
+
+void optimization_interprocedural(struct llir *llir);
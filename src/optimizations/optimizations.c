@@ -1,14 +1,249 @@
 #include "optimizations/optimizations.h"
 #include "optimizations/cf.h"
+#include "optimizations/cfg.h"
 #include "optimizations/cp.h"
 #include "optimizations/dce.h"
+#include "optimizations/inline.h"
+#include "optimizations/ipo.h"
+#include "optimizations/tce.h"
+#include "time_report.h"
 
-void optimization_apply(struct llir *llir, enum optimzation optimizations)
+#define FIXED_POINT_ITERATION_LIMIT 8
+
+struct function_pass_span {
+	struct optimization_pipeline *pipeline;
+	struct llir *llir;
+	uint32_t start;
+	uint32_t end;
+};
+
+static const struct optimization_pass PASSES[] = {
+	{ "cf", OPTIMIZATION_CF, NULL, optimization_constant_folding },
+	{ "cp", OPTIMIZATION_CP, NULL, optimization_copy_propagation },
+	{ "dce", OPTIMIZATION_DCE, NULL, optimization_dead_code_elimination },
+	{ "cfg", OPTIMIZATION_CFG, NULL, optimization_simplify_cfg },
+	{ "tce", OPTIMIZATION_TCE, optimization_tail_call_elimination, NULL },
+	{ "inline", OPTIMIZATION_INLINE, optimization_inlining, NULL },
+	{ "ipo", OPTIMIZATION_IPO, optimization_interprocedural, NULL },
+};
+
+static const struct optimization_pass *find_pass(const char *name)
+{
+	for (uint32_t i = 0; i < G_N_ELEMENTS(PASSES); i++) {
+		if (g_strcmp0(PASSES[i].name, name) == 0)
+			return &PASSES[i];
+	}
+
+	return NULL;
+}
+
+static bool add_pass(struct optimization_pipeline *pipeline,
+		     enum optimzation optimizations, const char *name)
+{
+	const struct optimization_pass *pass = find_pass(name);
+	g_assert(pass != NULL);
+
+	if (!(optimizations & pass->optimization))
+		return false;
+
+	g_array_append_val(pipeline->passes, pass);
+	return true;
+}
+
+static void add_module_pass(struct optimization_pipeline *pipeline,
+			    enum optimzation optimizations, const char *name)
+{
+	if (add_pass(pipeline, optimizations, name))
+		add_pass(pipeline, optimizations, "cfg");
+}
+
+static struct optimization_pipeline *optimization_pipeline_empty(void)
+{
+	struct optimization_pipeline *pipeline =
+		g_new(struct optimization_pipeline, 1);
+	pipeline->passes = g_array_new(false, false,
+				       sizeof(const struct optimization_pass *));
+	return pipeline;
+}
+
+struct optimization_pipeline *
+optimization_pipeline_new(enum optimzation optimizations)
+{
+	struct optimization_pipeline *pipeline = optimization_pipeline_empty();
+
+	add_pass(pipeline, optimizations, "cfg");
+	add_module_pass(pipeline, optimizations, "tce");
+	add_module_pass(pipeline, optimizations, "inline");
+	add_module_pass(pipeline, optimizations, "ipo");
+	add_pass(pipeline, optimizations, "cf");
+	add_pass(pipeline, optimizations, "cp");
+	add_pass(pipeline, optimizations, "dce");
+	add_pass(pipeline, optimizations, "cfg");
+
+	return pipeline;
+}
+
+struct optimization_pipeline *optimization_pipeline_parse(char *passes)
+{
+	struct optimization_pipeline *pipeline = optimization_pipeline_empty();
+
+	char **pass_list = g_strsplit(passes, ",", -1);
+	for (uint32_t i = 0; pass_list[i] != NULL; i++) {
+		if (pass_list[i][0] == '\0')
+			continue;
+
+		const struct optimization_pass *pass = find_pass(pass_list[i]);
+		if (pass == NULL) {
+			g_printerr("Unknown pass '%s' passed in.\n",
+				   pass_list[i]);
+			g_strfreev(pass_list);
+			optimization_pipeline_free(pipeline);
+			return NULL;
+		}
+
+		g_array_append_val(pipeline->passes, pass);
+	}
+
+	g_strfreev(pass_list);
+	return pipeline;
+}
+
+static const struct optimization_pass *
+pipeline_pass(struct optimization_pipeline *pipeline, uint32_t index)
+{
+	return g_array_index(pipeline->passes, const struct optimization_pass *,
+			     index);
+}
+
+static void run_function_passes(struct optimization_pipeline *pipeline,
+				struct llir *llir, struct llir_method *method,
+				uint32_t start, uint32_t end)
+{
+	for (uint32_t i = 0; i < FIXED_POINT_ITERATION_LIMIT; i++) {
+		bool changed = false;
+
+		for (uint32_t j = start; j < end; j++) {
+			const struct optimization_pass *pass =
+				pipeline_pass(pipeline, j);
+			time_report_begin(pass->name, method->identifier);
+			changed |= pass->function_pass(llir, method);
+			time_report_end();
+		}
+
+		if (!changed)
+			break;
+	}
+}
+
+static void run_function_pass_job(gpointer data, gpointer user_data)
+{
+	struct function_pass_span *span = user_data;
+	run_function_passes(span->pipeline, span->llir, data, span->start,
+			    span->end);
+}
+
+static void run_function_pass_span(struct function_pass_span *span,
+				   uint32_t jobs)
+{
+	GArray *methods = span->llir->methods;
+
+	if (jobs <= 1 || methods->len <= 1) {
+		for (uint32_t i = 0; i < methods->len; i++)
+			run_function_passes(span->pipeline, span->llir,
+					    g_array_index(methods,
+							  struct llir_method *,
+							  i),
+					    span->start, span->end);
+		return;
+	}
+
+	// function passes only touch the method they are given, so every
+	// method can run its fixed point on its own thread
+	GThreadPool *pool = g_thread_pool_new(run_function_pass_job, span,
+					      MIN(jobs, methods->len), false,
+					      NULL);
+	for (uint32_t i = 0; i < methods->len; i++)
+		g_thread_pool_push(
+			pool, g_array_index(methods, struct llir_method *, i),
+			NULL);
+	g_thread_pool_free(pool, false, true);
+}
+
+void optimization_pipeline_run(struct optimization_pipeline *pipeline,
+			       struct llir *llir, uint32_t jobs)
+{
+	uint32_t i = 0;
+
+	while (i < pipeline->passes->len) {
+		const struct optimization_pass *pass =
+			pipeline_pass(pipeline, i);
+		if (pass->module_pass != NULL) {
+			time_report_begin(pass->name, NULL);
+			pass->module_pass(llir);
+			time_report_end();
+			i++;
+			continue;
+		}
+
+		uint32_t end = i;
+		while (end < pipeline->passes->len &&
+		       pipeline_pass(pipeline, end)->function_pass != NULL)
+			end++;
+
+		struct function_pass_span span = {
+			.pipeline = pipeline,
+			.llir = llir,
+			.start = i,
+			.end = end,
+		};
+		run_function_pass_span(&span, jobs);
+		i = end;
+	}
+}
+
+struct optimization_pipeline *
+optimization_pipeline_split(struct optimization_pipeline *pipeline)
+{
+	uint32_t start = pipeline->passes->len;
+	while (start > 0 &&
+	       pipeline_pass(pipeline, start - 1)->module_pass == NULL)
+		start--;
+
+	// the function passes after the last module pass form one span that
+	// only ever looks at a single method
+	struct optimization_pipeline *tail = optimization_pipeline_empty();
+	g_array_append_vals(tail->passes,
+			    &g_array_index(pipeline->passes,
+					   const struct optimization_pass *,
+					   start),
+			    pipeline->passes->len - start);
+	g_array_set_size(pipeline->passes, start);
+	return tail;
+}
+
+void optimization_pipeline_drop_module_passes(
+	struct optimization_pipeline *pipeline)
+{
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < pipeline->passes->len; i++) {
+		const struct optimization_pass *pass =
+			pipeline_pass(pipeline, i);
+		if (pass->module_pass != NULL)
+			continue;
+
+		// the cfg cleanups after each module pass collapse into one
+		if (kept > 0 && pipeline_pass(pipeline, kept - 1) == pass)
+			continue;
+
+		g_array_index(pipeline->passes,
+			      const struct optimization_pass *, kept++) = pass;
+	}
+
+	g_array_set_size(pipeline->passes, kept);
+}
+
+void optimization_pipeline_free(struct optimization_pipeline *pipeline)
 {
-	if (optimizations & OPTIMIZATION_CF)
-		optimization_constant_folding(llir);
-	if (optimizations & OPTIMIZATION_CP)
-		optimization_copy_propagation(llir);
-	if (optimizations & OPTIMIZATION_DCE)
-		optimization_dead_code_elimination(llir);
+	g_array_free(pipeline->passes, true);
+	g_free(pipeline);
 }
@@ -6,7 +6,40 @@ enum optimzation {
 	OPTIMIZATION_CP = 1 << 1,
 	OPTIMIZATION_DCE = 1 << 2,
 	OPTIMIZATION_PH = 1 << 3,
+	OPTIMIZATION_INLINE = 1 << 4,
+	OPTIMIZATION_TCE = 1 << 5,
+	OPTIMIZATION_IPO = 1 << 6,
+	OPTIMIZATION_CFG = 1 << 7,
+	OPTIMIZATION_UNROLL = 1 << 8,
+	OPTIMIZATION_VECTORIZE = 1 << 9,
+	OPTIMIZATION_SLOTS = 1 << 10,
+	OPTIMIZATION_LEVEL_1 = OPTIMIZATION_CF | OPTIMIZATION_CP |
+			       OPTIMIZATION_DCE | OPTIMIZATION_PH |
+			       OPTIMIZATION_CFG | OPTIMIZATION_SLOTS,
 	OPTIMIZATION_ALL = ~0,
 };
 
-void optimization_apply(struct llir *llir, enum optimzation optimizations);
+typedef void (*module_pass_t)(struct llir *llir);
+typedef bool (*function_pass_t)(struct llir *llir, struct llir_method *method);
+
+struct optimization_pass {
+	const char *name;
+	enum optimzation optimization;
+	module_pass_t module_pass;
+	function_pass_t function_pass;
+};
+
+struct optimization_pipeline {
+	GArray *passes;
+};
+
+struct optimization_pipeline *
+optimization_pipeline_new(enum optimzation optimizations);
+struct optimization_pipeline *optimization_pipeline_parse(char *passes);
+void optimization_pipeline_run(struct optimization_pipeline *pipeline,
+			       struct llir *llir, uint32_t jobs);
+struct optimization_pipeline *
+optimization_pipeline_split(struct optimization_pipeline *pipeline);
+void optimization_pipeline_drop_module_passes(
+	struct optimization_pipeline *pipeline);
+void optimization_pipeline_free(struct optimization_pipeline *pipeline);
@@ -0,0 +1,382 @@
+#include "optimizations/tce.h"
+
+struct tce_context {
+	uint32_t block_counter;
+	uint32_t field_counter;
+};
+
+struct tail_site {
+	struct llir_block *block;
+	uint32_t call_index;
+	bool accumulates;
+};
+
+static bool is_self_call(struct llir_method *method,
+			 struct llir_assignment *assignment)
+{
+	return assignment->type == LLIR_ASSIGNMENT_TYPE_METHOD_CALL &&
+	       g_strcmp0(assignment->method, method->identifier) == 0;
+}
+
+static bool is_field(struct llir_operand operand, char *identifier)
+{
+	return operand.type == LLIR_OPERAND_TYPE_FIELD &&
+	       g_strcmp0(operand.field, identifier) == 0;
+}
+
+static bool is_global(char *identifier)
+{
+	return llir_operand_is_field_global(llir_operand_from_field(identifier));
+}
+
+static bool is_derived(struct llir_operand operand, GHashTable *derived)
+{
+	return operand.type == LLIR_OPERAND_TYPE_FIELD &&
+	       g_hash_table_contains(derived, operand.field);
+}
+
+static struct llir_assignment *last_assignment(struct llir_block *block)
+{
+	if (block->assignments->len == 0)
+		return NULL;
+
+	return g_array_index(block->assignments, struct llir_assignment *,
+			     block->assignments->len - 1);
+}
+
+static bool returns_constant(struct llir_method *method)
+{
+	bool found = false;
+	int64_t constant = 0;
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (block->terminal_type != LLIR_BLOCK_TERMINAL_TYPE_RETURN)
+			continue;
+
+		struct llir_operand source = block->llir_return->source;
+		if (source.type != LLIR_OPERAND_TYPE_LITERAL)
+			return false;
+		if (found && source.literal != constant)
+			return false;
+
+		found = true;
+		constant = source.literal;
+	}
+
+	return found;
+}
+
+static bool is_tail_call(struct llir_method *method, struct llir_block *block,
+			 bool constant_returns)
+{
+	if (block->terminal_type != LLIR_BLOCK_TERMINAL_TYPE_RETURN)
+		return false;
+
+	struct llir_assignment *call = last_assignment(block);
+	if (call == NULL || !is_self_call(method, call))
+		return false;
+
+	struct llir_operand source = block->llir_return->source;
+	return is_field(source, call->destination) ||
+	       (constant_returns && source.type == LLIR_OPERAND_TYPE_LITERAL);
+}
+
+static bool is_pure_operand(struct llir_operand operand, GHashTable *derived)
+{
+	if (operand.type == LLIR_OPERAND_TYPE_STRING)
+		return false;
+	if (operand.type == LLIR_OPERAND_TYPE_LITERAL)
+		return true;
+
+	return !llir_operand_is_field_global(operand) &&
+	       !is_derived(operand, derived);
+}
+
+static bool is_derived_move(struct llir_assignment *assignment,
+			    GHashTable *derived)
+{
+	return assignment->type == LLIR_ASSIGNMENT_TYPE_MOVE &&
+	       is_derived(assignment->source, derived) &&
+	       !is_global(assignment->destination);
+}
+
+static bool is_pure_assignment(struct llir_assignment *assignment,
+			       GHashTable *derived)
+{
+	if (is_global(assignment->destination) ||
+	    g_hash_table_contains(derived, assignment->destination))
+		return false;
+
+	if (llir_assignment_is_unary(assignment))
+		return is_pure_operand(assignment->source, derived);
+
+	if (!llir_assignment_is_binary(assignment) ||
+	    assignment->type == LLIR_ASSIGNMENT_TYPE_DIVIDE ||
+	    assignment->type == LLIR_ASSIGNMENT_TYPE_MODULO)
+		return false;
+
+	return is_pure_operand(assignment->left, derived) &&
+	       is_pure_operand(assignment->right, derived);
+}
+
+static int32_t find_accumulating_call(struct llir_method *method,
+				      struct llir_block *block)
+{
+	if (block->terminal_type != LLIR_BLOCK_TERMINAL_TYPE_RETURN)
+		return -1;
+
+	struct llir_assignment *accumulate = last_assignment(block);
+	if (accumulate == NULL ||
+	    (accumulate->type != LLIR_ASSIGNMENT_TYPE_ADD &&
+	     accumulate->type != LLIR_ASSIGNMENT_TYPE_MULTIPLY) ||
+	    !is_field(block->llir_return->source, accumulate->destination))
+		return -1;
+
+	int32_t call_index = -1;
+	for (int32_t i = block->assignments->len - 2; i >= 0; i--) {
+		struct llir_assignment *assignment = g_array_index(
+			block->assignments, struct llir_assignment *, i);
+		if (is_self_call(method, assignment)) {
+			call_index = i;
+			break;
+		}
+	}
+	if (call_index < 0)
+		return -1;
+
+	struct llir_assignment *call = g_array_index(
+		block->assignments, struct llir_assignment *, call_index);
+	GHashTable *derived = g_hash_table_new(g_str_hash, g_str_equal);
+	g_hash_table_add(derived, call->destination);
+
+	bool valid = true;
+	for (uint32_t i = call_index + 1;
+	     valid && i < block->assignments->len - 1; i++) {
+		struct llir_assignment *assignment = g_array_index(
+			block->assignments, struct llir_assignment *, i);
+		if (is_derived_move(assignment, derived))
+			g_hash_table_add(derived, assignment->destination);
+		else
+			valid = is_pure_assignment(assignment, derived);
+	}
+
+	if (valid) {
+		bool left = is_derived(accumulate->left, derived);
+		bool right = is_derived(accumulate->right, derived);
+		valid = left != right &&
+			is_pure_operand(left ? accumulate->right :
+					       accumulate->left,
+					derived);
+	}
+
+	g_hash_table_unref(derived);
+	return valid ? call_index : -1;
+}
+
+static bool find_accumulation(struct llir_method *method,
+			      enum llir_assignment_type *type)
+{
+	bool found = false;
+
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		if (find_accumulating_call(method, block) < 0)
+			continue;
+
+		enum llir_assignment_type accumulation =
+			last_assignment(block)->type;
+		if (found && accumulation != *type)
+			return false;
+
+		found = true;
+		*type = accumulation;
+	}
+
+	return found;
+}
+
+static char *new_field(struct tce_context *context, struct llir_block *block)
+{
+	char *identifier = g_strdup_printf("$tce%u", context->field_counter++);
+	struct llir_field *field = llir_field_new(identifier, 0, false, 1);
+	llir_block_add_field(block, field);
+
+	g_free(identifier);
+	return field->identifier;
+}
+
+static void eliminate_tail_call(struct tce_context *context,
+				struct llir_method *method,
+				struct tail_site *site,
+				struct llir_block *header, char *accumulator)
+{
+	struct llir_block *block = site->block;
+	struct llir_assignment *call = g_array_index(
+		block->assignments, struct llir_assignment *, site->call_index);
+
+	GArray *assignments =
+		g_array_new(false, false, sizeof(struct llir_assignment *));
+	g_array_append_vals(assignments, block->assignments->data,
+			    site->call_index);
+
+	char **arguments = g_new(char *, call->argument_count);
+	for (uint32_t i = 0; i < call->argument_count; i++) {
+		arguments[i] = new_field(context, block);
+
+		struct llir_assignment *move = llir_assignment_new_unary(
+			LLIR_ASSIGNMENT_TYPE_MOVE, call->arguments[i],
+			arguments[i]);
+		g_array_append_val(assignments, move);
+	}
+
+	if (site->accumulates) {
+		GHashTable *derived = g_hash_table_new(g_str_hash, g_str_equal);
+		g_hash_table_add(derived, call->destination);
+
+		for (uint32_t i = site->call_index + 1;
+		     i < block->assignments->len - 1; i++) {
+			struct llir_assignment *assignment = g_array_index(
+				block->assignments, struct llir_assignment *,
+				i);
+			if (is_derived_move(assignment, derived)) {
+				g_hash_table_add(derived,
+						 assignment->destination);
+				llir_assignment_free(assignment);
+			} else {
+				g_array_append_val(assignments, assignment);
+			}
+		}
+
+		struct llir_assignment *accumulate = last_assignment(block);
+		if (is_derived(accumulate->left, derived))
+			accumulate->left = accumulate->right;
+		accumulate->right = llir_operand_from_field(accumulator);
+		accumulate->destination = accumulator;
+		g_array_append_val(assignments, accumulate);
+
+		g_hash_table_unref(derived);
+	}
+
+	for (uint32_t i = 0; i < call->argument_count; i++) {
+		struct llir_field *argument = g_array_index(
+			method->arguments, struct llir_field *, i);
+		struct llir_assignment *move = llir_assignment_new_unary(
+			LLIR_ASSIGNMENT_TYPE_MOVE,
+			llir_operand_from_field(arguments[i]),
+			argument->identifier);
+		g_array_append_val(assignments, move);
+	}
+
+	llir_assignment_free(call);
+	g_array_free(block->assignments, true);
+	block->assignments = assignments;
+
+	llir_return_free(block->llir_return);
+	llir_block_set_terminal(block, LLIR_BLOCK_TERMINAL_TYPE_JUMP,
+				llir_jump_new(header));
+
+	g_free(arguments);
+}
+
+static void accumulate_return(struct tce_context *context,
+			      struct llir_block *block,
+			      enum llir_assignment_type type, char *accumulator)
+{
+	char *result = new_field(context, block);
+	struct llir_assignment *accumulate = llir_assignment_new_binary(
+		type, block->llir_return->source,
+		llir_operand_from_field(accumulator), result);
+	llir_block_add_assignment(block, accumulate);
+
+	block->llir_return->source = llir_operand_from_field(result);
+}
+
+static void eliminate_method_tail_calls(struct tce_context *context,
+					struct llir_method *method)
+{
+	if (g_strcmp0(method->identifier, "main") == 0)
+		return;
+
+	enum llir_assignment_type accumulation = LLIR_ASSIGNMENT_TYPE_ADD;
+	bool accumulates = find_accumulation(method, &accumulation);
+	bool constant_returns = returns_constant(method);
+
+	GArray *sites = g_array_new(false, false, sizeof(struct tail_site));
+	for (uint32_t i = 0; i < method->blocks->len; i++) {
+		struct llir_block *block =
+			g_array_index(method->blocks, struct llir_block *, i);
+		struct tail_site site = { .block = block };
+
+		if (is_tail_call(method, block, constant_returns)) {
+			site.call_index = block->assignments->len - 1;
+			site.accumulates = false;
+			g_array_append_val(sites, site);
+		} else if (accumulates &&
+			   find_accumulating_call(method, block) >= 0) {
+			site.call_index = find_accumulating_call(method, block);
+			site.accumulates = true;
+			g_array_append_val(sites, site);
+		}
+	}
+
+	if (sites->len == 0) {
+		g_array_free(sites, true);
+		return;
+	}
+
+	struct llir_block *header =
+		g_array_index(method->blocks, struct llir_block *, 0);
+	char *accumulator = NULL;
+
+	if (accumulates) {
+		struct llir_block *entry =
+			llir_block_new(context->block_counter++);
+		accumulator = new_field(context, entry);
+
+		int64_t identity =
+			accumulation == LLIR_ASSIGNMENT_TYPE_MULTIPLY ? 1 : 0;
+		llir_block_add_assignment(
+			entry, llir_assignment_new_unary(
+				       LLIR_ASSIGNMENT_TYPE_MOVE,
+				       llir_operand_from_literal(identity),
+				       accumulator));
+		llir_block_set_terminal(entry, LLIR_BLOCK_TERMINAL_TYPE_JUMP,
+					llir_jump_new(header));
+		g_array_prepend_val(method->blocks, entry);
+	}
+
+	for (uint32_t i = 0; i < sites->len; i++)
+		eliminate_tail_call(context, method,
+				    &g_array_index(sites, struct tail_site, i),
+				    header, accumulator);
+
+	if (accumulates) {
+		for (uint32_t i = 0; i < method->blocks->len; i++) {
+			struct llir_block *block = g_array_index(
+				method->blocks, struct llir_block *, i);
+			if (block->terminal_type ==
+			    LLIR_BLOCK_TERMINAL_TYPE_RETURN)
+				accumulate_return(context, block, accumulation,
+						  accumulator);
+		}
+	}
+
+	g_array_free(sites, true);
+}
+
+void optimization_tail_call_elimination(struct llir *llir)
+{
+	struct tce_context context = {
+		.block_counter = llir_next_block_id(llir),
+		.field_counter = 0,
+	};
+
+	for (uint32_t i = 0; i < llir->methods->len; i++) {
+		struct llir_method *method =
+			g_array_index(llir->methods, struct llir_method *, i);
+		eliminate_method_tail_calls(&context, method);
+	}
+}
@@ -0,0 +1,4 @@
+#pragma once
+#include "assembly/llir.h"
+
+void optimization_tail_call_elimination(struct llir *llir);
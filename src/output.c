@@ -0,0 +1,61 @@
+#include <stdio.h>
+
+#include "output.h"
+
+#define OUTPUT_CAPTURE_MAX_DEPTH 8
+
+struct output_capture {
+	GString *output;
+	GString *errors;
+};
+
+// captures nest per thread, a NULL buffer passes the text on to the
+// enclosing capture or to the real stream
+static _Thread_local struct output_capture captures[OUTPUT_CAPTURE_MAX_DEPTH];
+static _Thread_local uint32_t capture_count = 0;
+
+static void print_to_capture(const gchar *string)
+{
+	for (uint32_t i = capture_count; i > 0; i--) {
+		if (captures[i - 1].output != NULL) {
+			g_string_append(captures[i - 1].output, string);
+			return;
+		}
+	}
+
+	fputs(string, stdout);
+}
+
+static void printerr_to_capture(const gchar *string)
+{
+	for (uint32_t i = capture_count; i > 0; i--) {
+		if (captures[i - 1].errors != NULL) {
+			g_string_append(captures[i - 1].errors, string);
+			return;
+		}
+	}
+
+	fputs(string, stderr);
+}
+
+void output_capture_begin(GString *output, GString *errors)
+{
+	static gsize handlers_installed = 0;
+	if (g_once_init_enter(&handlers_installed)) {
+		g_set_print_handler(print_to_capture);
+		g_set_printerr_handler(printerr_to_capture);
+		g_once_init_leave(&handlers_installed, 1);
+	}
+
+	g_assert(capture_count < OUTPUT_CAPTURE_MAX_DEPTH);
+	captures[capture_count++] = (struct output_capture){
+		.output = output,
+		.errors = errors,
+	};
+}
+
+void output_capture_end(void)
+{
+	g_assert(capture_count > 0);
+	capture_count--;
+}
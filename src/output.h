@@ -0,0 +1,5 @@
+#pragma once
+#include <glib.h>
+
+void output_capture_begin(GString *output, GString *errors);
+void output_capture_end(void);
@@ -58,6 +58,12 @@ struct ast_node {
 	struct token token;
 };
 
+// walks the nodes returned by ast_node_linearize in order
+struct ast_cursor {
+	struct ast_node *node;
+	const struct token_unit *unit;
+};
+
 struct ast_node *ast_node_new(enum ast_node_type type, struct token token);
 
 void ast_node_add_child(struct ast_node *node, struct ast_node *child);
@@ -1,56 +1,74 @@
 #include "parser/parser.h"
 
-static const enum token_type BOOL_LITERALS[] = {
-	TOKEN_TYPE_KEYWORD_TRUE,
-	TOKEN_TYPE_KEYWORD_FALSE,
-};
-
-static const enum token_type INT_LITERALS[] = {
-	TOKEN_TYPE_HEX_LITERAL,
-	TOKEN_TYPE_DECIMAL_LITERAL,
-};
-
-static const enum token_type TYPES[] = {
-	TOKEN_TYPE_KEYWORD_INT,
-	TOKEN_TYPE_KEYWORD_BOOL,
-};
-
-static const enum token_type BINARY_OPERATORS[] = {
-	TOKEN_TYPE_OR,
-	TOKEN_TYPE_AND,
-	TOKEN_TYPE_EQUAL,
-	TOKEN_TYPE_NOT_EQUAL,
-	TOKEN_TYPE_LESS,
-	TOKEN_TYPE_LESS_EQUAL,
-	TOKEN_TYPE_GREATER_EQUAL,
-	TOKEN_TYPE_GREATER,
-	TOKEN_TYPE_ADD,
-	TOKEN_TYPE_SUB,
-	TOKEN_TYPE_MUL,
-	TOKEN_TYPE_DIV,
-	TOKEN_TYPE_MOD,
-};
-
-static const enum token_type ASSIGN_OPERATORS[] = {
-	TOKEN_TYPE_ASSIGN,     TOKEN_TYPE_ADD_ASSIGN, TOKEN_TYPE_SUB_ASSIGN,
-	TOKEN_TYPE_MUL_ASSIGN, TOKEN_TYPE_DIV_ASSIGN, TOKEN_TYPE_MOD_ASSIGN,
-};
-
-static const enum token_type INCREMENT_OPERATORS[] = {
-	TOKEN_TYPE_INCREMENT,
-	TOKEN_TYPE_DECREMENT,
-};
-
-static const enum token_type KEYWORDS[] = {
-	TOKEN_TYPE_KEYWORD_BOOL,   TOKEN_TYPE_KEYWORD_BREAK,
-	TOKEN_TYPE_KEYWORD_CONST,  TOKEN_TYPE_KEYWORD_CONTINUE,
-	TOKEN_TYPE_KEYWORD_ELSE,   TOKEN_TYPE_KEYWORD_FALSE,
-	TOKEN_TYPE_KEYWORD_FOR,	   TOKEN_TYPE_KEYWORD_IF,
-	TOKEN_TYPE_KEYWORD_IMPORT, TOKEN_TYPE_KEYWORD_INT,
-	TOKEN_TYPE_KEYWORD_LEN,	   TOKEN_TYPE_KEYWORD_RETURN,
-	TOKEN_TYPE_KEYWORD_TRUE,   TOKEN_TYPE_KEYWORD_VOID,
-	TOKEN_TYPE_KEYWORD_WHILE,
-};
+// token types are bits of a 64 bit set, so checking a token against a whole
+// set is one mask instead of a loop over its members
+#define TOKEN_SET(type) ((uint64_t)1 << (type))
+
+_Static_assert(TOKEN_TYPE_UNKNOWN < 64, "token types must fit a token set");
+
+static const uint64_t BOOL_LITERALS = TOKEN_SET(TOKEN_TYPE_KEYWORD_TRUE) |
+				      TOKEN_SET(TOKEN_TYPE_KEYWORD_FALSE);
+
+static const uint64_t INT_LITERALS = TOKEN_SET(TOKEN_TYPE_HEX_LITERAL) |
+				     TOKEN_SET(TOKEN_TYPE_DECIMAL_LITERAL);
+
+static const uint64_t TYPES =
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_INT) | TOKEN_SET(TOKEN_TYPE_KEYWORD_BOOL);
+
+static const uint64_t BINARY_OPERATORS =
+	TOKEN_SET(TOKEN_TYPE_OR) | TOKEN_SET(TOKEN_TYPE_AND) |
+	TOKEN_SET(TOKEN_TYPE_EQUAL) | TOKEN_SET(TOKEN_TYPE_NOT_EQUAL) |
+	TOKEN_SET(TOKEN_TYPE_LESS) | TOKEN_SET(TOKEN_TYPE_LESS_EQUAL) |
+	TOKEN_SET(TOKEN_TYPE_GREATER_EQUAL) | TOKEN_SET(TOKEN_TYPE_GREATER) |
+	TOKEN_SET(TOKEN_TYPE_ADD) | TOKEN_SET(TOKEN_TYPE_SUB) |
+	TOKEN_SET(TOKEN_TYPE_MUL) | TOKEN_SET(TOKEN_TYPE_DIV) |
+	TOKEN_SET(TOKEN_TYPE_MOD);
+
+static const uint64_t ASSIGN_OPERATORS =
+	TOKEN_SET(TOKEN_TYPE_ASSIGN) | TOKEN_SET(TOKEN_TYPE_ADD_ASSIGN) |
+	TOKEN_SET(TOKEN_TYPE_SUB_ASSIGN) | TOKEN_SET(TOKEN_TYPE_MUL_ASSIGN) |
+	TOKEN_SET(TOKEN_TYPE_DIV_ASSIGN) | TOKEN_SET(TOKEN_TYPE_MOD_ASSIGN);
+
+static const uint64_t INCREMENT_OPERATORS =
+	TOKEN_SET(TOKEN_TYPE_INCREMENT) | TOKEN_SET(TOKEN_TYPE_DECREMENT);
+
+static const uint64_t KEYWORDS =
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_BOOL) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_BREAK) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_CONST) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_CONTINUE) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_ELSE) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_FALSE) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_FOR) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_IF) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_IMPORT) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_INT) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_LEN) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_RETURN) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_TRUE) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_VOID) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_WHILE);
+
+static const uint64_t LITERALS =
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_TRUE) |
+	TOKEN_SET(TOKEN_TYPE_KEYWORD_FALSE) |
+	TOKEN_SET(TOKEN_TYPE_HEX_LITERAL) |
+	TOKEN_SET(TOKEN_TYPE_DECIMAL_LITERAL) |
+	TOKEN_SET(TOKEN_TYPE_CHAR_LITERAL) |
+	TOKEN_SET(TOKEN_TYPE_STRING_LITERAL);
+
+static const uint64_t EXPRESSION_TERMINATORS =
+	TOKEN_SET(TOKEN_TYPE_CLOSE_PARENTHESIS) |
+	TOKEN_SET(TOKEN_TYPE_CLOSE_SQUARE_BRACKET) |
+	TOKEN_SET(TOKEN_TYPE_SEMICOLON) | TOKEN_SET(TOKEN_TYPE_COMMA);
+
+static const uint64_t NESTING_OPENERS =
+	TOKEN_SET(TOKEN_TYPE_OPEN_PARENTHESIS) |
+	TOKEN_SET(TOKEN_TYPE_OPEN_SQUARE_BRACKET);
+
+static const uint64_t NESTING_CLOSERS =
+	TOKEN_SET(TOKEN_TYPE_CLOSE_PARENTHESIS) |
+	TOKEN_SET(TOKEN_TYPE_CLOSE_SQUARE_BRACKET);
 
 static const uint32_t BINARY_OPERATOR_PRECEDENCE[] = {
 	[TOKEN_TYPE_OR] = 0,
@@ -74,11 +92,11 @@ static bool next_token(struct parser *parser, enum token_type token_type,
 	if (parser->position >= parser->token_count)
 		return false;
 
-	if (parser->tokens[parser->position].type != token_type)
+	if (parser->tokens->types[parser->position] != token_type)
 		return false;
 
 	if (token != NULL)
-		*token = parser->tokens[parser->position];
+		*token = token_stream_get(parser->tokens, parser->position);
 
 	parser->position++;
 	return true;
@@ -92,61 +110,81 @@ static bool peek_token(struct parser *parser, uint32_t relative_position,
 	if (position >= parser->token_count)
 		return false;
 
-	if (parser->tokens[position].type != token_type)
+	if (parser->tokens->types[position] != token_type)
 		return false;
 
 	return true;
 }
 
-static bool next_token_in_table(struct parser *parser, const uint32_t table[],
-				uint32_t table_length, struct token *token)
+// the token type at the relative position, or TOKEN_TYPE_UNKNOWN past the
+// last token
+static enum token_type peek_token_type(struct parser *parser,
+				       uint32_t relative_position)
 {
-	for (uint32_t i = 0; i < table_length; i++) {
-		if (next_token(parser, table[i], token))
-			return true;
-	}
+	uint32_t position = parser->position + relative_position;
 
-	return false;
+	if (position >= parser->token_count)
+		return TOKEN_TYPE_UNKNOWN;
+
+	return parser->tokens->types[position];
 }
 
-static bool peek_token_in_table(struct parser *parser,
-				uint32_t relative_position,
-				const uint32_t table[], uint32_t table_length)
+static bool peek_token_in_set(struct parser *parser,
+			      uint32_t relative_position, uint64_t set)
 {
-	for (uint32_t i = 0; i < table_length; i++) {
-		if (peek_token(parser, relative_position, table[i]))
-			return true;
-	}
+	uint32_t position = parser->position + relative_position;
+
+	if (position >= parser->token_count)
+		return false;
 
-	return false;
+	return (set & TOKEN_SET(parser->tokens->types[position])) != 0;
 }
 
-static struct ast_node *new_node(struct parser *parser, enum ast_node_type type)
+static bool next_token_in_set(struct parser *parser, uint64_t set,
+			      struct token *token)
+{
+	if (!peek_token_in_set(parser, 0, set))
+		return false;
+
+	if (token != NULL)
+		*token = token_stream_get(parser->tokens, parser->position);
+
+	parser->position++;
+	return true;
+}
+
+// nodes take the token before the position they start at
+static struct ast_node *new_node_at(struct parser *parser,
+				    enum ast_node_type type, uint32_t position)
 {
-	uint32_t position =
-		CLAMP(parser->position - 1, 0, parser->token_count - 1);
-	struct token token = parser->tokens[position];
+	position = CLAMP(position - 1, 0, parser->token_count - 1);
+	struct token token = token_stream_get(parser->tokens, position);
 	return ast_node_new(type, token);
 }
 
+static struct ast_node *new_node(struct parser *parser, enum ast_node_type type)
+{
+	return new_node_at(parser, type, parser->position);
+}
+
 static void parse_error(struct parser *parser, const char *message)
 {
 	uint32_t token_index = parser->position == 0 ? 0 : parser->position - 1;
-	struct token *token = &parser->tokens[token_index];
+	struct token token = token_stream_get(parser->tokens, token_index);
+	const struct token_unit *unit = &parser->tokens->unit;
 
-	uint32_t line_number = token_get_line_number(token);
-	uint32_t column_number = token_get_column_number(token);
+	uint32_t line_number = token_get_line_number(unit, &token);
+	uint32_t column_number = token_get_column_number(unit, &token);
 
 	parser->parse_error = true;
-	g_printerr("PARSE-ERROR at %s:%i:%i: %s\n", token->file_name,
+	g_printerr("PARSE-ERROR at %s:%i:%i: %s\n", unit->file_name,
 		   line_number, column_number, message);
 }
 
 static struct ast_node *parse_identifier(struct parser *parser)
 {
 	struct token token;
-	if (next_token_in_table(parser, KEYWORDS, G_N_ELEMENTS(KEYWORDS),
-				&token))
+	if (next_token_in_set(parser, KEYWORDS, &token))
 		parse_error(parser, "Keyword cannot be used as identifier");
 	else if (!next_token(parser, TOKEN_TYPE_IDENTIFIER, &token))
 		return NULL;
@@ -175,8 +213,7 @@ static struct ast_node *parse_string_literal(struct parser *parser)
 static struct ast_node *parse_bool_literal(struct parser *parser)
 {
 	struct token token;
-	if (!next_token_in_table(parser, BOOL_LITERALS,
-				 G_N_ELEMENTS(BOOL_LITERALS), &token))
+	if (!next_token_in_set(parser, BOOL_LITERALS, &token))
 		return NULL;
 
 	return ast_node_new(AST_NODE_TYPE_BOOL_LITERAL, token);
@@ -185,8 +222,7 @@ static struct ast_node *parse_bool_literal(struct parser *parser)
 static struct ast_node *parse_int_literal(struct parser *parser)
 {
 	struct token token;
-	if (!next_token_in_table(parser, INT_LITERALS,
-				 G_N_ELEMENTS(INT_LITERALS), &token))
+	if (!next_token_in_set(parser, INT_LITERALS, &token))
 		return NULL;
 
 	return ast_node_new(AST_NODE_TYPE_INT_LITERAL, token);
@@ -197,8 +233,7 @@ static struct ast_node *parse_type(struct parser *parser)
 	struct token token;
 	if (next_token(parser, TOKEN_TYPE_KEYWORD_VOID, &token))
 		parse_error(parser, "void type not permitted here");
-	else if (!next_token_in_table(parser, TYPES, G_N_ELEMENTS(TYPES),
-				      &token))
+	else if (!next_token_in_set(parser, TYPES, &token))
 		return NULL;
 
 	return ast_node_new(AST_NODE_TYPE_DATA_TYPE, token);
@@ -207,8 +242,7 @@ static struct ast_node *parse_type(struct parser *parser)
 static struct ast_node *parse_binary_operator(struct parser *parser)
 {
 	struct token token;
-	if (!next_token_in_table(parser, BINARY_OPERATORS,
-				 G_N_ELEMENTS(BINARY_OPERATORS), &token))
+	if (!next_token_in_set(parser, BINARY_OPERATORS, &token))
 		return NULL;
 
 	return ast_node_new(AST_NODE_TYPE_BINARY_OPERATOR, token);
@@ -217,8 +251,7 @@ static struct ast_node *parse_binary_operator(struct parser *parser)
 static struct ast_node *parse_increment_operator(struct parser *parser)
 {
 	struct token token;
-	if (!next_token_in_table(parser, INCREMENT_OPERATORS,
-				 G_N_ELEMENTS(INCREMENT_OPERATORS), &token))
+	if (!next_token_in_set(parser, INCREMENT_OPERATORS, &token))
 		return NULL;
 
 	return ast_node_new(AST_NODE_TYPE_INCREMENT_OPERATOR, token);
@@ -227,8 +260,7 @@ static struct ast_node *parse_increment_operator(struct parser *parser)
 static struct ast_node *parse_assign_operator(struct parser *parser)
 {
 	struct token token;
-	if (!next_token_in_table(parser, ASSIGN_OPERATORS,
-				 G_N_ELEMENTS(ASSIGN_OPERATORS), &token))
+	if (!next_token_in_set(parser, ASSIGN_OPERATORS, &token))
 		return NULL;
 
 	return ast_node_new(AST_NODE_TYPE_ASSIGN_OPERATOR, token);
@@ -378,123 +410,140 @@ static struct ast_node *parse_method_call(struct parser *parser)
 
 static bool is_binary_operator(struct parser *parser, uint32_t i)
 {
-	if (peek_token(parser, i, TOKEN_TYPE_SUB)) {
+	if (peek_token_type(parser, i) == TOKEN_TYPE_SUB) {
 		if (i == 0)
 			return false;
 
-		if (peek_token_in_table(parser, i - 1, BINARY_OPERATORS,
-					G_N_ELEMENTS(BINARY_OPERATORS)))
+		if (peek_token_in_set(parser, i - 1, BINARY_OPERATORS))
 			return false;
 
 		if (peek_token(parser, i - 1, TOKEN_TYPE_NOT))
 			return false;
 	}
 
-	return peek_token_in_table(parser, i, BINARY_OPERATORS,
-				   G_N_ELEMENTS(BINARY_OPERATORS));
+	return peek_token_in_set(parser, i, BINARY_OPERATORS);
 }
 
 static bool is_expression_termination(struct parser *parser, uint32_t depth,
 				      uint32_t i)
 {
 	return (depth == 0 &&
-		(peek_token(parser, i, TOKEN_TYPE_CLOSE_PARENTHESIS) ||
-		 peek_token(parser, i, TOKEN_TYPE_CLOSE_SQUARE_BRACKET) ||
-		 peek_token(parser, i, TOKEN_TYPE_SEMICOLON) ||
-		 peek_token(parser, i, TOKEN_TYPE_COMMA))) ||
-	       i >= parser->token_count;
+		peek_token_in_set(parser, i, EXPRESSION_TERMINATORS)) ||
+	       parser->position + i >= parser->token_count;
 }
 
-static GArray *find_binary_operator_indices(struct parser *parser,
-					    uint32_t length)
+// the binary operators outside of any parentheses or brackets up to the end
+// of the expression, pushed onto the parser's operator stack as positions
+struct binary_operators {
+	uint32_t first;
+	uint32_t next;
+	uint32_t end;
+};
+
+static struct binary_operators find_binary_operators(struct parser *parser)
 {
-	GArray *indices = g_array_new(false, false, sizeof(uint32_t));
+	struct binary_operators operators = {
+		.first = parser->operators->len,
+		.next = parser->operators->len,
+	};
 
 	uint32_t depth = 0;
-	uint32_t i = 0;
-
-	while (i < length && !is_expression_termination(parser, depth, i)) {
-		if (peek_token(parser, i, TOKEN_TYPE_OPEN_PARENTHESIS) ||
-		    peek_token(parser, i, TOKEN_TYPE_OPEN_SQUARE_BRACKET))
+	for (uint32_t i = 0; !is_expression_termination(parser, depth, i);
+	     i++) {
+		if (peek_token_in_set(parser, i, NESTING_OPENERS))
 			depth++;
 
-		if (peek_token(parser, i, TOKEN_TYPE_CLOSE_PARENTHESIS) ||
-		    peek_token(parser, i, TOKEN_TYPE_CLOSE_SQUARE_BRACKET))
+		if (peek_token_in_set(parser, i, NESTING_CLOSERS))
 			depth--;
 
-		if (depth == 0 && is_binary_operator(parser, i))
-			g_array_append_val(indices, i);
-
-		i++;
+		if (depth == 0 && is_binary_operator(parser, i)) {
+			uint32_t position = parser->position + i;
+			g_array_append_val(parser->operators, position);
+		}
 	}
 
-	return indices;
+	operators.end = parser->operators->len;
+	return operators;
 }
 
-static uint32_t get_lowest_precedence_index(struct parser *parser,
-					    GArray *operator_indices)
+static uint32_t operator_position(struct parser *parser, uint32_t operator)
 {
-	uint32_t lowest_precedence_index = 0;
-	uint32_t lowest_precedence = -1;
-
-	for (uint32_t i = 0; i < operator_indices->len; i++) {
-		uint32_t index = g_array_index(operator_indices, uint32_t, i);
-		enum token_type type =
-			parser->tokens[parser->position + index].type;
-
-		uint32_t precedence = BINARY_OPERATOR_PRECEDENCE[type];
-		if (precedence <= lowest_precedence) {
-			lowest_precedence = precedence;
-			lowest_precedence_index = index;
-		}
-	}
+	return g_array_index(parser->operators, uint32_t, operator);
+}
 
-	return lowest_precedence_index;
+static uint32_t operator_precedence(struct parser *parser, uint32_t operator)
+{
+	enum token_type type =
+		parser->tokens->types[operator_position(parser, operator)];
+	return BINARY_OPERATOR_PRECEDENCE[type];
 }
 
 static struct ast_node *parse_unary_expression(struct parser *parser);
 
-static struct ast_node *parse_expression_with_length(struct parser *parser,
-						     uint32_t length);
+static struct ast_node *parse_operand(struct parser *parser,
+				      struct binary_operators *operators)
+{
+	struct ast_node *operand = parse_unary_expression(parser);
+	if (operand != NULL)
+		return operand;
+
+	// a missing operand belongs to the operator binding tighter, the
+	// earlier one on a tie
+	bool previous = operators->next > operators->first;
+	bool next = operators->next < operators->end;
+	if (next && (!previous || operator_precedence(parser, operators->next) >
+					  operator_precedence(
+						  parser, operators->next - 1)))
+		parse_error(parser, "Expected expression before operator");
+	else if (previous)
+		parse_error(parser, "Expected expression after operator");
+
+	return NULL;
+}
 
-static struct ast_node *parse_binary_expression(struct parser *parser,
-						uint32_t length)
+// precedence climbing over the operators found up front, equal precedences
+// associate to the left. an operand ending before the next operator is
+// reported and skipped up to it
+static struct ast_node *
+parse_binary_expression(struct parser *parser,
+			struct binary_operators *operators,
+			uint32_t minimum_precedence)
 {
-	GArray *indices = find_binary_operator_indices(parser, length);
-	if (indices->len == 0) {
-		g_array_free(indices, true);
-		return NULL;
-	}
+	uint32_t start = parser->position;
+	struct ast_node *left = parse_operand(parser, operators);
 
-	struct ast_node *expression =
-		new_node(parser, AST_NODE_TYPE_BINARY_EXPRESSION);
+	while (operators->next < operators->end) {
+		uint32_t precedence =
+			operator_precedence(parser, operators->next);
+		if (precedence < minimum_precedence)
+			break;
 
-	uint32_t operator_index = get_lowest_precedence_index(parser, indices);
-	uint32_t expected_position = parser->position + operator_index;
+		uint32_t position = operator_position(parser, operators->next);
+		if (parser->position != position) {
+			parse_error(parser,
+				    "Expected binary operator in expression");
+			parser->position = position;
+		}
 
-	struct ast_node *left =
-		parse_expression_with_length(parser, operator_index);
-	if (left == NULL)
-		parse_error(parser, "Expected expression before operator");
-	ast_node_add_child(expression, left);
+		struct ast_node *expression =
+			new_node_at(parser, AST_NODE_TYPE_EXPRESSION, start);
+		struct ast_node *binary_expression = new_node_at(
+			parser, AST_NODE_TYPE_BINARY_EXPRESSION, start);
+		ast_node_add_child(expression, binary_expression);
 
-	if (parser->position != expected_position) {
-		parse_error(parser, "Expected binary operator in expression");
-		parser->position = expected_position;
-	}
-	struct ast_node *binary_operator = parse_binary_operator(parser);
-	ast_node_add_child(expression, binary_operator);
+		ast_node_add_child(binary_expression, left);
+		ast_node_add_child(binary_expression,
+				   parse_binary_operator(parser));
+		operators->next++;
 
-	if (length != (uint32_t)-1)
-		length -= operator_index + 1;
+		struct ast_node *right = parse_binary_expression(
+			parser, operators, precedence + 1);
+		ast_node_add_child(binary_expression, right);
 
-	struct ast_node *right = parse_expression_with_length(parser, length);
-	if (right == NULL)
-		parse_error(parser, "Expected expression after operator");
-	ast_node_add_child(expression, right);
+		left = expression;
+	}
 
-	g_array_free(indices, true);
-	return expression;
+	return left;
 }
 
 static struct ast_node *parse_parenthesis_expression(struct parser *parser)
@@ -579,37 +628,33 @@ static struct ast_node *parse_unary_expression(struct parser *parser)
 	struct ast_node *expression =
 		new_node(parser, AST_NODE_TYPE_EXPRESSION);
 
-	struct ast_node *child;
-	if ((child = parse_len_expression(parser))) {
-	} else if ((child = parse_not_expression(parser))) {
-	} else if ((child = parse_negate_expression(parser))) {
-	} else if ((child = parse_literal(parser))) {
-	} else if ((child = parse_method_call(parser))) {
-	} else if ((child = parse_location(parser))) {
-	} else if ((child = parse_parenthesis_expression(parser))) {
-		ast_node_free(expression);
-		return child;
-	} else {
+	enum token_type type = peek_token_type(parser, 0);
+
+	struct ast_node *child = NULL;
+	if (type == TOKEN_TYPE_KEYWORD_LEN) {
+		child = parse_len_expression(parser);
+	} else if (type == TOKEN_TYPE_NOT) {
+		child = parse_not_expression(parser);
+	} else if (type == TOKEN_TYPE_SUB) {
+		// a negated int literal is a literal of its own
+		child = parse_negate_expression(parser);
+		if (child == NULL)
+			child = parse_literal(parser);
+	} else if (TOKEN_SET(type) & LITERALS) {
+		child = parse_literal(parser);
+	} else if (type == TOKEN_TYPE_IDENTIFIER) {
+		child = parse_method_call(parser);
+		if (child == NULL)
+			child = parse_location(parser);
+	} else if (TOKEN_SET(type) & KEYWORDS) {
+		// reported as a keyword used as an identifier
+		child = parse_location(parser);
+	} else if (type == TOKEN_TYPE_OPEN_PARENTHESIS) {
 		ast_node_free(expression);
-		return NULL;
+		return parse_parenthesis_expression(parser);
 	}
 
-	ast_node_add_child(expression, child);
-	return expression;
-}
-
-static struct ast_node *parse_expression_with_length(struct parser *parser,
-						     uint32_t length)
-{
-	struct ast_node *expression =
-		new_node(parser, AST_NODE_TYPE_EXPRESSION);
-
-	struct ast_node *child;
-	if ((child = parse_binary_expression(parser, length))) {
-	} else if ((child = parse_unary_expression(parser))) {
-		ast_node_free(expression);
-		return child;
-	} else {
+	if (child == NULL) {
 		ast_node_free(expression);
 		return NULL;
 	}
@@ -620,7 +665,12 @@ static struct ast_node *parse_expression_with_length(struct parser *parser,
 
 static struct ast_node *parse_expression(struct parser *parser)
 {
-	return parse_expression_with_length(parser, (uint32_t)-1);
+	struct binary_operators operators = find_binary_operators(parser);
+	struct ast_node *expression =
+		parse_binary_expression(parser, &operators, 0);
+	g_array_set_size(parser->operators, operators.first);
+
+	return expression;
 }
 
 static struct ast_node *parse_assignment(struct parser *parser)
@@ -891,16 +941,39 @@ static struct ast_node *parse_statement(struct parser *parser)
 {
 	struct ast_node *statement = new_node(parser, AST_NODE_TYPE_STATEMENT);
 
-	struct ast_node *child;
-	if ((child = parse_if_statement(parser))) {
-	} else if ((child = parse_for_statement(parser))) {
-	} else if ((child = parse_while_statement(parser))) {
-	} else if ((child = parse_return_statement(parser))) {
-	} else if ((child = parse_break_statement(parser))) {
-	} else if ((child = parse_continue_statement(parser))) {
-	} else if ((child = parse_method_call_statement(parser))) {
-	} else if ((child = parse_assign_statement(parser))) {
-	} else {
+	struct ast_node *child = NULL;
+	switch (peek_token_type(parser, 0)) {
+	case TOKEN_TYPE_KEYWORD_IF:
+		child = parse_if_statement(parser);
+		break;
+	case TOKEN_TYPE_KEYWORD_FOR:
+		child = parse_for_statement(parser);
+		break;
+	case TOKEN_TYPE_KEYWORD_WHILE:
+		child = parse_while_statement(parser);
+		break;
+	case TOKEN_TYPE_KEYWORD_RETURN:
+		child = parse_return_statement(parser);
+		break;
+	case TOKEN_TYPE_KEYWORD_BREAK:
+		child = parse_break_statement(parser);
+		break;
+	case TOKEN_TYPE_KEYWORD_CONTINUE:
+		child = parse_continue_statement(parser);
+		break;
+	case TOKEN_TYPE_IDENTIFIER:
+		child = parse_method_call_statement(parser);
+		if (child == NULL)
+			child = parse_assign_statement(parser);
+		break;
+	default:
+		// any other keyword is reported as an identifier assigned to
+		if (peek_token_in_set(parser, 0, KEYWORDS))
+			child = parse_assign_statement(parser);
+		break;
+	}
+
+	if (child == NULL) {
 		ast_node_free(statement);
 		return NULL;
 	}
@@ -1144,12 +1217,12 @@ struct parser *parser_new(void)
 	return parser;
 }
 
-int parser_parse(struct parser *parser, GArray *token_list,
+int parser_parse(struct parser *parser, struct token_stream *tokens,
 		 struct ast_node **ast)
 {
 	*parser = (struct parser){
-		.tokens = &g_array_index(token_list, struct token, 0),
-		.token_count = token_list->len,
+		.tokens = tokens,
+		.token_count = tokens->count,
 		.position = 0,
 		.parse_error = false,
 	};
@@ -1157,7 +1230,9 @@ int parser_parse(struct parser *parser, GArray *token_list,
 		g_printerr("goofy ass forgot to put code in the file\n");
 		return -1;
 	}
+	parser->operators = g_array_new(false, false, sizeof(uint32_t));
 	struct ast_node *program = parse_program(parser);
+	g_array_free(parser->operators, true);
 
 	if (ast != NULL && !parser->parse_error)
 		*ast = program;
@@ -7,15 +7,16 @@
 #include "scanner/scanner.h"
 
 struct parser {
-	struct token *tokens;
+	struct token_stream *tokens;
 	uint32_t token_count;
 	uint32_t position;
 	bool parse_error;
+	GArray *operators;
 };
 
 struct parser *parser_new(void);
 
-int parser_parse(struct parser *parser, GArray *token_list,
+int parser_parse(struct parser *parser, struct token_stream *tokens,
 		 struct ast_node **ast);
 
 void parser_free(struct parser *parser);
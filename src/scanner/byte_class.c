@@ -0,0 +1,123 @@
+#include "scanner/byte_class.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BYTE_CLASS_SIMD
+#include <immintrin.h>
+#endif
+
+bool byte_class_contains(const struct byte_class *class, uint8_t byte)
+{
+	bool contains = (byte >= class->range_start &&
+			 byte <= class->range_end) ||
+			(class->non_ascii && byte >= 0x80);
+	for (uint8_t i = 0; i < class->byte_count; i++)
+		contains = contains || byte == class->bytes[i];
+
+	return contains != class->complement;
+}
+
+static uint32_t find_scalar(const struct byte_class *class, const char *string)
+{
+	uint32_t offset = 0;
+	while (!byte_class_contains(class, string[offset]))
+		offset++;
+
+	return offset;
+}
+
+#ifdef BYTE_CLASS_SIMD
+
+// the blocks are loaded aligned, so they never reach into a page after the
+// one holding the terminator and reading past it cannot fault
+
+static uint32_t mask_sse2(const struct byte_class *class, __m128i block)
+{
+	// unsigned range check, x - start <= end - start
+	__m128i shifted =
+		_mm_sub_epi8(block, _mm_set1_epi8(class->range_start));
+	__m128i width = _mm_set1_epi8(class->range_end - class->range_start);
+	__m128i members = _mm_cmpeq_epi8(_mm_min_epu8(shifted, width), shifted);
+
+	for (uint8_t i = 0; i < class->byte_count; i++) {
+		__m128i byte = _mm_set1_epi8(class->bytes[i]);
+		members = _mm_or_si128(members, _mm_cmpeq_epi8(block, byte));
+	}
+
+	// non-ASCII bytes already have the sign bit that movemask collects
+	if (class->non_ascii)
+		members = _mm_or_si128(members, block);
+
+	uint32_t mask = _mm_movemask_epi8(members);
+	return class->complement ? ~mask & 0xffff : mask;
+}
+
+__attribute__((no_sanitize_address)) static uint32_t
+find_sse2(const struct byte_class *class, const char *string)
+{
+	uintptr_t skipped = (uintptr_t)string % 16;
+	const char *block = string - skipped;
+
+	uint32_t mask =
+		mask_sse2(class, _mm_load_si128((const __m128i *)block)) &
+		(0xffff << skipped);
+	while (mask == 0) {
+		block += 16;
+		mask = mask_sse2(class, _mm_load_si128((const __m128i *)block));
+	}
+
+	return block + __builtin_ctz(mask) - string;
+}
+
+__attribute__((target("avx2"))) static uint32_t
+mask_avx2(const struct byte_class *class, __m256i block)
+{
+	__m256i shifted =
+		_mm256_sub_epi8(block, _mm256_set1_epi8(class->range_start));
+	__m256i width =
+		_mm256_set1_epi8(class->range_end - class->range_start);
+	__m256i members =
+		_mm256_cmpeq_epi8(_mm256_min_epu8(shifted, width), shifted);
+
+	for (uint8_t i = 0; i < class->byte_count; i++) {
+		__m256i byte = _mm256_set1_epi8(class->bytes[i]);
+		members = _mm256_or_si256(members,
+					  _mm256_cmpeq_epi8(block, byte));
+	}
+
+	if (class->non_ascii)
+		members = _mm256_or_si256(members, block);
+
+	uint32_t mask = _mm256_movemask_epi8(members);
+	return class->complement ? ~mask : mask;
+}
+
+__attribute__((target("avx2"), no_sanitize_address)) static uint32_t
+find_avx2(const struct byte_class *class, const char *string)
+{
+	uintptr_t skipped = (uintptr_t)string % 32;
+	const char *block = string - skipped;
+
+	uint32_t mask =
+		mask_avx2(class, _mm256_load_si256((const __m256i *)block)) &
+		(0xffffffff << skipped);
+	while (mask == 0) {
+		block += 32;
+		mask = mask_avx2(class,
+				 _mm256_load_si256((const __m256i *)block));
+	}
+
+	return block + __builtin_ctz(mask) - string;
+}
+
+#endif
+
+uint32_t byte_class_find(const struct byte_class *class, const char *string)
+{
+#ifdef BYTE_CLASS_SIMD
+	if (__builtin_cpu_supports("avx2"))
+		return find_avx2(class, string);
+	return find_sse2(class, string);
+#else
+	return find_scalar(class, string);
+#endif
+}
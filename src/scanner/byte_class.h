@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BYTE_CLASS_MAX_BYTES 4
+
+// a set of bytes made of up to four single bytes, one inclusive range and
+// optionally every byte past ASCII, or the complement of all that
+struct byte_class {
+	uint8_t bytes[BYTE_CLASS_MAX_BYTES];
+	uint8_t byte_count;
+	uint8_t range_start;
+	uint8_t range_end;
+	bool non_ascii;
+	bool complement;
+};
+
+bool byte_class_contains(const struct byte_class *class, uint8_t byte);
+
+// returns the offset of the first byte of the '\0' terminated string that is
+// in the class, the class must contain '\0' so the search always stops
+uint32_t byte_class_find(const struct byte_class *class, const char *string);
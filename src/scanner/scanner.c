@@ -1,4 +1,47 @@
 #include "scanner/scanner.h"
+#include "scanner/byte_class.h"
+#include "scanner/source.h"
+
+// lexing is slow enough that even chunks this small take far longer than
+// starting the thread for them
+#define PARALLEL_CHUNK_MIN_SIZE (1 << 16)
+
+// the fast paths below find the end of the most common long tokens without
+// the regex, any byte past ASCII is left to it since whether it is a space
+// or a line break depends on how the regex decodes it
+
+static const struct byte_class WHITESPACE_END = {
+	.bytes = { ' ' },
+	.byte_count = 1,
+	.range_start = '\t',
+	.range_end = '\r',
+	.complement = true,
+};
+
+static const struct byte_class LINE_COMMENT_END = {
+	.bytes = { '\0' },
+	.byte_count = 1,
+	.range_start = '\n',
+	.range_end = '\r',
+	.non_ascii = true,
+};
+
+static const struct byte_class MULTILINE_COMMENT_STOP = {
+	.bytes = { '*' },
+	.byte_count = 1,
+	.range_start = '\0',
+	.range_end = '\0',
+	.non_ascii = true,
+};
+
+// everything that is not a valid character on its own
+static const struct byte_class STRING_LITERAL_STOP = {
+	.bytes = { '"', '\'', '\\', 0x7f },
+	.byte_count = 4,
+	.range_start = '\0',
+	.range_end = 0x1f,
+	.non_ascii = true,
+};
 
 static GString *merge_regex_patterns(void)
 {
@@ -16,29 +59,51 @@ static GString *merge_regex_patterns(void)
 	return merged_pattern;
 }
 
-struct scanner *scanner_new(void)
+// the regex is immutable once compiled, so every scanner in the process
+// shares the one compiled on first use
+static GRegex *shared_regex(void)
 {
-	struct scanner *scanner = g_new(struct scanner, 1);
+	static gsize regex = 0;
 
-	GString *merged_pattern = merge_regex_patterns();
+	if (g_once_init_enter(&regex)) {
+		GString *merged_pattern = merge_regex_patterns();
 
-	GError *error = NULL;
-	scanner->regex = g_regex_new(merged_pattern->str,
-				     G_REGEX_MULTILINE | G_REGEX_OPTIMIZE, 0,
-				     &error);
-	if (error != NULL)
-		g_error("%s", error->message);
+		GError *error = NULL;
+		GRegex *compiled = g_regex_new(
+			merged_pattern->str,
+			G_REGEX_MULTILINE | G_REGEX_OPTIMIZE, 0, &error);
+		if (error != NULL)
+			g_error("%s", error->message);
 
-	g_string_free(merged_pattern, true);
+		g_string_free(merged_pattern, true);
+		g_once_init_leave(&regex, (gsize)compiled);
+	}
+
+	return (GRegex *)regex;
+}
+
+struct scanner *scanner_new(void)
+{
+	struct scanner *scanner = g_new(struct scanner, 1);
+	scanner->regex = g_regex_ref(shared_regex());
 	return scanner;
 }
 
+static void start_scanner(struct scanner *scanner, const char *file_name,
+			  const char *source, uint32_t length)
+{
+	scanner->unit = (struct token_unit){
+		.file_name = file_name,
+		.source = source,
+	};
+	scanner->length = length;
+	scanner->position = 0;
+}
+
 void scanner_start(struct scanner *scanner, const char *file_name,
 		   const char *source)
 {
-	scanner->file_name = file_name;
-	scanner->source = source;
-	scanner->position = 0;
+	start_scanner(scanner, file_name, source, strlen(source));
 }
 
 static enum token_type get_matched_token_type(GMatchInfo *match_info,
@@ -55,10 +120,16 @@ static enum token_type get_matched_token_type(GMatchInfo *match_info,
 
 static enum token_type match_token(struct scanner *scanner, uint32_t *length)
 {
-	const char *source = scanner->source + scanner->position;
+	const char *source = scanner->unit.source + scanner->position;
+
+	// without a length the regex measures the rest of the source again for
+	// every token, scanner_next_token never reads past the terminator
+	g_assert(scanner->position <= scanner->length);
+	gssize remaining = scanner->length - scanner->position;
 
 	GMatchInfo *match_info = NULL;
-	if (!g_regex_match(scanner->regex, source, 0, &match_info)) {
+	if (!g_regex_match_full(scanner->regex, source, remaining, 0, 0,
+				&match_info, NULL)) {
 		*length = (uint32_t)strlen(source);
 		return TOKEN_TYPE_UNKNOWN;
 	}
@@ -77,48 +148,310 @@ static enum token_type match_token(struct scanner *scanner, uint32_t *length)
 	return token_type;
 }
 
+static bool is_non_ascii(char byte)
+{
+	return (uint8_t)byte >= 0x80;
+}
+
+static bool match_whitespace(const char *source, uint32_t *length)
+{
+	uint32_t end = byte_class_find(&WHITESPACE_END, source);
+	if (is_non_ascii(source[end]))
+		return false;
+
+	*length = end;
+	return true;
+}
+
+static bool match_line_comment(const char *source, uint32_t *length)
+{
+	uint32_t end = 2 + byte_class_find(&LINE_COMMENT_END, source + 2);
+
+	// '\v' and '\f' may be line breaks to the regex as well
+	if (source[end] == '\v' || source[end] == '\f' ||
+	    is_non_ascii(source[end]))
+		return false;
+
+	*length = end;
+	return true;
+}
+
+static bool match_multiline_comment(const char *source, uint32_t *length)
+{
+	// "/*/" does not close the comment
+	uint32_t end = 2;
+	while (true) {
+		end += byte_class_find(&MULTILINE_COMMENT_STOP, source + end);
+		if (source[end] != '*')
+			return false;
+
+		end++;
+		if (source[end] == '/') {
+			*length = end + 1;
+			return true;
+		}
+	}
+}
+
+static bool is_escaped_char(char byte)
+{
+	return byte == '\'' || byte == '"' || byte == '\\' || byte == 't' ||
+	       byte == 'n';
+}
+
+static bool match_string_literal(const char *source, uint32_t *length)
+{
+	uint32_t end = 1;
+	while (true) {
+		end += byte_class_find(&STRING_LITERAL_STOP, source + end);
+		if (source[end] == '"') {
+			*length = end + 1;
+			return true;
+		}
+
+		// invalid characters and unterminated literals are reported by
+		// the regex
+		if (source[end] != '\\' || !is_escaped_char(source[end + 1]))
+			return false;
+
+		end += 2;
+	}
+}
+
+// none of the alternatives listed before these in the regex can match at
+// their first characters, so they match the same lengths it would
+static bool match_fast_path(struct scanner *scanner, struct token *token)
+{
+	const char *source = scanner->unit.source + scanner->position;
+
+	if (!byte_class_contains(&WHITESPACE_END, source[0])) {
+		token->type = TOKEN_TYPE_WHITESPACE;
+		return match_whitespace(source, &token->length);
+	}
+
+	if (source[0] == '/' && source[1] == '/') {
+		token->type = TOKEN_TYPE_LINE_COMMENT;
+		return match_line_comment(source, &token->length);
+	}
+
+	if (source[0] == '/' && source[1] == '*') {
+		token->type = TOKEN_TYPE_MULTILINE_COMMENT;
+		return match_multiline_comment(source, &token->length);
+	}
+
+	if (source[0] == '"') {
+		token->type = TOKEN_TYPE_STRING_LITERAL;
+		return match_string_literal(source, &token->length);
+	}
+
+	return false;
+}
+
 bool scanner_next_token(struct scanner *scanner, struct token *token)
 {
-	if (scanner->source[scanner->position] == '\0')
+	if (scanner->unit.source[scanner->position] == '\0')
 		return false;
 
-	token->type = match_token(scanner, &token->length);
+	if (!match_fast_path(scanner, token))
+		token->type = match_token(scanner, &token->length);
 	token->offset = scanner->position;
-	token->file_name = scanner->file_name;
-	token->source = scanner->source;
 	scanner->position += token->length;
 	return true;
 }
 
-int scanner_tokenize(struct scanner *scanner, const char *file_name,
-		     const char *source, bool print_output, GArray **out_tokens)
+static int emit_token(const struct token_unit *unit,
+		      struct token_stream *tokens, struct token *token,
+		      bool print_output)
 {
-	int result = 0;
-	scanner_start(scanner, file_name, source);
+	if (token_type_is_error(token->type)) {
+		token_print_error(unit, token);
+		return -1;
+	}
+
+	if (print_output)
+		token_print(unit, token);
+
+	token_stream_append(tokens, token);
+	return 0;
+}
 
-	GArray *tokens = g_array_new(false, false, sizeof(struct token));
+static int tokenize_serial(struct scanner *scanner,
+			   struct token_stream *tokens, bool print_output)
+{
+	int result = 0;
 
 	struct token token;
 	while (scanner_next_token(scanner, &token)) {
 		if (token_type_is_ignored(token.type))
 			continue;
 
-		if (token_type_is_error(token.type)) {
-			token_print_error(&token);
+		if (emit_token(&scanner->unit, tokens, &token, print_output) !=
+		    0)
 			result = -1;
-			continue;
+	}
+
+	return result;
+}
+
+// chunks start at line starts and lex every token starting before their end
+// without knowing whether the previous chunk ended inside a comment or a
+// literal, stitching only keeps their tokens from where the previous chunk
+// lands on one of their token starts, since lexing from any position always
+// continues the same way
+struct chunk {
+	struct scanner *scanner;
+	uint32_t end;
+	struct token_stream *tokens;
+};
+
+static void tokenize_chunk(gpointer data, gpointer user_data)
+{
+	struct chunk *chunk = data;
+
+	struct token token;
+	while (chunk->scanner->position < chunk->end &&
+	       scanner_next_token(chunk->scanner, &token)) {
+		// errors are kept too, stitching reports the ones it keeps
+		if (!token_type_is_ignored(token.type))
+			token_stream_append(chunk->tokens, &token);
+	}
+}
+
+static GArray *split_chunks(const char *file_name, const char *source,
+			    uint32_t length, uint32_t jobs)
+{
+	uint32_t count = MIN(jobs, length / PARALLEL_CHUNK_MIN_SIZE);
+	GArray *chunks = g_array_new(false, false, sizeof(struct chunk));
+
+	uint32_t start = 0;
+	for (uint32_t i = 1; i <= count; i++) {
+		uint32_t end = length;
+		if (i < count) {
+			uint32_t split = (uint64_t)length * i / count;
+			const char *line_end =
+				memchr(source + split, '\n', length - split);
+			if (line_end == NULL)
+				continue;
+			end = line_end + 1 - source;
 		}
+		if (end <= start)
+			continue;
+
+		struct chunk chunk = {
+			.scanner = scanner_new(),
+			.end = end,
+			.tokens = token_stream_new(file_name, source),
+		};
+		start_scanner(chunk.scanner, file_name, source, length);
+		chunk.scanner->position = start;
+		g_array_append_val(chunks, chunk);
+		start = end;
+	}
+
+	return chunks;
+}
+
+static int stitch_chunk(struct scanner *scanner, struct chunk *chunk,
+			struct token_stream *tokens, bool print_output)
+{
+	int result = 0;
+	struct token_stream *chunk_tokens = chunk->tokens;
+
+	// lex on from where the previous chunk stopped until reaching a token
+	// start of this one, or the end of it if it started inside a token
+	uint32_t i = 0;
+	while (scanner->position < chunk->end) {
+		while (i < chunk_tokens->count &&
+		       chunk_tokens->offsets[i] < scanner->position)
+			i++;
+		if (i < chunk_tokens->count &&
+		    chunk_tokens->offsets[i] == scanner->position)
+			break;
+
+		struct token token;
+		if (!scanner_next_token(scanner, &token))
+			return result;
+		if (token_type_is_ignored(token.type))
+			continue;
+		if (emit_token(&scanner->unit, tokens, &token, print_output) !=
+		    0)
+			result = -1;
+	}
+
+	if (scanner->position >= chunk->end)
+		return result;
+
+	for (; i < chunk_tokens->count; i++) {
+		struct token token = token_stream_get(chunk_tokens, i);
+		if (emit_token(&scanner->unit, tokens, &token, print_output) !=
+		    0)
+			result = -1;
+	}
+	scanner->position = chunk->scanner->position;
+
+	return result;
+}
+
+static int tokenize_parallel(struct scanner *scanner,
+			     struct token_stream *tokens, bool print_output,
+			     uint32_t length, uint32_t jobs)
+{
+	GArray *chunks = split_chunks(scanner->unit.file_name,
+				      scanner->unit.source, length, jobs);
+
+	GThreadPool *pool = g_thread_pool_new(tokenize_chunk, NULL,
+					      MIN(jobs, chunks->len), false,
+					      NULL);
+	for (uint32_t i = 0; i < chunks->len; i++) {
+		struct chunk *chunk = &g_array_index(chunks, struct chunk, i);
+		g_thread_pool_push(pool, chunk, NULL);
+	}
+	g_thread_pool_free(pool, false, true);
+
+	int result = 0;
+	for (uint32_t i = 0; i < chunks->len; i++) {
+		struct chunk *chunk = &g_array_index(chunks, struct chunk, i);
+		if (stitch_chunk(scanner, chunk, tokens, print_output) != 0)
+			result = -1;
+
+		scanner_free(chunk->scanner);
+		token_stream_free(chunk->tokens);
+	}
+	g_array_free(chunks, true);
 
-		if (print_output)
-			token_print(&token);
+	return result;
+}
 
-		g_array_append_val(tokens, token);
+int scanner_tokenize(struct scanner *scanner, const char *file_name,
+		     const char *source, bool print_output, uint32_t jobs,
+		     struct token_stream **out_tokens)
+{
+	gsize source_length = strlen(source);
+	if (source_length > SOURCE_MAX_LENGTH) {
+		g_printerr("%s is longer than the %u bytes a source can have\n",
+			   file_name, SOURCE_MAX_LENGTH);
+		return -1;
 	}
 
+	uint32_t length = source_length;
+	start_scanner(scanner, file_name, source, length);
+
+	struct token_stream *tokens = token_stream_new(file_name, source);
+
+	// the regex does not check the encoding, and on invalid UTF-8 a chunk
+	// may start matching at bytes lexing serially never starts at
+	int result;
+	if (jobs > 1 && length >= 2 * PARALLEL_CHUNK_MIN_SIZE &&
+	    g_utf8_validate(source, length, NULL))
+		result = tokenize_parallel(scanner, tokens, print_output,
+					   length, jobs);
+	else
+		result = tokenize_serial(scanner, tokens, print_output);
+
 	if (out_tokens != NULL && result == 0)
 		*out_tokens = tokens;
 	else
-		g_array_free(tokens, true);
+		token_stream_free(tokens);
 
 	return result;
 }
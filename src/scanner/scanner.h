@@ -6,8 +6,8 @@
 
 struct scanner {
 	GRegex *regex;
-	const char *file_name;
-	const char *source;
+	struct token_unit unit;
+	uint32_t length;
 	uint32_t position;
 };
 
@@ -18,7 +18,10 @@ void scanner_start(struct scanner *scanner, const char *file_name,
 
 bool scanner_next_token(struct scanner *scanner, struct token *token);
 
+// with more than one job, large sources are split into chunks lexed on that
+// many threads, the tokens and errors come out the same as lexing serially
 int scanner_tokenize(struct scanner *scanner, const char *file_name,
-		     const char *source, bool print_output, GArray **tokens);
+		     const char *source, bool print_output, uint32_t jobs,
+		     struct token_stream **tokens);
 
 void scanner_free(struct scanner *scanner);
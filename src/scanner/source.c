@@ -0,0 +1,129 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "scanner/source.h"
+
+#define READ_BUFFER_SIZE 65536
+
+static bool read_descriptor(int descriptor, struct source *source)
+{
+	gsize capacity = READ_BUFFER_SIZE;
+	gsize length = 0;
+	char *buffer = g_malloc(capacity);
+
+	while (true) {
+		// keep one byte free for the terminator
+		if (capacity - length < 2) {
+			capacity *= 2;
+			buffer = g_realloc(buffer, capacity);
+		}
+
+		ssize_t count = read(descriptor, buffer + length,
+				     capacity - length - 1);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0) {
+			g_free(buffer);
+			return false;
+		}
+		if (count == 0)
+			break;
+
+		length += count;
+		if (length > SOURCE_MAX_LENGTH) {
+			g_free(buffer);
+			errno = EFBIG;
+			return false;
+		}
+	}
+
+	buffer[length] = '\0';
+	source->contents = buffer;
+	source->length = length;
+	source->mapping_length = 0;
+	return true;
+}
+
+static bool map_descriptor(int descriptor, gsize length,
+			   struct source *source)
+{
+	// the file is mapped over zeroed anonymous pages reaching at least one
+	// byte past its end, which terminates it even if it fills its last page
+	gsize page_size = sysconf(_SC_PAGESIZE);
+	gsize mapping_length = (length / page_size + 1) * page_size;
+
+	char *mapping = mmap(NULL, mapping_length, PROT_READ,
+			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+		return false;
+
+	if (length > 0 && mmap(mapping, length, PROT_READ,
+			       MAP_PRIVATE | MAP_FIXED, descriptor,
+			       0) == MAP_FAILED) {
+		munmap(mapping, mapping_length);
+		return false;
+	}
+
+	source->contents = mapping;
+	source->length = length;
+	source->mapping_length = mapping_length;
+	return true;
+}
+
+struct source *source_load(const char *file_name)
+{
+	bool standard_input = g_strcmp0(file_name, "-") == 0;
+	int descriptor =
+		standard_input ? STDIN_FILENO : open(file_name, O_RDONLY);
+	if (descriptor < 0) {
+		g_printerr("Failed to open file '%s': %s\n", file_name,
+			   g_strerror(errno));
+		return NULL;
+	}
+
+	struct source *source = g_new(struct source, 1);
+
+	// pipes and terminals cannot be mapped, they are read into a buffer
+	// that grows as needed
+	struct stat status;
+	bool regular = fstat(descriptor, &status) == 0 &&
+		       S_ISREG(status.st_mode) && !standard_input;
+	bool loaded = false;
+	if (regular && status.st_size > SOURCE_MAX_LENGTH) {
+		errno = EFBIG;
+	} else {
+		if (regular)
+			loaded = map_descriptor(descriptor, status.st_size,
+						source);
+		if (!loaded)
+			loaded = read_descriptor(descriptor, source);
+	}
+
+	if (!loaded)
+		g_printerr("Failed to read file '%s': %s\n", file_name,
+			   g_strerror(errno));
+
+	if (!standard_input)
+		close(descriptor);
+
+	if (!loaded) {
+		g_free(source);
+		return NULL;
+	}
+
+	return source;
+}
+
+void source_free(struct source *source)
+{
+	if (source->mapping_length > 0)
+		munmap(source->contents, source->mapping_length);
+	else
+		g_free(source->contents);
+	g_free(source);
+}
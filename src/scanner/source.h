@@ -0,0 +1,18 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <glib.h>
+
+// tokens hold 32-bit offsets into the source, so longer ones are rejected
+#define SOURCE_MAX_LENGTH UINT32_MAX
+
+// the contents are always followed by a '\0', mapped sources are read-only
+struct source {
+	char *contents;
+	gsize length;
+	gsize mapping_length;
+};
+
+struct source *source_load(const char *file_name);
+
+void source_free(struct source *source);
@@ -118,39 +118,41 @@ const char *token_type_regex_pattern(enum token_type token_type)
 	return REGEX_PATTERNS[token_type];
 }
 
-uint32_t token_get_line_number(struct token *token)
+uint32_t token_get_line_number(const struct token_unit *unit,
+			       struct token *token)
 {
 	uint32_t line_number = 1;
 
 	for (uint32_t i = 0; i < token->offset; i++) {
-		if (token->source[i] == '\n')
+		if (unit->source[i] == '\n')
 			line_number++;
 
-		if (token->source[i] == '\0')
+		if (unit->source[i] == '\0')
 			return 0;
 	}
 
 	return line_number;
 }
 
-uint32_t token_get_column_number(struct token *token)
+uint32_t token_get_column_number(const struct token_unit *unit,
+				 struct token *token)
 {
 	for (int32_t i = token->offset; i >= 0; i--) {
-		if (i == 0 || token->source[i - 1] == '\n')
+		if (i == 0 || unit->source[i - 1] == '\n')
 			return token->offset - i;
 	}
 
 	return token->offset;
 }
 
-char *token_get_string(struct token *token)
+char *token_get_string(const struct token_unit *unit, struct token *token)
 {
-	return g_strndup(token->source + token->offset, token->length);
+	return g_strndup(unit->source + token->offset, token->length);
 }
 
-void token_print(struct token *token)
+void token_print(const struct token_unit *unit, struct token *token)
 {
-	uint32_t line_number = token_get_line_number(token);
+	uint32_t line_number = token_get_line_number(unit, token);
 
 	g_print("%i ", line_number);
 	if (token->type == TOKEN_TYPE_CHAR_LITERAL)
@@ -165,15 +167,67 @@ void token_print(struct token *token)
 		g_print("STRINGLITERAL ");
 	if (token->type == TOKEN_TYPE_IDENTIFIER)
 		g_print("IDENTIFIER ");
-	g_print("%.*s\n", token->length, &token->source[token->offset]);
+	g_print("%.*s\n", token->length, &unit->source[token->offset]);
 }
 
-void token_print_error(struct token *token)
+void token_print_error(const struct token_unit *unit, struct token *token)
 {
-	uint32_t line_number = token_get_line_number(token);
-	uint32_t column_number = token_get_column_number(token);
+	uint32_t line_number = token_get_line_number(unit, token);
+	uint32_t column_number = token_get_column_number(unit, token);
 	const char *error_message = token_type_error_message(token->type);
 	g_printerr("SCAN-ERROR: %s at %s:%i:%i: %.*s\n", error_message,
-		   token->file_name, line_number, column_number, token->length,
-		   &token->source[token->offset]);
+		   unit->file_name, line_number, column_number, token->length,
+		   &unit->source[token->offset]);
+}
+
+struct token_stream *token_stream_new(const char *file_name,
+				      const char *source)
+{
+	struct token_stream *stream = g_new(struct token_stream, 1);
+	stream->unit = (struct token_unit){
+		.file_name = file_name,
+		.source = source,
+	};
+	stream->count = 0;
+	stream->capacity = 0;
+	stream->types = NULL;
+	stream->offsets = NULL;
+	stream->lengths = NULL;
+	return stream;
+}
+
+void token_stream_append(struct token_stream *stream, struct token *token)
+{
+	if (stream->count == stream->capacity) {
+		stream->capacity = MAX(stream->capacity * 2, 1024);
+		stream->types = g_renew(uint8_t, stream->types,
+					stream->capacity);
+		stream->offsets = g_renew(uint32_t, stream->offsets,
+					  stream->capacity);
+		stream->lengths = g_renew(uint32_t, stream->lengths,
+					  stream->capacity);
+	}
+
+	stream->types[stream->count] = token->type;
+	stream->offsets[stream->count] = token->offset;
+	stream->lengths[stream->count] = token->length;
+	stream->count++;
+}
+
+struct token token_stream_get(struct token_stream *stream, uint32_t index)
+{
+	g_assert(index < stream->count);
+	return (struct token){
+		.type = stream->types[index],
+		.offset = stream->offsets[index],
+		.length = stream->lengths[index],
+	};
+}
+
+void token_stream_free(struct token_stream *stream)
+{
+	g_free(stream->types);
+	g_free(stream->offsets);
+	g_free(stream->lengths);
+	g_free(stream);
 }
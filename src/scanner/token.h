@@ -86,19 +86,45 @@ const char *token_type_error_message(enum token_type token_type);
 const char *token_type_regex_pattern(enum token_type token_type);
 
 struct token {
-	enum token_type type;
+	uint8_t type;
 	uint32_t offset;
 	uint32_t length;
+};
+
+// every token of a compilation unit shares its file name and source
+struct token_unit {
 	const char *file_name;
 	const char *source;
 };
 
-uint32_t token_get_line_number(struct token *token);
+// the parser mostly looks at token types only, so each field gets an array
+// of its own
+struct token_stream {
+	struct token_unit unit;
+	uint32_t count;
+	uint32_t capacity;
+	uint8_t *types;
+	uint32_t *offsets;
+	uint32_t *lengths;
+};
+
+uint32_t token_get_line_number(const struct token_unit *unit,
+			       struct token *token);
+
+uint32_t token_get_column_number(const struct token_unit *unit,
+				 struct token *token);
+
+char *token_get_string(const struct token_unit *unit, struct token *token);
+
+void token_print(const struct token_unit *unit, struct token *token);
+
+void token_print_error(const struct token_unit *unit, struct token *token);
 
-uint32_t token_get_column_number(struct token *token);
+struct token_stream *token_stream_new(const char *file_name,
+				      const char *source);
 
-char *token_get_string(struct token *token);
+void token_stream_append(struct token_stream *stream, struct token *token);
 
-void token_print(struct token *token);
+struct token token_stream_get(struct token_stream *stream, uint32_t index);
 
-void token_print_error(struct token *token);
+void token_stream_free(struct token_stream *stream);
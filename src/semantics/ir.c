@@ -1,18 +1,18 @@
 #include "semantics/ir.h"
 
-static struct ast_node *next_node(struct ast_node **nodes)
+static struct ast_node *next_node(struct ast_cursor *nodes)
 {
-	return (*nodes)++;
+	return nodes->node++;
 }
 
-static struct ast_node *peek_node(struct ast_node **nodes)
+static struct ast_node *peek_node(struct ast_cursor *nodes)
 {
-	return *nodes;
+	return nodes->node;
 }
 
-static struct ast_node *last_node(struct ast_node **nodes)
+static struct ast_node *last_node(struct ast_cursor *nodes)
 {
-	return *nodes - 1;
+	return nodes->node - 1;
 }
 
 bool ir_data_type_is_array(enum ir_data_type type)
@@ -20,7 +20,7 @@ bool ir_data_type_is_array(enum ir_data_type type)
 	return type % 2 == 1;
 }
 
-static void iterate_fields(struct ast_node **nodes, GArray *fields)
+static void iterate_fields(struct ast_cursor *nodes, GArray *fields)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_FIELD);
 
@@ -36,7 +36,7 @@ static void iterate_fields(struct ast_node **nodes, GArray *fields)
 	}
 }
 
-struct ir_program *ir_program_new(struct ast_node **nodes)
+struct ir_program *ir_program_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_PROGRAM);
 
@@ -96,7 +96,7 @@ void ir_program_free(struct ir_program *program)
 	g_free(program);
 }
 
-struct ir_method *ir_method_new(struct ast_node **nodes)
+struct ir_method *ir_method_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_METHOD);
 
@@ -120,7 +120,7 @@ struct ir_method *ir_method_new(struct ast_node **nodes)
 	return method;
 }
 
-struct ir_method *ir_method_new_from_import(struct ast_node **nodes)
+struct ir_method *ir_method_new_from_import(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_IMPORT);
 
@@ -149,7 +149,7 @@ void ir_method_free(struct ir_method *method)
 	g_free(method);
 }
 
-struct ir_field *ir_field_new(struct ast_node **nodes, bool constant,
+struct ir_field *ir_field_new(struct ast_cursor *nodes, bool constant,
 			      enum ir_data_type type)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_FIELD_IDENTIFIER);
@@ -179,11 +179,12 @@ struct ir_field *ir_field_new(struct ast_node **nodes, bool constant,
 	return field;
 }
 
-struct ir_field *ir_field_new_from_method_argument(struct ast_node **nodes)
+struct ir_field *ir_field_new_from_method_argument(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_METHOD_ARGUMENT);
 
 	struct ir_field *argument = g_new(struct ir_field, 1);
+	argument->token = last_node(nodes)->token;
 	argument->constant = false;
 	argument->type = ir_data_type_from_ast(nodes);
 	argument->identifier = ir_identifier_from_ast(nodes);
@@ -200,7 +201,7 @@ void ir_field_free(struct ir_field *field)
 	g_free(field);
 }
 
-struct ir_initializer *ir_initializer_new(struct ast_node **nodes)
+struct ir_initializer *ir_initializer_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_INITIALIZER);
 
@@ -232,7 +233,7 @@ void ir_initializer_free(struct ir_initializer *initializer)
 	g_free(initializer);
 }
 
-struct ir_block *ir_block_new(struct ast_node **nodes)
+struct ir_block *ir_block_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_BLOCK);
 
@@ -277,7 +278,7 @@ void ir_block_free(struct ir_block *block)
 	g_free(block);
 }
 
-struct ir_statement *ir_statement_new(struct ast_node **nodes)
+struct ir_statement *ir_statement_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_STATEMENT);
 
@@ -358,7 +359,7 @@ void ir_statement_free(struct ir_statement *statement)
 	g_free(statement);
 }
 
-struct ir_assignment *ir_assignment_new(struct ast_node **nodes)
+struct ir_assignment *ir_assignment_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_ASSIGNMENT);
 
@@ -412,6 +413,7 @@ ir_assignment_new_from_identifier(char *identifier,
 	struct ir_assignment *assignment = g_new(struct ir_assignment, 1);
 	assignment->token = expression->token;
 	assignment->location = g_new(struct ir_location, 1);
+	assignment->location->token = expression->token;
 	assignment->location->identifier = identifier;
 	assignment->location->index = NULL;
 	assignment->assign_operator = IR_ASSIGN_OPERATOR_SET;
@@ -427,7 +429,7 @@ void ir_assignment_free(struct ir_assignment *assignment)
 	g_free(assignment);
 }
 
-struct ir_method_call *ir_method_call_new(struct ast_node **nodes)
+struct ir_method_call *ir_method_call_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_METHOD_CALL);
 
@@ -460,7 +462,7 @@ void ir_method_call_free(struct ir_method_call *call)
 }
 
 struct ir_method_call_argument *
-ir_method_call_argument_new(struct ast_node **nodes)
+ir_method_call_argument_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_METHOD_CALL_ARGUMENT);
 
@@ -496,7 +498,7 @@ void ir_method_call_argument_free(struct ir_method_call_argument *argument)
 	g_free(argument);
 }
 
-struct ir_if_statement *ir_if_statement_new(struct ast_node **nodes)
+struct ir_if_statement *ir_if_statement_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_IF_STATEMENT);
 
@@ -522,7 +524,7 @@ void ir_if_statement_free(struct ir_if_statement *statement)
 	g_free(statement);
 }
 
-struct ir_for_statement *ir_for_statement_new(struct ast_node **nodes)
+struct ir_for_statement *ir_for_statement_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_FOR_STATEMENT);
 
@@ -549,7 +551,7 @@ void ir_for_statement_free(struct ir_for_statement *statement)
 	g_free(statement);
 }
 
-struct ir_for_update *ir_for_update_new(struct ast_node **nodes)
+struct ir_for_update *ir_for_update_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_FOR_UPDATE);
 
@@ -585,7 +587,7 @@ void ir_for_update_free(struct ir_for_update *update)
 	g_free(update);
 }
 
-struct ir_while_statement *ir_while_statement_new(struct ast_node **nodes)
+struct ir_while_statement *ir_while_statement_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_WHILE_STATEMENT);
 
@@ -604,7 +606,7 @@ void ir_while_statement_free(struct ir_while_statement *statement)
 	g_free(statement);
 }
 
-struct ir_location *ir_location_new(struct ast_node **nodes)
+struct ir_location *ir_location_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_LOCATION);
 
@@ -629,7 +631,7 @@ void ir_location_free(struct ir_location *location)
 	g_free(location);
 }
 
-struct ir_expression *ir_expression_new(struct ast_node **nodes)
+struct ir_expression *ir_expression_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_EXPRESSION);
 
@@ -707,7 +709,7 @@ void ir_expression_free(struct ir_expression *expression)
 	g_free(expression);
 }
 
-struct ir_binary_expression *ir_binary_expression_new(struct ast_node **nodes)
+struct ir_binary_expression *ir_binary_expression_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_BINARY_EXPRESSION);
 
@@ -773,7 +775,7 @@ void ir_binary_expression_free(struct ir_binary_expression *expression)
 	g_free(expression);
 }
 
-struct ir_length_expression *ir_length_expression_new(struct ast_node **nodes)
+struct ir_length_expression *ir_length_expression_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_LEN_EXPRESSION);
 
@@ -792,7 +794,7 @@ void ir_length_expression_free(struct ir_length_expression *length_expression)
 	g_free(length_expression);
 }
 
-struct ir_literal *ir_literal_new(struct ast_node **nodes)
+struct ir_literal *ir_literal_new(struct ast_cursor *nodes)
 {
 	g_assert(next_node(nodes)->type == AST_NODE_TYPE_LITERAL);
 
@@ -837,7 +839,7 @@ void ir_literal_free(struct ir_literal *literal)
 	g_free(literal);
 }
 
-enum ir_data_type ir_data_type_from_ast(struct ast_node **nodes)
+enum ir_data_type ir_data_type_from_ast(struct ast_cursor *nodes)
 {
 	struct ast_node *node = next_node(nodes);
 	g_assert(node->type == AST_NODE_TYPE_VOID ||
@@ -868,10 +870,11 @@ static uint64_t character_to_int(char character)
 		return character - '0';
 }
 
-static uint64_t string_to_int(char *string, uint64_t max_value, uint64_t base)
+static uint64_t string_to_int(const char *string, uint64_t length,
+			      uint64_t max_value, uint64_t base)
 {
 	uint64_t value = 0;
-	uint64_t i = strlen(string);
+	uint64_t i = length;
 	uint64_t place = 1;
 
 	while (i-- > 0) {
@@ -896,24 +899,25 @@ static uint64_t string_to_int(char *string, uint64_t max_value, uint64_t base)
 	return value;
 }
 
-uint64_t ir_int_literal_from_ast(struct ast_node **nodes, bool negate)
+uint64_t ir_int_literal_from_ast(struct ast_cursor *nodes, bool negate)
 {
 	struct ast_node *node = next_node(nodes);
 	g_assert(node->type == AST_NODE_TYPE_INT_LITERAL);
 
-	char *source_value = token_get_string(&node->token);
+	// literals are read straight out of the source instead of a copy
+	const char *source_value = nodes->unit->source + node->token.offset;
+	uint64_t length = node->token.length;
 
 	uint64_t max_value = (uint64_t)INT64_MAX + (uint64_t)negate;
 	bool hex = node->token.type == TOKEN_TYPE_HEX_LITERAL;
 
-	uint64_t value = string_to_int(hex ? source_value + 2 : source_value,
-				       max_value, hex ? 16 : 10);
-
-	g_free(source_value);
-	return value;
+	if (hex)
+		return string_to_int(source_value + 2, length - 2, max_value,
+				     16);
+	return string_to_int(source_value, length, max_value, 10);
 }
 
-bool ir_bool_literal_from_ast(struct ast_node **nodes)
+bool ir_bool_literal_from_ast(struct ast_cursor *nodes)
 {
 	struct ast_node *node = next_node(nodes);
 	g_assert(node->type == AST_NODE_TYPE_BOOL_LITERAL);
@@ -929,7 +933,7 @@ bool ir_bool_literal_from_ast(struct ast_node **nodes)
 	return -1;
 }
 
-static char handle_backslash_sequence(char *backlash_sequence)
+static char handle_backslash_sequence(const char *backlash_sequence)
 {
 	g_assert(backlash_sequence[0] == '\\');
 	switch (backlash_sequence[1]) {
@@ -950,34 +954,29 @@ static char handle_backslash_sequence(char *backlash_sequence)
 	return -1;
 }
 
-char ir_char_literal_from_ast(struct ast_node **nodes)
+char ir_char_literal_from_ast(struct ast_cursor *nodes)
 {
 	struct ast_node *node = next_node(nodes);
 	g_assert(node->type == AST_NODE_TYPE_CHAR_LITERAL);
 
-	char *source_value = token_get_string(&node->token);
+	const char *source_value = nodes->unit->source + node->token.offset;
 
-	char value = '\0';
 	if (source_value[1] == '\\')
-		value = handle_backslash_sequence(source_value + 1);
-	else
-		value = source_value[1];
-
-	g_free(source_value);
-	return value;
+		return handle_backslash_sequence(source_value + 1);
+	return source_value[1];
 }
 
-char *ir_string_literal_from_ast(struct ast_node **nodes)
+char *ir_string_literal_from_ast(struct ast_cursor *nodes)
 {
 	struct ast_node *node = next_node(nodes);
 	g_assert(node->type == AST_NODE_TYPE_STRING_LITERAL);
 
-	return token_get_string(&node->token);
+	return token_get_string(nodes->unit, &node->token);
 }
 
-char *ir_identifier_from_ast(struct ast_node **nodes)
+char *ir_identifier_from_ast(struct ast_cursor *nodes)
 {
 	struct ast_node *node = next_node(nodes);
 	g_assert(node->type == AST_NODE_TYPE_IDENTIFIER);
-	return token_get_string(&node->token);
+	return token_get_string(nodes->unit, &node->token);
 }
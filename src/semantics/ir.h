@@ -28,7 +28,7 @@ struct ir_program {
 	GArray *methods;
 };
 
-struct ir_program *ir_program_new(struct ast_node **nodes);
+struct ir_program *ir_program_new(struct ast_cursor *nodes);
 void ir_program_free(struct ir_program *program);
 
 struct ir_method {
@@ -40,8 +40,8 @@ struct ir_method {
 	struct ir_block *block;
 };
 
-struct ir_method *ir_method_new(struct ast_node **nodes);
-struct ir_method *ir_method_new_from_import(struct ast_node **nodes);
+struct ir_method *ir_method_new(struct ast_cursor *nodes);
+struct ir_method *ir_method_new_from_import(struct ast_cursor *nodes);
 void ir_method_free(struct ir_method *method);
 
 struct ir_field {
@@ -53,9 +53,9 @@ struct ir_field {
 	struct ir_initializer *initializer;
 };
 
-struct ir_field *ir_field_new(struct ast_node **nodes, bool constant,
+struct ir_field *ir_field_new(struct ast_cursor *nodes, bool constant,
 			      enum ir_data_type type);
-struct ir_field *ir_field_new_from_method_argument(struct ast_node **nodes);
+struct ir_field *ir_field_new_from_method_argument(struct ast_cursor *nodes);
 void ir_field_free(struct ir_field *field);
 
 struct ir_initializer {
@@ -64,7 +64,7 @@ struct ir_initializer {
 	GArray *literals;
 };
 
-struct ir_initializer *ir_initializer_new(struct ast_node **nodes);
+struct ir_initializer *ir_initializer_new(struct ast_cursor *nodes);
 void ir_initializer_free(struct ir_initializer *initializer);
 
 struct ir_block {
@@ -74,7 +74,7 @@ struct ir_block {
 	GArray *statements;
 };
 
-struct ir_block *ir_block_new(struct ast_node **nodes);
+struct ir_block *ir_block_new(struct ast_cursor *nodes);
 void ir_block_free(struct ir_block *block);
 
 struct ir_statement {
@@ -101,7 +101,7 @@ struct ir_statement {
 	};
 };
 
-struct ir_statement *ir_statement_new(struct ast_node **nodes);
+struct ir_statement *ir_statement_new(struct ast_cursor *nodes);
 void ir_statement_free(struct ir_statement *statement);
 
 struct ir_assignment {
@@ -122,7 +122,7 @@ struct ir_assignment {
 	struct ir_expression *expression;
 };
 
-struct ir_assignment *ir_assignment_new(struct ast_node **nodes);
+struct ir_assignment *ir_assignment_new(struct ast_cursor *nodes);
 struct ir_assignment *
 ir_assignment_new_from_identifier(char *identifier,
 				  struct ir_expression *expression);
@@ -134,7 +134,7 @@ struct ir_method_call {
 	GArray *arguments;
 };
 
-struct ir_method_call *ir_method_call_new(struct ast_node **nodes);
+struct ir_method_call *ir_method_call_new(struct ast_cursor *nodes);
 void ir_method_call_free(struct ir_method_call *method_call);
 
 struct ir_method_call_argument {
@@ -151,7 +151,7 @@ struct ir_method_call_argument {
 };
 
 struct ir_method_call_argument *
-ir_method_call_argument_new(struct ast_node **nodes);
+ir_method_call_argument_new(struct ast_cursor *nodes);
 void ir_method_call_argument_free(struct ir_method_call_argument *argument);
 
 struct ir_if_statement {
@@ -161,7 +161,7 @@ struct ir_if_statement {
 	struct ir_block *else_block;
 };
 
-struct ir_if_statement *ir_if_statement_new(struct ast_node **nodes);
+struct ir_if_statement *ir_if_statement_new(struct ast_cursor *nodes);
 void ir_if_statement_free(struct ir_if_statement *statement);
 
 struct ir_for_statement {
@@ -172,7 +172,7 @@ struct ir_for_statement {
 	struct ir_block *block;
 };
 
-struct ir_for_statement *ir_for_statement_new(struct ast_node **nodes);
+struct ir_for_statement *ir_for_statement_new(struct ast_cursor *nodes);
 void ir_for_statement_free(struct ir_for_statement *statement);
 
 struct ir_for_update {
@@ -188,7 +188,7 @@ struct ir_for_update {
 	};
 };
 
-struct ir_for_update *ir_for_update_new(struct ast_node **nodes);
+struct ir_for_update *ir_for_update_new(struct ast_cursor *nodes);
 void ir_for_update_free(struct ir_for_update *update);
 
 struct ir_while_statement {
@@ -197,7 +197,7 @@ struct ir_while_statement {
 	struct ir_block *block;
 };
 
-struct ir_while_statement *ir_while_statement_new(struct ast_node **nodes);
+struct ir_while_statement *ir_while_statement_new(struct ast_cursor *nodes);
 void ir_while_statement_free(struct ir_while_statement *statement);
 
 struct ir_location {
@@ -206,7 +206,7 @@ struct ir_location {
 	struct ir_expression *index;
 };
 
-struct ir_location *ir_location_new(struct ast_node **nodes);
+struct ir_location *ir_location_new(struct ast_cursor *nodes);
 void ir_location_free(struct ir_location *location);
 
 struct ir_expression {
@@ -233,7 +233,7 @@ struct ir_expression {
 	};
 };
 
-struct ir_expression *ir_expression_new(struct ast_node **nodes);
+struct ir_expression *ir_expression_new(struct ast_cursor *nodes);
 void ir_expression_free(struct ir_expression *expression);
 
 struct ir_binary_expression {
@@ -259,7 +259,7 @@ struct ir_binary_expression {
 	struct ir_expression *right;
 };
 
-struct ir_binary_expression *ir_binary_expression_new(struct ast_node **nodes);
+struct ir_binary_expression *ir_binary_expression_new(struct ast_cursor *nodes);
 void ir_binary_expression_free(struct ir_binary_expression *expression);
 
 struct ir_length_expression {
@@ -267,7 +267,7 @@ struct ir_length_expression {
 	int64_t length;
 };
 
-struct ir_length_expression *ir_length_expression_new(struct ast_node **nodes);
+struct ir_length_expression *ir_length_expression_new(struct ast_cursor *nodes);
 void ir_length_expression_free(struct ir_length_expression *length_expression);
 
 struct ir_literal {
@@ -283,17 +283,17 @@ struct ir_literal {
 	uint64_t value;
 };
 
-struct ir_literal *ir_literal_new(struct ast_node **nodes);
+struct ir_literal *ir_literal_new(struct ast_cursor *nodes);
 void ir_literal_free(struct ir_literal *literal);
 
-enum ir_data_type ir_data_type_from_ast(struct ast_node **nodes);
+enum ir_data_type ir_data_type_from_ast(struct ast_cursor *nodes);
 
-uint64_t ir_int_literal_from_ast(struct ast_node **nodes, bool negate);
+uint64_t ir_int_literal_from_ast(struct ast_cursor *nodes, bool negate);
 
-bool ir_bool_literal_from_ast(struct ast_node **nodes);
+bool ir_bool_literal_from_ast(struct ast_cursor *nodes);
 
-char ir_char_literal_from_ast(struct ast_node **nodes);
+char ir_char_literal_from_ast(struct ast_cursor *nodes);
 
-char *ir_string_literal_from_ast(struct ast_node **nodes);
+char *ir_string_literal_from_ast(struct ast_cursor *nodes);
 
-char *ir_identifier_from_ast(struct ast_node **nodes);
+char *ir_identifier_from_ast(struct ast_cursor *nodes);
@@ -1,12 +1,15 @@
 #include "semantics/semantics.h"
 #include "semantics/ir.h"
+#include "time_report.h"
 
 #define semantic_error(semantics, token, ...)                               \
 	do {                                                                \
+		const struct token_unit *unit = semantics->unit;            \
 		semantics->error = true;                                    \
-		uint32_t line_number = token_get_line_number(&token);       \
-		uint32_t column_number = token_get_column_number(&token);   \
-		g_printerr("SEMANTIC-ERROR at %s:%i:%i: ", token.file_name, \
+		uint32_t line_number = token_get_line_number(unit, &token); \
+		uint32_t column_number =                                    \
+			token_get_column_number(unit, &token);              \
+		g_printerr("SEMANTIC-ERROR at %s:%i:%i: ", unit->file_name, \
 			   line_number, column_number);                     \
 		g_printerr(__VA_ARGS__);                                    \
 		g_printerr("\n");                                           \
@@ -112,7 +115,7 @@ static enum ir_data_type analyze_literal(struct semantics *semantics,
 			semantic_error(semantics, literal->token,
 				       "Overflow in int literal '%.*s'",
 				       literal->token.length,
-				       literal->token.source);
+				       semantics->unit->source);
 	}
 
 	switch (literal->type) {
@@ -703,19 +706,28 @@ struct semantics *semantics_new(void)
 	return semantics;
 }
 
-int semantics_analyze(struct semantics *semantics, struct ast_node *ast,
+int semantics_analyze(struct semantics *semantics,
+		      const struct token_unit *unit, struct ast_node *ast,
 		      struct ir_program **ir)
 {
+	semantics->unit = unit;
+
+	time_report_begin("linearize", NULL);
 	struct ast_node *linear_nodes = ast_node_linearize(ast);
-	struct ir_program *program =
-		ir_program_new(&(struct ast_node *){ linear_nodes });
+	struct ir_program *program = ir_program_new(&(struct ast_cursor){
+		.node = linear_nodes,
+		.unit = unit,
+	});
 	g_free(linear_nodes);
+	time_report_end();
 
 	semantics->error = false;
 	semantics->methods_table = program->methods_table;
 	semantics->current_method = NULL;
 	semantics->loop_depth = 0;
+	time_report_begin("semantics", NULL);
 	analyze_program(semantics, program);
+	time_report_end();
 
 	if (semantics->error || ir == NULL)
 		ir_program_free(program);
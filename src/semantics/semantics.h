@@ -4,6 +4,7 @@
 #include "parser/ast.h"
 
 struct semantics {
+	const struct token_unit *unit;
 	bool error;
 	GArray *fields_table_stack;
 	methods_table_t *methods_table;
@@ -13,7 +14,8 @@ struct semantics {
 
 struct semantics *semantics_new(void);
 
-int semantics_analyze(struct semantics *semantics, struct ast_node *ast,
+int semantics_analyze(struct semantics *semantics,
+		      const struct token_unit *unit, struct ast_node *ast,
 		      struct ir_program **ir);
 
 void semantics_free(struct semantics *semantics);
@@ -0,0 +1,489 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "server.h"
+
+#define SERVER_BACKLOG 64
+#define MAX_REQUEST_LENGTH (1 << 20)
+#define FORWARDED_DESCRIPTORS 3
+#define RECEIVE_TIMEOUT_SECONDS 10
+
+// a request is its header, carrying the client's stdin, stdout and stderr,
+// followed by the working directory and arguments separated by '\0'
+struct request_header {
+	uint32_t length;
+};
+
+struct request {
+	int descriptors[FORWARDED_DESCRIPTORS];
+	char *payload;
+	char *directory;
+	int argc;
+	char **argv;
+};
+
+static int signal_pipe[2] = { -1, -1 };
+
+static void notify_signal(int signal_number)
+{
+	int saved_errno = errno;
+	char byte = (char)signal_number;
+	if (write(signal_pipe[1], &byte, 1) < 0) {
+		// the pipe is full, the loop is woken up anyway
+	}
+	errno = saved_errno;
+}
+
+static bool write_all(int descriptor, const void *data, size_t length)
+{
+	const char *bytes = data;
+	while (length > 0) {
+		ssize_t written = write(descriptor, bytes, length);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+
+		bytes += written;
+		length -= written;
+	}
+
+	return true;
+}
+
+static bool read_all(int descriptor, void *data, size_t length)
+{
+	char *bytes = data;
+	while (length > 0) {
+		ssize_t count = read(descriptor, bytes, length);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+
+		bytes += count;
+		length -= count;
+	}
+
+	return true;
+}
+
+static struct sockaddr_un socket_address(const char *socket_path)
+{
+	struct sockaddr_un address = { 0 };
+	address.sun_family = AF_UNIX;
+	g_strlcpy(address.sun_path, socket_path, sizeof(address.sun_path));
+	return address;
+}
+
+static int connect_to(const char *socket_path)
+{
+	struct sockaddr_un address = socket_address(socket_path);
+	if (strlen(socket_path) >= sizeof(address.sun_path))
+		return -1;
+
+	int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connection < 0)
+		return -1;
+
+	if (connect(connection, (struct sockaddr *)&address,
+		    sizeof(address)) != 0) {
+		close(connection);
+		return -1;
+	}
+
+	return connection;
+}
+
+// a socket left behind by a server that did not shut down cleanly would make
+// bind fail, but a live server's socket or any other file is left alone
+static int remove_stale_socket(const char *socket_path)
+{
+	struct stat status;
+	if (lstat(socket_path, &status) != 0)
+		return 0;
+
+	if (!S_ISSOCK(status.st_mode)) {
+		g_printerr("%s exists and is not a socket\n", socket_path);
+		return -1;
+	}
+
+	int connection = connect_to(socket_path);
+	if (connection >= 0) {
+		close(connection);
+		g_printerr("A server is already listening on %s\n",
+			   socket_path);
+		return -1;
+	}
+
+	unlink(socket_path);
+	return 0;
+}
+
+static int listen_on(const char *socket_path)
+{
+	struct sockaddr_un address = socket_address(socket_path);
+	if (strlen(socket_path) >= sizeof(address.sun_path)) {
+		g_printerr("Socket path %s is too long\n", socket_path);
+		return -1;
+	}
+
+	if (remove_stale_socket(socket_path) != 0)
+		return -1;
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		g_printerr("Failed to create socket: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+	    listen(listener, SERVER_BACKLOG) != 0) {
+		g_printerr("Failed to listen on %s: %s\n", socket_path,
+			   strerror(errno));
+		close(listener);
+		return -1;
+	}
+
+	fcntl(listener, F_SETFD, FD_CLOEXEC);
+	return listener;
+}
+
+static void set_signal_handler(int signal_number, void (*handler)(int))
+{
+	struct sigaction action = { 0 };
+	action.sa_handler = handler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(signal_number, &action, NULL);
+}
+
+static int parse_payload(struct request *request, uint32_t length)
+{
+	if (length == 0 || request->payload[length - 1] != '\0')
+		return -1;
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < length; i++) {
+		if (request->payload[i] == '\0')
+			count++;
+	}
+
+	// the directory and at least argv[0]
+	if (count < 2)
+		return -1;
+
+	request->directory = request->payload;
+	request->argc = count - 1;
+	request->argv = g_new(char *, request->argc + 1);
+
+	char *argument = request->payload + strlen(request->payload) + 1;
+	for (int i = 0; i < request->argc; i++) {
+		request->argv[i] = argument;
+		argument += strlen(argument) + 1;
+	}
+	request->argv[request->argc] = NULL;
+
+	return 0;
+}
+
+static int receive_request(int connection, struct request *request)
+{
+	*request = (struct request){ .descriptors = { -1, -1, -1 } };
+
+	struct request_header header;
+	struct iovec vector = {
+		.iov_base = &header,
+		.iov_len = sizeof(header),
+	};
+	union {
+		char buffer[CMSG_SPACE(sizeof(int) * FORWARDED_DESCRIPTORS)];
+		struct cmsghdr align;
+	} control;
+	struct msghdr message = {
+		.msg_iov = &vector,
+		.msg_iovlen = 1,
+		.msg_control = control.buffer,
+		.msg_controllen = sizeof(control.buffer),
+	};
+
+	if (recvmsg(connection, &message, 0) != sizeof(header))
+		return -1;
+
+	struct cmsghdr *descriptors = CMSG_FIRSTHDR(&message);
+	if (descriptors == NULL || descriptors->cmsg_level != SOL_SOCKET ||
+	    descriptors->cmsg_type != SCM_RIGHTS ||
+	    descriptors->cmsg_len !=
+		    CMSG_LEN(sizeof(int) * FORWARDED_DESCRIPTORS))
+		return -1;
+	memcpy(request->descriptors, CMSG_DATA(descriptors),
+	       sizeof(request->descriptors));
+
+	if (header.length > MAX_REQUEST_LENGTH)
+		return -1;
+
+	request->payload = g_malloc(header.length + 1);
+	if (!read_all(connection, request->payload, header.length))
+		return -1;
+
+	return parse_payload(request, header.length);
+}
+
+static void serve_request(int connection, server_main_t main_function)
+{
+	// the child becomes the client's roast process: its streams, its
+	// working directory and its arguments
+	set_signal_handler(SIGCHLD, SIG_DFL);
+	set_signal_handler(SIGINT, SIG_DFL);
+	set_signal_handler(SIGTERM, SIG_DFL);
+	set_signal_handler(SIGPIPE, SIG_DFL);
+	close(signal_pipe[0]);
+	close(signal_pipe[1]);
+
+	// a client that connects and never sends only holds up its own child
+	struct timeval timeout = { .tv_sec = RECEIVE_TIMEOUT_SECONDS };
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+		   sizeof(timeout));
+
+	struct request request;
+	if (receive_request(connection, &request) != 0)
+		_exit(255);
+	close(connection);
+
+	for (int i = 0; i < FORWARDED_DESCRIPTORS; i++) {
+		dup2(request.descriptors[i], i);
+		close(request.descriptors[i]);
+	}
+
+	if (chdir(request.directory) != 0) {
+		g_printerr("Failed to change to %s: %s\n", request.directory,
+			   strerror(errno));
+		_exit(255);
+	}
+
+	exit(main_function(request.argc, request.argv));
+}
+
+// requests run with the server's permissions and can write any -o path, so
+// only the user running the server may send them
+static bool is_own_user(int connection)
+{
+#ifdef SO_PEERCRED
+	struct ucred credentials;
+	socklen_t length = sizeof(credentials);
+	if (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials,
+		       &length) != 0)
+		return false;
+	uid_t uid = credentials.uid;
+#else
+	uid_t uid;
+	gid_t gid;
+	if (getpeereid(connection, &uid, &gid) != 0)
+		return false;
+#endif
+
+	return uid == geteuid();
+}
+
+static void accept_request(int listener, GHashTable *clients,
+			   server_main_t main_function)
+{
+	int connection = accept(listener, NULL, NULL);
+	if (connection < 0)
+		return;
+	fcntl(connection, F_SETFD, FD_CLOEXEC);
+
+	if (!is_own_user(connection)) {
+		g_printerr("Rejected a request from another user\n");
+		close(connection);
+		return;
+	}
+
+	// the warm state lives in this process, every request gets a copy
+	// of it for the price of a fork, and the child reads the request so
+	// the loop never waits on a client
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(listener);
+		serve_request(connection, main_function);
+	}
+
+	if (pid < 0) {
+		close(connection);
+		return;
+	}
+
+	g_hash_table_insert(clients, GINT_TO_POINTER(pid),
+			    GINT_TO_POINTER(connection));
+}
+
+static int32_t exit_status(int status)
+{
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+
+	// the convention of the shell for a process killed by a signal
+	return 128 + WTERMSIG(status);
+}
+
+static void reap_children(GHashTable *clients, bool block)
+{
+	int status;
+	pid_t pid;
+
+	while (g_hash_table_size(clients) > 0 &&
+	       (pid = waitpid(-1, &status, block ? 0 : WNOHANG)) > 0) {
+		gpointer connection;
+		if (!g_hash_table_lookup_extended(clients, GINT_TO_POINTER(pid),
+						  NULL, &connection))
+			continue;
+
+		int32_t result = exit_status(status);
+		write_all(GPOINTER_TO_INT(connection), &result, sizeof(result));
+		close(GPOINTER_TO_INT(connection));
+		g_hash_table_remove(clients, GINT_TO_POINTER(pid));
+	}
+}
+
+static bool handle_signals(GHashTable *clients)
+{
+	bool running = true;
+	char signals[64];
+	ssize_t count;
+
+	while ((count = read(signal_pipe[0], signals, sizeof(signals))) > 0) {
+		for (ssize_t i = 0; i < count; i++) {
+			if (signals[i] == SIGINT || signals[i] == SIGTERM)
+				running = false;
+		}
+	}
+
+	reap_children(clients, false);
+	return running;
+}
+
+int server_run(const char *socket_path, server_main_t main_function)
+{
+	int listener = listen_on(socket_path);
+	if (listener < 0)
+		return -1;
+
+	if (pipe(signal_pipe) != 0) {
+		g_printerr("Failed to create pipe: %s\n", strerror(errno));
+		close(listener);
+		unlink(socket_path);
+		return -1;
+	}
+	for (uint32_t i = 0; i < 2; i++) {
+		fcntl(signal_pipe[i], F_SETFL, O_NONBLOCK);
+		fcntl(signal_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	set_signal_handler(SIGCHLD, notify_signal);
+	set_signal_handler(SIGINT, notify_signal);
+	set_signal_handler(SIGTERM, notify_signal);
+	set_signal_handler(SIGPIPE, SIG_IGN);
+
+	GHashTable *clients = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_printerr("Listening on %s\n", socket_path);
+
+	bool running = true;
+	while (running) {
+		struct pollfd descriptors[2] = {
+			{ .fd = listener, .events = POLLIN },
+			{ .fd = signal_pipe[0], .events = POLLIN },
+		};
+		if (poll(descriptors, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (descriptors[1].revents & POLLIN)
+			running = handle_signals(clients);
+		if (running && descriptors[0].revents & POLLIN)
+			accept_request(listener, clients, main_function);
+	}
+
+	// requests already running still get their answer
+	close(listener);
+	unlink(socket_path);
+	reap_children(clients, true);
+
+	g_hash_table_unref(clients);
+	close(signal_pipe[0]);
+	close(signal_pipe[1]);
+	return 0;
+}
+
+static bool send_request(int connection, GString *payload)
+{
+	struct request_header header = { .length = payload->len };
+	struct iovec vector = {
+		.iov_base = &header,
+		.iov_len = sizeof(header),
+	};
+	int descriptors[FORWARDED_DESCRIPTORS] = { STDIN_FILENO, STDOUT_FILENO,
+						   STDERR_FILENO };
+	union {
+		char buffer[CMSG_SPACE(sizeof(descriptors))];
+		struct cmsghdr align;
+	} control;
+	struct msghdr message = {
+		.msg_iov = &vector,
+		.msg_iovlen = 1,
+		.msg_control = control.buffer,
+		.msg_controllen = sizeof(control.buffer),
+	};
+
+	struct cmsghdr *rights = CMSG_FIRSTHDR(&message);
+	rights->cmsg_level = SOL_SOCKET;
+	rights->cmsg_type = SCM_RIGHTS;
+	rights->cmsg_len = CMSG_LEN(sizeof(descriptors));
+	memcpy(CMSG_DATA(rights), descriptors, sizeof(descriptors));
+
+	return sendmsg(connection, &message, 0) == sizeof(header) &&
+	       write_all(connection, payload->str, payload->len);
+}
+
+bool server_forward(const char *socket_path, int argc, char **argv,
+		    int *result)
+{
+	int connection = connect_to(socket_path);
+	if (connection < 0)
+		return false;
+
+	char *directory = g_get_current_dir();
+	GString *payload = g_string_new(NULL);
+	g_string_append_len(payload, directory, strlen(directory) + 1);
+	for (int i = 0; i < argc; i++)
+		g_string_append_len(payload, argv[i], strlen(argv[i]) + 1);
+	g_free(directory);
+
+	bool sent = send_request(connection, payload);
+	g_string_free(payload, true);
+	if (!sent) {
+		close(connection);
+		return false;
+	}
+
+	// once the request is out the server owns the compile, so losing the
+	// connection afterwards is a failure rather than a reason to retry
+	int32_t status;
+	*result = read_all(connection, &status, sizeof(status)) ? status : 255;
+	close(connection);
+	return true;
+}
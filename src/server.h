@@ -0,0 +1,10 @@
+#pragma once
+#include <stdbool.h>
+#include <glib.h>
+
+typedef int (*server_main_t)(int argc, char **argv);
+
+int server_run(const char *socket_path, server_main_t main_function);
+
+bool server_forward(const char *socket_path, int argc, char **argv,
+		    int *result);
@@ -0,0 +1,325 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "time_report.h"
+
+#define TIME_REPORT_MAX_DEPTH 32
+
+struct time_event {
+	char *name;
+	char *method;
+	uint32_t depth;
+	uint32_t thread;
+	int64_t start;
+	int64_t wall_time;
+	int64_t cpu_time;
+	uint64_t allocations;
+	int64_t peak_rss;
+};
+
+struct time_row {
+	char *name;
+	uint32_t depth;
+	int64_t wall_time;
+	int64_t cpu_time;
+	uint64_t allocations;
+	int64_t peak_rss;
+	GArray *methods;
+};
+
+static GArray *events = NULL;
+static GMutex events_lock;
+static int64_t report_start = 0;
+static bool report_per_method = false;
+static bool counting_allocations = false;
+static uint64_t allocation_count = 0;
+static uint32_t report_depth = 0;
+static uint32_t thread_counter = 0;
+
+static _Thread_local bool reporting_thread = false;
+static _Thread_local uint32_t thread_id = 0;
+static _Thread_local uint32_t open_events[TIME_REPORT_MAX_DEPTH];
+static _Thread_local uint32_t open_count = 0;
+
+// allocations are counted by replacing malloc, which only glibc allows
+// without patching the allocator, elsewhere the column is left blank
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define TIME_REPORT_ALLOCATIONS
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+// the shared counter is only touched once a report is enabled
+static inline void count_allocation(void)
+{
+	if (__atomic_load_n(&counting_allocations, __ATOMIC_RELAXED))
+		__atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+	count_allocation();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	count_allocation();
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+	count_allocation();
+	return __libc_realloc(pointer, size);
+}
+#endif
+
+static int64_t cpu_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+	return (int64_t)time.tv_sec * G_USEC_PER_SEC + time.tv_nsec / 1000;
+}
+
+static int64_t peak_rss(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+void time_report_enable(bool per_method)
+{
+	if (events == NULL) {
+		events = g_array_new(false, false, sizeof(struct time_event));
+		report_start = g_get_monotonic_time();
+		reporting_thread = true;
+		thread_id = __atomic_add_fetch(&thread_counter, 1,
+					       __ATOMIC_RELAXED);
+		__atomic_store_n(&counting_allocations, true,
+				 __ATOMIC_RELAXED);
+	}
+
+	report_per_method |= per_method;
+}
+
+void time_report_begin(const char *name, const char *method)
+{
+	if (events == NULL)
+		return;
+
+	if (thread_id == 0)
+		thread_id = __atomic_add_fetch(&thread_counter, 1,
+					       __ATOMIC_RELAXED);
+
+	// worker threads nest their events under whatever the thread that
+	// enabled the report has open while it waits for them
+	uint32_t depth = open_count;
+	if (!reporting_thread)
+		depth += __atomic_load_n(&report_depth, __ATOMIC_RELAXED);
+
+	g_assert(open_count < TIME_REPORT_MAX_DEPTH);
+	struct time_event event = {
+		.name = g_strdup(name),
+		.method = g_strdup(method),
+		.depth = depth,
+		.thread = thread_id,
+		.start = g_get_monotonic_time(),
+		.cpu_time = cpu_time(),
+		.allocations =
+			__atomic_load_n(&allocation_count, __ATOMIC_RELAXED),
+		.peak_rss = peak_rss(),
+	};
+
+	g_mutex_lock(&events_lock);
+	g_array_append_val(events, event);
+	open_events[open_count++] = events->len - 1;
+	g_mutex_unlock(&events_lock);
+
+	if (reporting_thread)
+		__atomic_store_n(&report_depth, open_count, __ATOMIC_RELAXED);
+}
+
+void time_report_end(void)
+{
+	if (events == NULL)
+		return;
+
+	g_assert(open_count > 0);
+	uint32_t index = open_events[--open_count];
+	if (reporting_thread)
+		__atomic_store_n(&report_depth, open_count, __ATOMIC_RELAXED);
+
+	int64_t end = g_get_monotonic_time();
+	int64_t end_cpu_time = cpu_time();
+	uint64_t end_allocations =
+		__atomic_load_n(&allocation_count, __ATOMIC_RELAXED);
+	int64_t end_peak_rss = peak_rss();
+
+	g_mutex_lock(&events_lock);
+	struct time_event *event =
+		&g_array_index(events, struct time_event, index);
+	event->wall_time = end - event->start;
+	event->cpu_time = end_cpu_time - event->cpu_time;
+	event->allocations = end_allocations - event->allocations;
+	event->peak_rss = end_peak_rss - event->peak_rss;
+	g_mutex_unlock(&events_lock);
+}
+
+static void add_to_row(struct time_row *row, struct time_event *event)
+{
+	row->wall_time += event->wall_time;
+	row->cpu_time += event->cpu_time;
+	row->allocations += event->allocations;
+	row->peak_rss += event->peak_rss;
+}
+
+static struct time_row *find_row(GArray *rows, char *name, uint32_t depth)
+{
+	for (uint32_t i = rows->len; i-- > 0;) {
+		struct time_row *row = &g_array_index(rows, struct time_row, i);
+		if (row->depth < depth)
+			break;
+		if (row->depth == depth && g_strcmp0(row->name, name) == 0)
+			return row;
+	}
+
+	struct time_row row = {
+		.name = name,
+		.depth = depth,
+		.methods = g_array_new(false, true, sizeof(struct time_row)),
+	};
+	g_array_append_val(rows, row);
+	return &g_array_index(rows, struct time_row, rows->len - 1);
+}
+
+static GArray *collect_rows(void)
+{
+	GArray *rows = g_array_new(false, true, sizeof(struct time_row));
+
+	for (uint32_t i = 0; i < events->len; i++) {
+		struct time_event *event =
+			&g_array_index(events, struct time_event, i);
+		struct time_row *row = find_row(rows, event->name, event->depth);
+		add_to_row(row, event);
+
+		if (event->method != NULL)
+			add_to_row(find_row(row->methods, event->method, 0),
+				   event);
+	}
+
+	return rows;
+}
+
+static void print_row(int64_t wall_time, int64_t cpu_time,
+		      uint64_t allocations, int64_t peak_rss, uint32_t indent,
+		      const char *name)
+{
+	char allocations_column[21] = "";
+#ifdef TIME_REPORT_ALLOCATIONS
+	snprintf(allocations_column, sizeof(allocations_column), "%llu",
+		 (unsigned long long)allocations);
+#endif
+
+	g_printerr("%11.3f %11.3f %12s %10lld   %*s%s\n", wall_time / 1000.0,
+		   cpu_time / 1000.0, allocations_column, (long long)peak_rss,
+		   2 * indent, "", name);
+}
+
+static void print_time_row(struct time_row *row, uint32_t indent)
+{
+	print_row(row->wall_time, row->cpu_time, row->allocations,
+		  row->peak_rss, indent, row->name);
+}
+
+void time_report_print(void)
+{
+	if (events == NULL)
+		return;
+
+	GArray *rows = collect_rows();
+
+	g_printerr("  Wall (ms)    CPU (ms)       Allocs   RSS (KB)   Phase\n");
+	for (uint32_t i = 0; i < rows->len; i++) {
+		struct time_row *row = &g_array_index(rows, struct time_row, i);
+		print_time_row(row, row->depth);
+
+		for (uint32_t j = 0; report_per_method && j < row->methods->len;
+		     j++)
+			print_time_row(&g_array_index(row->methods,
+						      struct time_row, j),
+				       row->depth + 1);
+
+		g_array_free(row->methods, true);
+	}
+
+	print_row(g_get_monotonic_time() - report_start, cpu_time(),
+		  __atomic_load_n(&allocation_count, __ATOMIC_RELAXED),
+		  peak_rss(), 0, "total");
+
+	g_array_free(rows, true);
+}
+
+int time_report_write_trace(const char *file_name)
+{
+	if (events == NULL)
+		return 0;
+
+	FILE *file = fopen(file_name, "w");
+	if (file == NULL) {
+		g_printerr("Failed to open trace file %s\n", file_name);
+		return -1;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	for (uint32_t i = 0; i < events->len; i++) {
+		struct time_event *event =
+			&g_array_index(events, struct time_event, i);
+
+		fprintf(file,
+			"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld,\"args\":{",
+			event->name, event->method != NULL ? "method" : "phase",
+			event->thread,
+			(long long)(event->start - report_start),
+			(long long)event->wall_time);
+		if (event->method != NULL)
+			fprintf(file, "\"method\":\"%s\",", event->method);
+#ifdef TIME_REPORT_ALLOCATIONS
+		fprintf(file, "\"allocations\":%llu,",
+			(unsigned long long)event->allocations);
+#endif
+		fprintf(file, "\"cpu_us\":%lld,\"peak_rss_kb\":%lld}}%s\n",
+			(long long)event->cpu_time, (long long)event->peak_rss,
+			i + 1 < events->len ? "," : "");
+	}
+	fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+
+	fclose(file);
+	return 0;
+}
+
+void time_report_free(void)
+{
+	if (events == NULL)
+		return;
+
+	for (uint32_t i = 0; i < events->len; i++) {
+		struct time_event *event =
+			&g_array_index(events, struct time_event, i);
+		g_free(event->name);
+		g_free(event->method);
+	}
+
+	g_array_free(events, true);
+	events = NULL;
+	open_count = 0;
+	__atomic_store_n(&counting_allocations, false, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <glib.h>
+
+void time_report_enable(bool per_method);
+
+void time_report_begin(const char *name, const char *method);
+void time_report_end(void);
+
+void time_report_print(void);
+int time_report_write_trace(const char *file_name);
+void time_report_free(void);
@@ -25,6 +25,12 @@ if [ $? -ne 0 ]; then
     exit 1
 fi
 
+if [ "$(uname)" = "Darwin" ]; then
+    link_flags="-arch x86_64"
+else
+    link_flags="-no-pie"
+fi
+
 for stage_dir in "./tests/"{"scan","parse","inter","assembly"}"/"; do
     stage_name=$(basename "$stage_dir")
     echo "Testing stage: $stage_name"
@@ -47,7 +53,7 @@ for stage_dir in "./tests/"{"scan","parse","inter","assembly"}"/"; do
                 executables_dir=./bin/"${build_system}"_"${compiler}"/executables
                 mkdir -p "${executables_dir}"
                 exectuable_file="${executables_dir}"/"$(basename "${test_file%????}")"
-                gcc -g -arch x86_64 -O0 "${assembly_file}" -o "${exectuable_file}"
+                gcc -g ${link_flags} -O0 -x assembler "${assembly_file}" -o "${exectuable_file}"
 
                 chmod +x "${exectuable_file}"
 
@@ -98,3 +104,165 @@ for stage_dir in "./tests/"{"scan","parse","inter","assembly"}"/"; do
         break
     fi
 done
+
+if [ "${stage}" != "all" ]; then
+    exit 0
+fi
+
+# Every mode below compiles the assembly tests that are expected to succeed
+# another way and checks that the programs still print the expected outputs.
+bin_dir=./bin/"${build_system}"_"${compiler}"
+modes_dir="${bin_dir}"/modes
+
+# link_and_compare <assembly file> <test file>
+link_and_compare() {
+    executable_file="${1%.*}"
+    gcc -g ${link_flags} -O0 -x assembler "$1" -o "${executable_file}" 2>/dev/null || return 1
+    "${executable_file}" > "${executable_file}".out
+    diff "${executable_file}".out ./tests/assembly/succeed_outputs/"$(basename "$2")".out > /dev/null
+}
+
+# report_test <test file> <status>
+report_test() {
+    if [ "$2" -eq 0 ]; then
+        echo "     Running test: $1 - passed!"
+    else
+        echo "     Running test: $1 - didn't pass!"
+    fi
+}
+
+# test_flags_mode <mode> <roast flags>
+test_flags_mode() {
+    echo "Testing mode: $1"
+    mode_dir="${modes_dir}"/"$1"
+    mkdir -p "${mode_dir}"
+    for test_file in ./tests/assembly/succeed/*; do
+        assembly_file="${mode_dir}"/"$(basename "${test_file%????}")".s
+        "${bin_dir}"/roast "$test_file" -t assembly $2 -o "${assembly_file}" 2>/dev/null &&
+            link_and_compare "${assembly_file}" "$test_file"
+        report_test "$test_file" $?
+    done
+}
+
+# The instrumented program has to print the expected output while it records
+# its block counts, and so does the program compiled with them.
+echo "Testing mode: profile"
+mode_dir="${modes_dir}"/profile
+mkdir -p "${mode_dir}"
+for test_file in ./tests/assembly/succeed/*; do
+    name=$(basename "${test_file%????}")
+    profile_file="${mode_dir}"/"${name}".profile
+    rm -f "${profile_file}"
+
+    "${bin_dir}"/roast "$test_file" -t assembly -O all -fprofile-generate="${profile_file}" -o "${mode_dir}"/"${name}".instrumented.s 2>/dev/null &&
+        link_and_compare "${mode_dir}"/"${name}".instrumented.s "$test_file" &&
+        "${bin_dir}"/roast "$test_file" -t assembly -O all -fprofile-use="${profile_file}" -o "${mode_dir}"/"${name}".s 2>/dev/null &&
+        link_and_compare "${mode_dir}"/"${name}".s "$test_file"
+    report_test "$test_file" $?
+done
+
+# profile-01 loops 100 times, which its counts should turn into a larger
+# unroll factor that -d reports.
+"${bin_dir}"/roast ./tests/assembly/succeed/profile-01.dcf -t assembly -O all -fprofile-use="${mode_dir}"/profile-01.profile -d 2>/dev/null | grep -q "^profile: unrolling"
+report_test "./tests/assembly/succeed/profile-01.dcf -d" $?
+
+# Methods are optimized and generated on four workers, in whatever order they
+# finish, and still have to be emitted in source order.
+test_flags_mode jobs "-O all -j 4"
+
+# One roast compiles every test on four workers into a single directory.
+echo "Testing mode: batch"
+mode_dir="${modes_dir}"/batch
+rm -rf "${mode_dir}"
+mkdir -p "${mode_dir}"
+"${bin_dir}"/roast ./tests/assembly/succeed/* -t assembly -O all -j 4 --output-dir="${mode_dir}" 2>/dev/null
+batch_status=$?
+for test_file in ./tests/assembly/succeed/*; do
+    [ ${batch_status} -eq 0 ] &&
+        link_and_compare "${mode_dir}"/"$(basename "${test_file%????}")".s "$test_file"
+    report_test "$test_file" $?
+done
+
+# Every test is compiled cold against a fresh cache, again to hit its file
+# entry, and once more with a comment appended, which misses the file but
+# reuses the assembly of every method.
+echo "Testing mode: cache"
+mode_dir="${modes_dir}"/cache
+rm -rf "${mode_dir}"
+mkdir -p "${mode_dir}"
+cache_flags="-t assembly -O all --cache-dir=${mode_dir}/cache --cache-stats"
+for test_file in ./tests/assembly/succeed/*; do
+    name=$(basename "${test_file%????}")
+    edited_file="${mode_dir}"/"${name}".dcf
+    { cat "$test_file"; printf '\n// edited\n'; } > "${edited_file}"
+
+    stats=$("${bin_dir}"/roast "$test_file" ${cache_flags} -o "${mode_dir}"/"${name}".cold.s 2>&1) &&
+        echo "${stats}" | grep -Eq "^run files +0 +1 " &&
+        link_and_compare "${mode_dir}"/"${name}".cold.s "$test_file" &&
+        stats=$("${bin_dir}"/roast "$test_file" ${cache_flags} -o "${mode_dir}"/"${name}".warm.s 2>&1) &&
+        echo "${stats}" | grep -Eq "^run files +1 +0 " &&
+        link_and_compare "${mode_dir}"/"${name}".warm.s "$test_file" &&
+        stats=$("${bin_dir}"/roast "${edited_file}" ${cache_flags} -o "${mode_dir}"/"${name}".edited.s 2>&1) &&
+        echo "${stats}" | grep -Eq "^run files +0 +1 " &&
+        echo "${stats}" | grep -Eq "^run methods +[0-9]+ +0 " &&
+        link_and_compare "${mode_dir}"/"${name}".edited.s "$test_file"
+    report_test "$test_file" $?
+done
+
+# A warm server compiles every test that --connect hands it. The server has
+# to be listening before the first request, since --connect falls back to
+# compiling locally, and still running after the last.
+echo "Testing mode: server"
+mode_dir="${modes_dir}"/server
+rm -rf "${mode_dir}"
+mkdir -p "${mode_dir}"
+socket_file="${mode_dir}"/roast.sock
+"${bin_dir}"/roast --server="${socket_file}" 2>/dev/null &
+server_pid=$!
+tries=0
+while [ ! -S "${socket_file}" ] && [ ${tries} -lt 50 ]; do
+    sleep 0.1
+    tries=$((tries + 1))
+done
+for test_file in ./tests/assembly/succeed/*; do
+    assembly_file="${mode_dir}"/"$(basename "${test_file%????}")".s
+    [ -S "${socket_file}" ] &&
+        "${bin_dir}"/roast --connect="${socket_file}" "$test_file" -t assembly -O all -o "${assembly_file}" 2>/dev/null &&
+        link_and_compare "${assembly_file}" "$test_file"
+    report_test "$test_file" $?
+done
+kill -0 "${server_pid}" 2>/dev/null
+report_test "--server" $?
+kill "${server_pid}" 2>/dev/null
+wait "${server_pid}"
+
+# Every method is lowered, optimized and emitted before the next is read,
+# without the passes that need the whole program.
+test_flags_mode stream "-O all --stream"
+
+# Sources of more than twice the 64 KiB minimum chunk are lexed in chunks that
+# start at the first line after an even split, and have to come out exactly
+# as lexing serially. Most of this one is a comment spanning every split,
+# whose lines hold quotes a chunk starting inside it would take for string
+# literals, between strings holding comment markers.
+echo "Testing mode: chunked scan"
+mode_dir="${modes_dir}"/chunks
+mkdir -p "${mode_dir}"
+source_file="${mode_dir}"/chunks.dcf
+awk -v q="'" 'BEGIN {
+    print "import printf;"
+    print "void main() {"
+    for (i = 0; i < 1000; i++)
+        printf "  printf(\"/* %d */ // \\\"%d\\\"\\n\");\n", i, i
+    print "  /*"
+    for (i = 0; i < 2500; i++)
+        printf "  printf(\"%d opens a string \" that %s never \" closes\n", i, q
+    print "  */"
+    for (i = 0; i < 1000; i++)
+        printf "  printf(\"*/ %d /* // \\\"%d\\\"\\n\");\n", i, i
+    print "}"
+}' > "${source_file}"
+"${bin_dir}"/roast "${source_file}" -t scan -j 1 > "${mode_dir}"/serial.out 2>&1 &&
+    "${bin_dir}"/roast "${source_file}" -t scan -j 4 > "${mode_dir}"/chunked.out 2>&1 &&
+    diff "${mode_dir}"/serial.out "${mode_dir}"/chunked.out > /dev/null
+report_test "${source_file}" $?